@@ -0,0 +1,163 @@
+/**
+ * @file bench.cpp
+ * @brief File implementing the main benchmark program
+ *
+ * Usage: @c cg_bench [--json] [filter] runs every benchmark whose name
+ * contains the filter, printing the time per operation of each, the items
+ * it processed per second (if it counts them, see #countItems) and the peak
+ * of the heap memory it allocated. With @c --json, the results are printed
+ * as a JSON array instead of a table.
+ */
+
+#include "bench.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief The minimum time each benchmark runs for, in seconds
+*/
+#define BENCH_MIN_TIME 0.25
+
+/**
+ * @brief The bytes before each allocation of new, holding its size. Keeps
+ * the alignment malloc gives
+*/
+#define ALLOCATION_HEADER alignof(std::max_align_t)
+
+static std::atomic<size_t> heapBytes(0); ///< The bytes allocated with new and not yet deleted
+static std::atomic<size_t> heapPeak(0);  ///< The most heapBytes was since the run started
+static std::atomic<size_t> itemCount(0); ///< The items counted since the run started
+
+/**
+ * @brief Allocates memory for new, counting it in the heap's size and peak
+*/
+static void* trackedAllocate(size_t size) {
+  char* block = (char*) malloc(size + ALLOCATION_HEADER);
+  if (block == nullptr)
+    throw std::bad_alloc();
+  *(size_t*) block = size;
+
+  size_t bytes = heapBytes.fetch_add(size, std::memory_order_relaxed) + size;
+  size_t peak = heapPeak.load(std::memory_order_relaxed);
+  while (bytes > peak && !heapPeak.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {}
+
+  return block + ALLOCATION_HEADER;
+}
+
+/**
+ * @brief Frees memory allocated by #trackedAllocate
+*/
+static void trackedFree(void* pointer) {
+  if (pointer == nullptr)
+    return;
+
+  char* block = (char*) pointer - ALLOCATION_HEADER;
+  heapBytes.fetch_sub(*(size_t*) block, std::memory_order_relaxed);
+  free(block);
+}
+
+//the array and nothrow forms call these
+void* operator new(size_t size) { return trackedAllocate(size); }
+void operator delete(void* pointer) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { trackedFree(pointer); }
+
+static std::vector<std::pair<std::string, BenchmarkBody>>& benchmarks() {
+  static std::vector<std::pair<std::string, BenchmarkBody>> registered;
+  return registered;
+}
+
+BenchmarkRegistration::BenchmarkRegistration(std::string name, BenchmarkBody body) {
+  benchmarks().push_back({ name, body });
+}
+
+void countItems(size_t items) {
+  itemCount.fetch_add(items, std::memory_order_relaxed);
+}
+
+/**
+ * @brief What a run of a benchmark took
+*/
+struct BenchmarkRun {
+  double elapsed;   ///< The time taken, in seconds
+  size_t items;     ///< The items counted
+  size_t peakBytes; ///< The most heap memory allocated at once, on top of what was allocated before
+};
+
+/**
+ * @brief Runs the given number of iterations of a benchmark
+*/
+static BenchmarkRun timeIterations(const BenchmarkBody& body, size_t iterations) {
+  static volatile double sink;
+
+  size_t baseBytes = heapBytes.load();
+  heapPeak = baseBytes;
+  itemCount = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  sink = body(iterations);
+  auto end = std::chrono::steady_clock::now();
+
+  (void)sink;
+  return { std::chrono::duration<double>(end - start).count(), itemCount.load(), heapPeak.load() - baseBytes };
+}
+
+int main(int argc, char** argv) {
+  std::string filter = "";
+  bool json = false;
+  for (int a = 1; a < argc; a++) {
+    std::string arg = argv[a];
+    if (arg == "--json")
+      json = true;
+    else
+      filter = arg;
+  }
+
+  if (json)
+    printf("[");
+  else
+    printf("%-40s %14s %14s %14s %12s\n", "benchmark", "iterations", "ns/op", "items/s", "peak KiB");
+
+  bool first = true;
+  for (auto& [name, body] : benchmarks()) {
+    if (name.find(filter) == std::string::npos)
+      continue;
+
+    //double the iterations until the benchmark runs long enough to be timed
+    size_t iterations = 1;
+    BenchmarkRun run = timeIterations(body, iterations);
+    while (run.elapsed < BENCH_MIN_TIME) {
+      iterations *= 2;
+      run = timeIterations(body, iterations);
+    }
+
+    double nanoseconds = run.elapsed * 1e9 / iterations;
+    double itemsPerSecond = run.items / run.elapsed;
+    if (json) {
+      printf("%s\n  {\"name\": \"%s\", \"iterations\": %zu, \"nsPerOp\": %.3f, \"itemsPerSecond\": ",
+             first ? "" : ",", name.c_str(), iterations, nanoseconds);
+      if (run.items > 0)
+        printf("%.1f", itemsPerSecond);
+      else
+        printf("null");
+      printf(", \"peakBytes\": %zu}", run.peakBytes);
+    } else if (run.items > 0) {
+      printf("%-40s %14zu %14.3f %14.4g %12.1f\n", name.c_str(), iterations, nanoseconds, itemsPerSecond,
+             run.peakBytes / 1024.0);
+    } else {
+      printf("%-40s %14zu %14.3f %14s %12.1f\n", name.c_str(), iterations, nanoseconds, "-", run.peakBytes / 1024.0);
+    }
+    fflush(stdout);
+    first = false;
+  }
+
+  if (json)
+    printf("\n]\n");
+
+  return 0;
+}
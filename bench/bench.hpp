@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * @file bench.hpp
+ * @brief File declaring a minimal micro-benchmark harness
+*/
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/**
+ * @brief The body of a benchmark: does the measured operation the given number
+ * of times and returns a value depending on all of them, so the compiler can't
+ * optimize the work away
+*/
+typedef std::function<double(size_t)> BenchmarkBody;
+
+/**
+ * @brief Counts items (e.g. triangles) processed by the running benchmark,
+ * whose throughput is reported in items per second
+*/
+void countItems(size_t items);
+
+/**
+ * @brief Registers a benchmark when constructed. Use through #BENCHMARK
+*/
+struct BenchmarkRegistration {
+  BenchmarkRegistration(std::string name, BenchmarkBody body);
+};
+
+/**
+ * @brief Defines a benchmark named "group/name". The body that follows gets
+ * the number of operations to run as @c iterations
+*/
+#define BENCHMARK(group, name) \
+  static double bench_##group##_##name(size_t iterations); \
+  static BenchmarkRegistration registration_##group##_##name(#group "/" #name, bench_##group##_##name); \
+  static double bench_##group##_##name(size_t iterations)
@@ -0,0 +1,107 @@
+/**
+ * @file culling_bench.cpp
+ * @brief Benchmarks of the frustum tests of center/extents boxes, one at a
+ * time and in batches, against the test of boxes of 8 corners they replaced
+ */
+
+#include "bench.hpp"
+#include "culling.hpp"
+#include "legacy_culling.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+/**
+ * @brief The number of boxes tested
+*/
+#define BOX_COUNT 100000
+
+/**
+ * @brief The same random boxes (in eye coordinates, some inside the frustum
+ * and some outside), in every representation, and the planes of a frustum
+ * looking down -z with a 60 degree field of view
+*/
+struct CullingData {
+  std::vector<legacy::BoundingBox> corners;
+  std::vector<Vec3> centers, extents;
+  BoxBatch batch;
+  std::vector<uint8_t> visible;
+
+  FrustumPlanes planes;
+  legacy::Frustum frustum;
+
+  CullingData() : visible(BOX_COUNT), frustum(frustumPlane(0), frustumPlane(1), frustumPlane(2),
+                                              frustumPlane(3), frustumPlane(4), frustumPlane(5)) {
+    for (int i = 0; i < FRUSTUM_PLANES; i++) {
+      legacy::Plane p = frustumPlane(i);
+      planes.x[i] = p.normal.x;
+      planes.y[i] = p.normal.y;
+      planes.z[i] = p.normal.z;
+      planes.d[i] = p.displacement;
+    }
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> side(-500, 500), depth(-1100, 100), size(0.5f, 20);
+
+    batch.reserve(BOX_COUNT);
+    for (int i = 0; i < BOX_COUNT; i++) {
+      Vec3 c = { side(random), side(random), depth(random) };
+      Vec3 e = { size(random), size(random), size(random) };
+
+      centers.push_back(c);
+      extents.push_back(e);
+      batch.add(c, e);
+      corners.push_back(legacy::BoundingBox({ c - e, c + e }));
+    }
+  }
+
+  /**
+   * @brief Returns the up, down, left, right, near and far planes of the frustum
+  */
+  static legacy::Plane frustumPlane(int i) {
+    float c = std::cos(M_PI / 6), s = std::sin(M_PI / 6);
+    legacy::Plane planes[FRUSTUM_PLANES] = {
+      { { 0, -c, -s }, 0 },
+      { { 0, c, -s }, 0 },
+      { { c, 0, -s }, 0 },
+      { { -c, 0, -s }, 0 },
+      { { 0, 0, -1 }, 1 },
+      { { 0, 0, 1 }, -1000 }
+    };
+    return planes[i];
+  }
+};
+
+static CullingData& data() {
+  static CullingData d;
+  return d;
+}
+
+BENCHMARK(culling, box_corners_legacy) {
+  const CullingData& d = data();
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++)
+    sum += d.frustum.contains(d.corners[i % BOX_COUNT]);
+  return sum;
+}
+
+BENCHMARK(culling, box_center_extents) {
+  const CullingData& d = data();
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    const Vec3& e = d.extents[i % BOX_COUNT];
+    sum += boxInFrustum(d.planes, d.centers[i % BOX_COUNT], e, length(e));
+  }
+  return sum;
+}
+
+/**
+ * Every box of the batch counts as an operation
+*/
+BENCHMARK(culling, box_batch) {
+  CullingData& d = data();
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i += BOX_COUNT)
+    sum += cullBoxes(d.planes, d.batch, d.visible.data());
+  return sum;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file generator_bench.cpp
+ * @brief Benchmarks of the shape generators, over a sweep of their slices,
+ * stacks and divisions, counting the triangles they generate
+ *
+ * The Bezier patches are read from models/teapot.patch, so the benchmarks
+ * must run from the root of the repository. The OBJ files are spheres
+ * written to the temporary directory, as are the streamed shapes.
+ */
+
+#define _USE_MATH_DEFINES
+#include "bench.hpp"
+#include "legacy_generator.hpp"
+#include "shapegenerator.hpp"
+#include "shapestream.hpp"
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+
+/**
+ * @brief The slices and stacks of the round shapes
+*/
+static const int roundSweep[] = { 8, 32, 128 };
+
+/**
+ * @brief The divisions of the cube and plane
+*/
+static const int gridSweep[] = { 4, 16, 64 };
+
+/**
+ * @brief The divisions of each Bezier patch
+*/
+static const int patchSweep[] = { 4, 16, 64 };
+
+/**
+ * @brief The divisions of the plane and the slices and stacks of the sphere
+ * streamed to a file, whose peak memory shouldn't grow with them
+*/
+static const int streamSweep[] = { 64, 256, 1024 };
+
+/**
+ * @brief The file of the Bezier patches
+*/
+#define PATCH_FILE "models/teapot.patch"
+
+/**
+ * @brief Registers a benchmark generating a shape, counting its triangles as
+ * the items processed
+*/
+static void registerGenerator(const std::string& name, std::function<std::unique_ptr<Shape>()> generate) {
+  BenchmarkRegistration registration(name, [generate](size_t iterations) {
+    double triangles = 0;
+    for (size_t i = 0; i < iterations; i++) {
+      std::unique_ptr<Shape> shape = generate();
+      countItems(shape->lodTriangleCount(0));
+      triangles += shape->lodTriangleCount(0);
+    }
+    return triangles;
+  });
+}
+
+/**
+ * @brief Registers a benchmark streaming the surfaces of a shape to a file in
+ * the temporary directory, counting its triangles as the items processed
+*/
+static void registerStream(const std::string& name, std::function<std::vector<GridSurface>()> surfaces) {
+  BenchmarkRegistration registration(name, [surfaces](size_t iterations) {
+    static JobSystem jobs;
+    std::string path = (std::filesystem::temp_directory_path() / "cg_bench_stream.3d").string();
+
+    double triangles = 0;
+    for (size_t i = 0; i < iterations; i++) {
+      streamSurfaces(surfaces(), path, jobs);
+
+      ShapeFileHeader header = {};
+      std::ifstream(path, std::ios::binary).read((char*) &header, sizeof(header));
+      countItems(header.triangleCount);
+      triangles += header.triangleCount;
+    }
+    return triangles;
+  });
+}
+
+/**
+ * @brief Writes a unit sphere of triangles to an OBJ file, with the
+ * positions, texture coordinates and normals of its vertices
+ *
+ * @return the path of the file
+*/
+static std::string writeSphereObj(int slices, int stacks) {
+  std::string path = (std::filesystem::temp_directory_path()
+                      / ("cg_bench_sphere_" + std::to_string(slices) + ".obj")).string();
+  FILE* file = fopen(path.c_str(), "w");
+  if (file == nullptr)
+    return path;
+
+  for (int j = 0; j <= stacks; j++) {
+    for (int i = 0; i <= slices; i++) {
+      float alpha = 2 * M_PI * i / slices, beta = M_PI * j / stacks - M_PI_2;
+      float x = cos(beta) * sin(alpha), y = sin(beta), z = cos(beta) * cos(alpha);
+      fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+              x, y, z, (float) i / slices, (float) j / stacks, x, y, z);
+    }
+  }
+
+  //OBJ counts the vertices from 1
+  for (int j = 0; j < stacks; j++) {
+    for (int i = 0; i < slices; i++) {
+      int a = j * (slices + 1) + i + 1, b = a + 1, c = a + slices + 1, d = c + 1;
+      fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, d, d, d);
+      fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, d, d, d, c, c, c);
+    }
+  }
+
+  fclose(file);
+  return path;
+}
+
+/**
+ * @brief Registers the benchmarks of every generator
+*/
+static bool registerGenerators() {
+  for (int n : roundSweep) {
+    std::string size = std::to_string(n) + "x" + std::to_string(n);
+    registerGenerator("generator/sphere/" + size, [n]() { return generateSphere(1, n, n); });
+    registerGenerator("generator/sphere_welded/" + size, [n]() { return legacy::generateSphere(1, n, n); });
+    registerGenerator("generator/cone/" + size, [n]() { return generateCone(1, 2, n, n); });
+    registerGenerator("generator/cylinder/" + std::to_string(n), [n]() { return generateCylinder(1, 2, n); });
+    registerGenerator("generator/donut/" + size, [n]() { return generateDonut(2, 1, 0.5f, n, n); });
+
+    std::string obj = writeSphereObj(n, n);
+    registerGenerator("generator/obj/" + size, [obj]() { return generateFromObj(obj); });
+  }
+
+  for (int n : gridSweep) {
+    registerGenerator("generator/cube/" + std::to_string(n), [n]() { return generateCube(1, n); });
+    registerGenerator("generator/plane/" + std::to_string(n), [n]() { return generatePlane(1, n); });
+    registerGenerator("generator/plane_welded/" + std::to_string(n), [n]() { return legacy::generatePlane(1, n); });
+  }
+
+  for (int n : streamSweep) {
+    registerStream("generator/stream/plane/" + std::to_string(n), [n]() { return planeSurfaces(1, n); });
+    registerStream("generator/stream/sphere/" + std::to_string(n) + "x" + std::to_string(n),
+                   [n]() { return sphereSurfaces(1, n, n); });
+  }
+
+  if (std::ifstream(PATCH_FILE)) {
+    static JobSystem jobs;
+    for (int n : patchSweep) {
+      registerGenerator("generator/bezier/" + std::to_string(n), [n]() { return generateBezierPatches(PATCH_FILE, n); });
+      registerGenerator("generator/bezier_parallel/" + std::to_string(n),
+                        [n]() { return generateBezierPatches(PATCH_FILE, n, &jobs); });
+    }
+  } else {
+    fprintf(stderr, "%s not found, skipping the Bezier benchmarks\n", PATCH_FILE);
+  }
+
+  return true;
+}
+
+static bool registered = registerGenerators();
@@ -0,0 +1,57 @@
+#include "legacy_culling.hpp"
+
+namespace legacy {
+
+BoundingBox::BoundingBox(const std::vector<Vec3>& points) {
+  //Calculate as an AABB
+  float minX, maxX, minY, maxY, minZ, maxZ;
+  minX = maxX = points.at(0).x;
+  minY = maxY = points.at(0).y;
+  minZ = maxZ = points.at(0).z;
+
+  for (unsigned int i = 1; i < points.size(); i++) {
+    float x = points.at(i).x;
+    float y = points.at(i).y;
+    float z = points.at(i).z;
+
+    if (x < minX) minX = x; else if (x > maxX) maxX = x;
+    if (y < minY) minY = y; else if (y > maxY) maxY = y;
+    if (z < minZ) minZ = z; else if (z > maxZ) maxZ = z;
+  }
+
+  for (float x : { minX, maxX })
+    for (float y : { minY, maxY })
+      for (float z : { minZ, maxZ })
+        corners.push_back({ x, y, z });
+}
+
+BoundingBox::BoundingBox(const BoundingBox& bb) :
+  corners(bb.corners)
+{}
+
+BoundingBox& BoundingBox::operator =(const BoundingBox& bb) {
+  this->corners = bb.corners;
+  return *this;
+}
+
+bool BoundingBox::isForward(Plane plane) {
+  for (Vec3& p : corners)
+    if (p * plane.normal >= plane.displacement)
+      return true;
+
+  return false;
+}
+
+Frustum::Frustum(Plane up, Plane down, Plane left, Plane right, Plane near, Plane far) :
+  up(up), down(down), left(left), right(right), near(near), far(far)
+{}
+
+bool Frustum::contains(BoundingBox boundingBox) const {
+  for (Plane p : { up, down, left, right, near, far })
+    if (!boundingBox.isForward(p))
+      return false;
+
+  return true;
+}
+
+}
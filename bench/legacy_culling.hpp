@@ -0,0 +1,40 @@
+#pragma once
+
+/**
+ * @file legacy_culling.hpp
+ * @brief File declaring the bounding box of 8 corners and the frustum test
+ * that the center/extents boxes and #cullBoxes replaced, kept (out-of-line, in
+ * their own translation unit, as they were) to compare against
+*/
+
+#include <vector>
+#include "vecmath.hpp"
+
+namespace legacy {
+
+struct Plane {
+  Vec3 normal;
+  float displacement;
+};
+
+class BoundingBox {
+  std::vector<Vec3> corners;
+
+public:
+  BoundingBox(const std::vector<Vec3>& points);
+  BoundingBox(const BoundingBox& bb);
+
+  BoundingBox& operator =(const BoundingBox& bb);
+
+  bool isForward(Plane plane);
+};
+
+class Frustum {
+  Plane up, down, left, right, near, far;
+
+public:
+  Frustum(Plane up, Plane down, Plane left, Plane right, Plane near, Plane far);
+  bool contains(BoundingBox boundingBox) const;
+};
+
+}
@@ -0,0 +1,103 @@
+/**
+ * @file legacy_generator.cpp
+ * @brief File implementing the generators of legacy_generator.hpp, as they
+ * were
+ */
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include "legacy_generator.hpp"
+#include <vector>
+
+namespace legacy {
+
+static std::vector<Point> generateCircle(Point center, float radius, int slices) {
+  std::vector<Point> ans;
+
+  for (int i = 0; i < slices; i++) {
+    float angle = 2 * M_PI * i / slices;
+    Vector v = {radius * cos(angle), 0, radius * sin(angle)};
+    ans.push_back(center + v);
+  }
+
+  return ans;
+}
+
+static void generateSquare(Point p1, Point p2, Point p3, Point p4, std::vector<Triangle> &triangles) {
+  triangles.push_back({p1, p2, p3});
+  triangles.push_back({p1, p3, p4});
+}
+
+std::unique_ptr<Shape> generatePlane(float length, int divisions) {
+  std::vector<Triangle> triangles;
+  std::vector<Vector> normals;
+  std::vector<Point2D> textureMapping;
+
+  float mid = length / 2.0;
+  float step = length / divisions;
+
+  for (int i = 0; i < divisions; i++) {
+    for (int j = 0; j < divisions; j++) {
+      generateSquare({-mid + i * step, 0, -mid + j * step},
+                     {-mid + i * step, 0, -mid + (j + 1) * step},
+                     {-mid + (i + 1) * step, 0, -mid + (j + 1) * step},
+                     {-mid + (i + 1) * step, 0, -mid + j * step}, triangles);
+    }
+  }
+
+  for(Triangle t : triangles) {
+    Point p[3] = {std::get<0>(t), std::get<1>(t), std::get<2>(t)};
+    for(int i = 0; i < 3; i++) {
+      textureMapping.push_back({(p[i].x + mid) / length, (p[i].z + mid) / length});
+      normals.push_back({0.0f, 1.0f, 0.0f});
+    }
+  }
+
+  return std::make_unique<Shape>(triangles, normals, textureMapping);
+}
+
+std::unique_ptr<Shape> generateSphere(float radius, int slices, int stacks) {
+  std::vector<Triangle> ans;
+  std::vector<Vector> normals;
+  std::vector<Point2D> textureMapping;
+  std::vector<Point> prev;
+
+  for (int i = 0; i <= stacks; i++) {
+    float h = radius * sin(-M_PI / 2.0f + ((double)i / stacks) * M_PI);
+    float r = sqrt(radius * radius - h * h);
+
+    std::vector<Point> cur = generateCircle({0, h, 0}, r, slices);
+    cur.push_back(cur[0]);
+
+    if (i != 0)
+      for (int j = 0; j < slices; j++) {
+        Point p1 = prev.at(j + 1);
+        Point p2 = prev.at(j);
+        Point p3 = cur.at(j);
+        Point p4 = cur.at(j + 1);
+
+        ans.push_back({p1, p2, p3});
+        ans.push_back({p1, p3, p4});
+
+        textureMapping.push_back({-(float)(j + 1) / slices,  (float)(i - 1) / stacks});
+        textureMapping.push_back({-(float)(j) / slices,  (float)(i - 1) / stacks});
+        textureMapping.push_back({-(float)(j) / slices,  (float)(i) / stacks});
+        textureMapping.push_back({-(float)(j + 1) / slices,  (float)(i - 1) / stacks});
+        textureMapping.push_back({-(float)(j) / slices,   (float)(i) / stacks});
+        textureMapping.push_back({-(float)(j + 1) / slices,  (float)(i) / stacks});
+      }
+
+    prev = cur;
+  }
+
+  for(Triangle t : ans) {
+    Point ps[3] = {std::get<0>(t), std::get<1>(t), std::get<2>(t)};
+
+    for(Point& p : ps)
+      normals.push_back(normalize(p));
+  }
+
+  return std::make_unique<Shape>(ans, normals, textureMapping);
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+/**
+ * @file legacy_generator.hpp
+ * @brief File declaring the sphere and plane generators that built triangle
+ * soups welded by #Shape, before the generators indexed their grids
+ * directly, kept to compare against
+*/
+
+#include "shape.hpp"
+#include <memory>
+
+namespace legacy {
+
+std::unique_ptr<Shape> generateSphere(float radius, int slices, int stacks);
+std::unique_ptr<Shape> generatePlane(float length, int divisions);
+
+}
@@ -0,0 +1,32 @@
+#include "legacy_geometry.hpp"
+#include <cmath>
+
+namespace legacy {
+
+Vector scale(float x, const Vector& v) {
+  return {x * std::get<0>(v),
+          x * std::get<1>(v),
+          x * std::get<2>(v)};
+}
+
+float dot(const Vector& v1, const Vector& v2) {
+    return std::get<0>(v1) * std::get<0>(v2)
+        + std::get<1>(v1) * std::get<1>(v2)
+        + std::get<2>(v1) * std::get<2>(v2);
+}
+
+Vector cross(const Vector& v1, const Vector& v2) {
+    return {std::get<1>(v1) * std::get<2>(v2) - std::get<2>(v1) * std::get<1>(v2),
+            std::get<2>(v1) * std::get<0>(v2) - std::get<0>(v1) * std::get<2>(v2),
+            std::get<0>(v1) * std::get<1>(v2) - std::get<1>(v1) * std::get<0>(v2)};
+}
+
+float length(Vector v) {
+  return sqrt(dot(v, v));
+}
+
+Vector normalize(Vector v) {
+  return scale(1 / length(v), v);
+}
+
+}
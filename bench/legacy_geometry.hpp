@@ -0,0 +1,22 @@
+#pragma once
+
+/**
+ * @file legacy_geometry.hpp
+ * @brief File declaring the tuple-based vector functions that #Vec3 replaced,
+ * kept (out-of-line, in their own translation unit, as they were) to compare
+ * against
+*/
+
+#include <tuple>
+
+namespace legacy {
+
+typedef std::tuple<float, float, float> Vector;
+
+Vector scale(float x, const Vector& v);
+float dot(const Vector& v1, const Vector& v2);
+Vector cross(const Vector& v1, const Vector& v2);
+float length(Vector v);
+Vector normalize(Vector v);
+
+}
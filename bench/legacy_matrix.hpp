@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ * @file legacy_matrix.hpp
+ * @brief File defining the generic, runtime-sized matrix product that #Mat
+ * replaced, kept to compare against
+*/
+
+namespace legacy {
+
+/**
+ * @brief A generic matrix multiplication function.
+ *
+ * @param n The number of columns of the output matrix
+ * @param m The number of rows of the output matrix
+ * @param l The number of columns of the first input matrix (the
+ * same as the number of rows of the second input matrix)
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix
+*/
+template <typename T, typename S, typename U>
+void matrixProd(int n, int m, int l, T* a, S* b, U *c) {
+  for (int y = 0; y < m; y++) {
+    for (int x = 0; x < n; x++) {
+      c[n * y + x] = U{};
+      for (int i = 0; i < l; i++)
+        c[n * y + x] = c[n * y + x] + (a[l * y + i] * b[n * i + x]);
+    }
+  }
+}
+
+}
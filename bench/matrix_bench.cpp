@@ -0,0 +1,133 @@
+/**
+ * @file matrix_bench.cpp
+ * @brief Benchmarks of the #Mat products against the generic, runtime-sized
+ * matrix product they replaced
+ */
+
+#include "bench.hpp"
+#include "legacy_matrix.hpp"
+#include "matrix.hpp"
+#include <random>
+#include <vector>
+
+/**
+ * @brief The number of matrices operated on (a power of 2, so indices wrap
+ * around with a mask)
+*/
+#define MATRIX_COUNT 256
+
+/**
+ * @brief Random matrices, vectors and (Bezier) control point matrices
+*/
+struct MatrixData {
+  std::vector<Mat4> matrices;
+  std::vector<ColVec4> vectors;
+  std::vector<Mat<4, 4, Vec3>> controlPoints;
+
+  MatrixData() : matrices(MATRIX_COUNT), vectors(MATRIX_COUNT), controlPoints(MATRIX_COUNT) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> value(-10, 10);
+
+    for (int i = 0; i < MATRIX_COUNT; i++) {
+      for (float& f : matrices[i].values)
+        f = value(random);
+      for (float& f : vectors[i].values)
+        f = value(random);
+      for (Vec3& p : controlPoints[i].values)
+        p = { value(random), value(random), value(random) };
+    }
+  }
+};
+
+static const MatrixData& data() {
+  static MatrixData d;
+  return d;
+}
+
+static constexpr Mat4 bezier = {
+  -1.0f, 3.0f, -3.0f, 1.0f,
+  3.0f, -6.0f, 3.0f, 0.0f,
+  -3.0f, 3.0f, 0.0f, 0.0f,
+  1.0f, 0.0f, 0.0f, 0.0f
+};
+
+BENCHMARK(matrix, mat4_mat4_generic) {
+  const std::vector<Mat4>& m = data().matrices;
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    float c[16];
+    legacy::matrixProd(4, 4, 4, m[i & (MATRIX_COUNT - 1)].values, m[(i + 1) & (MATRIX_COUNT - 1)].values, c);
+    sum += c[i & 15];
+  }
+  return sum;
+}
+
+BENCHMARK(matrix, mat4_mat4) {
+  const std::vector<Mat4>& m = data().matrices;
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    Mat4 c = m[i & (MATRIX_COUNT - 1)] * m[(i + 1) & (MATRIX_COUNT - 1)];
+    sum += c.values[i & 15];
+  }
+  return sum;
+}
+
+BENCHMARK(matrix, mat4_vec4_generic) {
+  const MatrixData& d = data();
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    float c[4];
+    legacy::matrixProd(1, 4, 4, d.matrices[i & (MATRIX_COUNT - 1)].values, d.vectors[(i + 1) & (MATRIX_COUNT - 1)].values, c);
+    sum += c[i & 3];
+  }
+  return sum;
+}
+
+BENCHMARK(matrix, mat4_vec4) {
+  const MatrixData& d = data();
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    ColVec4 c = d.matrices[i & (MATRIX_COUNT - 1)] * d.vectors[(i + 1) & (MATRIX_COUNT - 1)];
+    sum += c.values[i & 3];
+  }
+  return sum;
+}
+
+/**
+ * A point of a Bezier patch, u * M * P * M * v, as generateBezierTriangles
+ * computes it
+*/
+BENCHMARK(matrix, bezier_point_generic) {
+  const MatrixData& d = data();
+  const float* m = bezier.values;
+
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    const Vec3* p = d.controlPoints[i & (MATRIX_COUNT - 1)].values;
+    float t = (i & 15) / 15.0f;
+    float u[4] = { t * t * t, t * t, t, 1 }, v[4] = { 1, t, t * t, t * t * t };
+
+    float temp1[4];
+    Vec3 temp2[4], temp3[4], point;
+    legacy::matrixProd(1, 4, 4, m, v, temp1);
+    legacy::matrixProd(1, 4, 4, p, temp1, temp2);
+    legacy::matrixProd(1, 4, 4, m, temp2, temp3);
+    legacy::matrixProd(1, 1, 4, u, temp3, &point);
+    sum += point.x + point.y + point.z;
+  }
+  return sum;
+}
+
+BENCHMARK(matrix, bezier_point) {
+  const MatrixData& d = data();
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    float t = (i & 15) / 15.0f;
+    RowVec4 u = { t * t * t, t * t, t, 1 };
+    ColVec4 v = { 1, t, t * t, t * t * t };
+
+    Vec3 point = (u * (bezier * (d.controlPoints[i & (MATRIX_COUNT - 1)] * (bezier * v)))).values[0];
+    sum += point.x + point.y + point.z;
+  }
+  return sum;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file vecmath_bench.cpp
+ * @brief Benchmarks of the #Vec3 operations against the tuple-based ones
+ * they replaced
+ */
+
+#include "bench.hpp"
+#include "legacy_geometry.hpp"
+#include "vecmath.hpp"
+#include <random>
+#include <vector>
+
+/**
+ * @brief The number of vectors operated on (a power of 2, so indices wrap
+ * around with a mask)
+*/
+#define VECTOR_COUNT 1024
+
+/**
+ * @brief The same random vectors, as tuples and as #Vec3
+*/
+struct VectorData {
+  std::vector<legacy::Vector> tuples;
+  std::vector<Vec3> vectors;
+
+  VectorData() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(-10, 10);
+
+    for (int i = 0; i < VECTOR_COUNT; i++) {
+      float x = coordinate(random), y = coordinate(random), z = coordinate(random);
+      tuples.push_back({ x, y, z });
+      vectors.push_back({ x, y, z });
+    }
+  }
+};
+
+static const VectorData& data() {
+  static VectorData d;
+  return d;
+}
+
+BENCHMARK(vecmath, dot_tuple) {
+  const std::vector<legacy::Vector>& v = data().tuples;
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++)
+    sum += legacy::dot(v[i & (VECTOR_COUNT - 1)], v[(i + 1) & (VECTOR_COUNT - 1)]);
+  return sum;
+}
+
+BENCHMARK(vecmath, dot_vec3) {
+  const std::vector<Vec3>& v = data().vectors;
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++)
+    sum += v[i & (VECTOR_COUNT - 1)] * v[(i + 1) & (VECTOR_COUNT - 1)];
+  return sum;
+}
+
+BENCHMARK(vecmath, cross_tuple) {
+  const std::vector<legacy::Vector>& v = data().tuples;
+  legacy::Vector acc = { 0, 0, 0 };
+  for (size_t i = 0; i < iterations; i++) {
+    legacy::Vector c = legacy::cross(v[i & (VECTOR_COUNT - 1)], v[(i + 1) & (VECTOR_COUNT - 1)]);
+    std::get<0>(acc) += std::get<0>(c);
+    std::get<1>(acc) += std::get<1>(c);
+    std::get<2>(acc) += std::get<2>(c);
+  }
+  return std::get<0>(acc) + std::get<1>(acc) + std::get<2>(acc);
+}
+
+BENCHMARK(vecmath, cross_vec3) {
+  const std::vector<Vec3>& v = data().vectors;
+  Vec3 acc;
+  for (size_t i = 0; i < iterations; i++)
+    acc += v[i & (VECTOR_COUNT - 1)] ^ v[(i + 1) & (VECTOR_COUNT - 1)];
+  return acc.x + acc.y + acc.z;
+}
+
+BENCHMARK(vecmath, normalize_tuple) {
+  const std::vector<legacy::Vector>& v = data().tuples;
+  legacy::Vector acc = { 0, 0, 0 };
+  for (size_t i = 0; i < iterations; i++) {
+    legacy::Vector n = legacy::normalize(v[i & (VECTOR_COUNT - 1)]);
+    std::get<0>(acc) += std::get<0>(n);
+    std::get<1>(acc) += std::get<1>(n);
+    std::get<2>(acc) += std::get<2>(n);
+  }
+  return std::get<0>(acc) + std::get<1>(acc) + std::get<2>(acc);
+}
+
+BENCHMARK(vecmath, normalize_vec3) {
+  const std::vector<Vec3>& v = data().vectors;
+  Vec3 acc;
+  for (size_t i = 0; i < iterations; i++)
+    acc += normalize(v[i & (VECTOR_COUNT - 1)]);
+  return acc.x + acc.y + acc.z;
+}
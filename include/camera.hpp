@@ -1,5 +1,6 @@
 #pragma once
 
+#include "matrixstack.hpp"
 #include "parser.hpp"
 #include "utils.hpp"
 #include <iostream>
@@ -20,6 +21,7 @@ protected:
   float near;
   float far;
   float fov;
+  int height = 1; ///< The height of the window, in pixels
 
 public:
   /**
@@ -46,10 +48,12 @@ public:
   void changeSize(WindowSize windowSize);
 
   /**
-   * @brief Is called before rendering the scene
+   * @brief Is called before rendering the scene. Loads the view matrix into
+   * @p modelview and into GL
    * 
+   * @param modelview the modelview matrix of the scene
    */
-  void setupScene();
+  void setupScene(MatrixStack& modelview);
 
   /**
    * @brief Constructs the view frustum
@@ -59,6 +63,12 @@ public:
    */
   Frustum viewFrustum();
 
+  /**
+   * @brief Returns the size, in pixels, of the projection of a unit long
+   * segment at unit distance from the camera (facing it)
+   */
+  float screenScale() const;
+
   /**
    * @brief Is called whenever a character key is pressed
    * 
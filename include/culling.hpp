@@ -0,0 +1,180 @@
+#pragma once
+
+/**
+ * @file culling.hpp
+ * @brief File defining the (inline) tests of boxes against the planes of a
+ * view frustum, one box at a time or a batch of them at once
+ *
+ * A box is given by its center and its extents (half its size along each
+ * axis). Each test first checks the sphere around the box, which decides most
+ * boxes without looking at the extents, and only the boxes the sphere
+ * straddles a plane of are tested exactly. The batch test uses SSE to test 4
+ * boxes at a time, giving the same results as testing them one at a time.
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "geometry.hpp"
+
+/**
+ * @brief The number of planes of a frustum
+*/
+#define FRUSTUM_PLANES 6
+
+/**
+ * @brief The planes of a frustum, as an array per component. A point p is in
+ * front of plane i (on the inside) when x[i] * p.x + y[i] * p.y + z[i] * p.z >= d[i]
+ *
+ * The normals (x, y, z) must be unit vectors.
+*/
+struct FrustumPlanes {
+  float x[FRUSTUM_PLANES];
+  float y[FRUSTUM_PLANES];
+  float z[FRUSTUM_PLANES];
+  float d[FRUSTUM_PLANES];
+};
+
+/**
+ * @brief Returns whether at least part of a box is inside the planes
+ *
+ * @param planes  the planes
+ * @param center  the center of the box
+ * @param extents the extents of the box
+ * @param radius  the length of the extents (the radius of the sphere around the box)
+*/
+inline bool boxInFrustum(const FrustumPlanes& planes, const Point& center, const Vector& extents, float radius) {
+  for (int i = 0; i < FRUSTUM_PLANES; i++) {
+    float s = planes.x[i] * center.x + planes.y[i] * center.y + planes.z[i] * center.z - planes.d[i];
+    if (s >= radius)
+      continue;
+    if (s < -radius)
+      return false;
+
+    //the corner furthest in front of the plane
+    float e = std::fabs(planes.x[i]) * extents.x + std::fabs(planes.y[i]) * extents.y
+            + std::fabs(planes.z[i]) * extents.z;
+    if (s + e < 0)
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief A batch of boxes, as an array per component, to be culled together
+ *
+ * Clearing it keeps the arrays' memory, so a batch refilled every frame only
+ * allocates while it grows.
+*/
+class BoxBatch {
+public:
+  /**
+   * @brief Removes all boxes
+  */
+  void clear() {
+    for (std::vector<float>* v : { &cx, &cy, &cz, &ex, &ey, &ez, &radius })
+      v->clear();
+  }
+
+  /**
+   * @brief Makes room for @p count boxes
+  */
+  void reserve(size_t count) {
+    for (std::vector<float>* v : { &cx, &cy, &cz, &ex, &ey, &ez, &radius })
+      v->reserve(count);
+  }
+
+  /**
+   * @brief Adds a box
+   *
+   * @return its index in the batch
+  */
+  size_t add(const Point& center, const Vector& extents) {
+    cx.push_back(center.x);
+    cy.push_back(center.y);
+    cz.push_back(center.z);
+    ex.push_back(extents.x);
+    ey.push_back(extents.y);
+    ez.push_back(extents.z);
+    radius.push_back(length(extents));
+    return radius.size() - 1;
+  }
+
+  size_t size() const { return radius.size(); }
+
+  std::vector<float> cx, cy, cz; ///< The centers of the boxes
+  std::vector<float> ex, ey, ez; ///< The extents of the boxes
+  std::vector<float> radius;     ///< The lengths of the extents
+};
+
+/**
+ * @brief Tests every box of a batch against the planes
+ *
+ * @param planes  the planes
+ * @param boxes   the boxes
+ * @param visible set, for each box, to 1 if at least part of it is inside
+ * the planes and to 0 otherwise. Must have room for all the boxes
+ *
+ * @return the number of boxes (at least partly) inside
+*/
+inline size_t cullBoxes(const FrustumPlanes& planes, const BoxBatch& boxes, uint8_t* visible) {
+  size_t n = boxes.size(), count = 0, b = 0;
+
+#ifdef VECMATH_SSE
+  __m128 px[FRUSTUM_PLANES], py[FRUSTUM_PLANES], pz[FRUSTUM_PLANES], pd[FRUSTUM_PLANES];
+  __m128 ax[FRUSTUM_PLANES], ay[FRUSTUM_PLANES], az[FRUSTUM_PLANES];
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  for (int i = 0; i < FRUSTUM_PLANES; i++) {
+    px[i] = _mm_set1_ps(planes.x[i]);
+    py[i] = _mm_set1_ps(planes.y[i]);
+    pz[i] = _mm_set1_ps(planes.z[i]);
+    pd[i] = _mm_set1_ps(planes.d[i]);
+    ax[i] = _mm_andnot_ps(sign, px[i]);
+    ay[i] = _mm_andnot_ps(sign, py[i]);
+    az[i] = _mm_andnot_ps(sign, pz[i]);
+  }
+
+  for (; b + 4 <= n; b += 4) {
+    __m128 cx = _mm_loadu_ps(&boxes.cx[b]), cy = _mm_loadu_ps(&boxes.cy[b]), cz = _mm_loadu_ps(&boxes.cz[b]);
+    __m128 r = _mm_loadu_ps(&boxes.radius[b]);
+    __m128 negR = _mm_xor_ps(r, sign);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    for (int i = 0; i < FRUSTUM_PLANES; i++) {
+      __m128 s = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px[i], cx), _mm_mul_ps(py[i], cy)),
+                                       _mm_mul_ps(pz[i], cz)), pd[i]);
+
+      //the spheres behind the plane are out, and the boxes are only needed
+      //for the ones straddling it
+      inside = _mm_andnot_ps(_mm_cmplt_ps(s, negR), inside);
+      __m128 straddling = _mm_and_ps(_mm_cmplt_ps(s, r), inside);
+
+      if (_mm_movemask_ps(straddling) != 0) {
+        __m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[i], _mm_loadu_ps(&boxes.ex[b])),
+                                         _mm_mul_ps(ay[i], _mm_loadu_ps(&boxes.ey[b]))),
+                              _mm_mul_ps(az[i], _mm_loadu_ps(&boxes.ez[b])));
+        __m128 behind = _mm_cmplt_ps(_mm_add_ps(s, e), _mm_setzero_ps());
+        inside = _mm_andnot_ps(_mm_and_ps(straddling, behind), inside);
+      }
+
+      if (_mm_movemask_ps(inside) == 0)
+        break;
+    }
+
+    int mask = _mm_movemask_ps(inside);
+    for (int k = 0; k < 4; k++) {
+      visible[b + k] = (mask >> k) & 1;
+      count += visible[b + k];
+    }
+  }
+#endif
+
+  for (; b < n; b++) {
+    visible[b] = boxInFrustum(planes, { boxes.cx[b], boxes.cy[b], boxes.cz[b] },
+                              { boxes.ex[b], boxes.ey[b], boxes.ez[b] }, boxes.radius[b]);
+    count += visible[b];
+  }
+
+  return count;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+/**
+ * @file flatscene.hpp
+ * @brief File defining the @link FlatScene class, the tree of groups of a
+ * scene flattened into arrays, whose matrices and visibility are computed in
+ * parallel every frame
+*/
+
+#include <vector>
+#include "group.hpp"
+#include "jobsystem.hpp"
+#include "renderqueue.hpp"
+
+/**
+ * @brief The number of groups or models each job of FlatScene::update
+ * handles at least
+*/
+#define SCENE_JOB_GRAIN 256
+
+/**
+ * @brief The groups and models of a scene, flattened so that each frame their
+ * modelview matrices, culling and levels of detail can be computed on a
+ * #JobSystem, leaving only the draw calls to the GL thread
+ *
+ * The groups are stored breadth first, so each level of the tree is a
+ * contiguous range whose parents were all computed with the level before.
+ * The models are stored in the order the tree draws them (depth first).
+ *
+ * The draw list is submitted through a #RenderQueue, sorted by state.
+ *
+ * The scene refers to the groups and models of the tree it was built from,
+ * which must outlive it and not change.
+*/
+class FlatScene {
+public:
+  FlatScene();
+
+  /**
+   * @brief Flattens the tree of groups
+   *
+   * @param root the root group of the scene
+  */
+  FlatScene(Group& root);
+
+  /**
+   * @brief Computes the modelview matrix of every group, tests the groups and
+   * models against the view frustum, chooses the levels of detail of the
+   * models, and builds the draw list
+   *
+   * A group outside the view frustum hides its subgroups and models, which
+   * aren't computed at all. The models drawn swap in the levels of
+   * tessellation they chose (see Model::updateTessellation), so it must be
+   * called with the GL context current.
+   *
+   * @param jobs    the threads to compute on
+   * @param context the context of the frame
+   * @param view    the view matrix of the camera
+   * @param time    the time since the animations started, in seconds
+   * @param stats   where to count the models and groups culled
+  */
+  void update(JobSystem& jobs, const DrawContext& context, const Mat4& view, float time, DrawStats& stats);
+
+  /**
+   * @brief Draws the draw list and the traces of the curves of the visible
+   * groups. GL's modelview matrix is replaced
+   *
+   * @param renderer the renderer of the instances (see RenderQueue::submit)
+   * @param stats    where to count the draw calls and state changes
+  */
+  void draw(InstanceRenderer& renderer, DrawStats& stats);
+
+  /**
+   * @brief Returns the models to draw in the last frame, in order
+  */
+  const std::vector<DrawItem>& getDrawList() const;
+
+private:
+  /**
+   * @brief A group of the scene
+  */
+  struct Node {
+    const Group* group;
+    size_t parent;     ///< The index of the parent, or #NO_PARENT for the root
+    size_t firstTrace; ///< The first of the node's traces (see #traces)
+    size_t traceCount;
+  };
+
+  /**
+   * @brief A curve whose trace is drawn, in the coordinates before the
+   * transformation that follows it is applied
+  */
+  struct Trace {
+    const CatmullRom* curve;
+    size_t node;
+    size_t transformation; ///< The index of the curve in the transformations of the group
+  };
+
+  /**
+   * @brief What was decided about a group in a frame
+  */
+  enum NodeState : uint8_t {
+    Visible, ///< Its bound is (at least partly) inside the view frustum
+    Culled,  ///< Its bound is outside the view frustum, but its parent's isn't
+    Hidden   ///< Its parent wasn't visible, or it has nothing to draw
+  };
+
+  static constexpr size_t NO_PARENT = (size_t)-1;
+
+  /**
+   * @brief Adds the models and traces of a node and its subtree, depth first
+   *
+   * @param node       the node
+   * @param groups     the group of each node
+   * @param firstChild the first child of each node (children are contiguous)
+  */
+  void flatten(size_t node, const std::vector<Group*>& groups, const std::vector<size_t>& firstChild);
+
+  std::vector<Node> nodes;
+  std::vector<size_t> levels;      ///< The first node of each level of the tree, and the number of nodes
+  std::vector<Model*> models;      ///< The models, depth first
+  std::vector<size_t> modelNodes;  ///< The node of each model
+  std::vector<Trace> traces;
+  RenderQueue queue;
+
+  //the results of the last update
+  std::vector<Mat4> matrices;      ///< The modelview matrix of each node
+  std::vector<NodeState> states;   ///< The state of each node
+  std::vector<uint8_t> culled;     ///< Whether each model of a visible node was culled
+  std::vector<Mat4> traceMatrices; ///< The modelview matrix each trace is drawn with
+  std::vector<DrawItem> drawList;
+};
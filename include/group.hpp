@@ -56,13 +56,21 @@ public:
   */
   Group& operator=(Group&& other);
 
+  std::vector<Group>& getSubgroups();
+  std::vector<Model>& getModels();
+  const std::vector<std::unique_ptr<Transformation>>& getTransformations() const;
+
   /**
-   * @brief Renders the group to the screen.
-   * 
-   * This method does not change GLUT's matrices - i.e. they will be the same
-   * before and after execution.
+   * @brief Returns a sphere containing the models of the group and its
+   * subgroups at any point of their animations, in the coordinates of the
+   * parent group
   */
-  int draw(const Frustum& viewFrustum);
+  const BoundingSphere& getBound() const;
+
+  /**
+   * @brief Returns the number of models in the group and its subgroups
+  */
+  int getModelCount() const;
 
 private:
   /**
@@ -103,6 +111,7 @@ private:
 
   /**
    * @brief Builds the transformations to apply to the group based on the XML string.
+   * The ones that aren't animated are folded into matrices (see Transformation::fold)
    * 
    * Auxiliary method for the XML constructor
    * 
@@ -113,6 +122,12 @@ private:
   */
   inline void constructTransformations(XMLParser parser);
 
+  /**
+   * @brief Computes #bound and #modelCount from the models, subgroups and
+   * transformations of the group
+  */
+  void computeBound();
+
 private:
   /**
    * @brief The subgroups of the group
@@ -127,4 +142,15 @@ private:
    * @brief The transformations to apply to this group
   */
   std::vector<std::unique_ptr<Transformation>> transformations;
+
+  /**
+   * @brief A sphere containing the models of the group and its subgroups at
+   * any point of their animations, in the coordinates of the parent group
+  */
+  BoundingSphere bound;
+
+  /**
+   * @brief The number of models in the group and its subgroups
+  */
+  int modelCount = 0;
 };
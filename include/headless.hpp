@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+ * @file headless.hpp
+ * @brief File defining the @link HeadlessContext class, an OpenGL context
+ * drawing into an offscreen framebuffer without a window, and the benchmark
+ * run of the engine with it
+*/
+
+#include <ostream>
+#include <string>
+#include "glut.hpp"
+#include "world.hpp"
+
+/**
+ * @brief The time that passes between two frames of a headless run, in
+ * seconds, so the animations are in the same place on every run
+*/
+#define HEADLESS_FRAME_TIME (1.0f / 60)
+
+/**
+ * @brief An OpenGL context without a window, made current on creation,
+ * drawing into a framebuffer object with a color and a depth buffer
+ *
+ * The context is created with EGL, on the surfaceless platform of Mesa if it
+ * has one, so it works without a display server, Mesa's software rasterizer
+ * (llvmpipe) included.
+*/
+class HeadlessContext {
+public:
+  /**
+   * @brief Creates the context, makes it current and binds the framebuffer
+   *
+   * @param width  the width of the framebuffer
+   * @param height the height of the framebuffer
+   *
+   * @throws std::runtime_error if the context or the framebuffer can't be created
+  */
+  HeadlessContext(int width, int height);
+
+  /**
+   * @brief Deletes the framebuffer and destroys the context
+  */
+  ~HeadlessContext();
+
+  HeadlessContext(const HeadlessContext&) = delete;
+  HeadlessContext& operator =(const HeadlessContext&) = delete;
+
+  /**
+   * @brief Returns the name of the renderer GL draws with
+  */
+  std::string renderer() const;
+
+private:
+  /**
+   * @brief Deletes whatever of the framebuffer and the context was created
+  */
+  void destroy();
+
+  void* display; ///< The EGL display, kept opaque so EGL's headers stay in headless.cpp
+  void* context; ///< The EGL context
+  GLuint framebuffer;
+  GLuint colorBuffer;
+  GLuint depthBuffer;
+};
+
+/**
+ * @brief Renders a fixed number of frames of a world into a headless
+ * context, at HEADLESS_FRAME_TIME apart, and writes their timings and what
+ * was drawn as JSON
+ *
+ * Each frame is timed from its start until GL finishes drawing it. The JSON
+ * has the percentiles of the frame times, in milliseconds, the median CPU
+ * and GPU time of each stage (see #Profiler), and the mean per frame of the
+ * draw calls, triangles, state changes and culled models and groups.
+ * Bezier patches are tessellated synchronously (see
+ * PatchTessellator::setSynchronous), so every run draws the same frames.
+ *
+ * @param world  the world to render, not yet initialized
+ * @param scene  the path of the world's configuration file, for the report
+ * @param frames the number of frames to render, at least 1
+ * @param width  the width of the framebuffer
+ * @param height the height of the framebuffer
+ * @param out    where to write the JSON
+ *
+ * @throws std::invalid_argument if there are no frames to render
+ * @throws std::runtime_error if the context can't be created
+*/
+void runHeadless(World& world, const std::string& scene, int frames, int width, int height, std::ostream& out);
@@ -0,0 +1,93 @@
+#pragma once
+
+/**
+ * @file instancing.hpp
+ * @brief File defining the @link InstanceRenderer class, which draws every
+ * copy of a model that shares its shape, texture and material with a single
+ * instanced draw call
+*/
+
+#include <vector>
+#include "glut.hpp"
+#include "matrix.hpp"
+#include "model.hpp"
+
+/**
+ * @brief The first of the 4 generic vertex attributes holding the modelview
+ * matrix of each instance. Chosen not to alias the fixed-function attributes
+ * the shapes use (position, normal and the first texture coordinates)
+*/
+#define INSTANCE_ATTRIBUTE 12
+
+/**
+ * @brief The number of GL lights the instancing shader lights the models with
+*/
+#define INSTANCE_LIGHTS 8
+
+/**
+ * @brief Draws batches of instances of models with a shader that reproduces
+ * the fixed-function lighting (per vertex, with GL's lights and the material
+ * set with glMaterial) and texturing, reading the modelview matrix of each
+ * instance from a vertex attribute instead of GL's matrix
+ *
+ * The matrices of all the instances of a frame are uploaded together, row
+ * major as #MatrixStack keeps them, and each batch draws a contiguous range
+ * of them.
+*/
+class InstanceRenderer {
+public:
+  InstanceRenderer();
+
+  /**
+   * @brief Deletes the shader and the instance buffer
+  */
+  ~InstanceRenderer();
+
+  InstanceRenderer(const InstanceRenderer&) = delete;
+  InstanceRenderer& operator =(const InstanceRenderer&) = delete;
+
+  /**
+   * @brief Compiles the shader and creates the instance buffer. Does nothing
+   * if the GL context can't draw instances (see #available)
+   *
+   * @throws std::runtime_error if the shader fails to compile or link
+  */
+  void initialize();
+
+  /**
+   * @brief Returns whether the instances can be drawn, i.e. whether
+   * #initialize was called with a context supporting OpenGL 3.3
+  */
+  bool available() const;
+
+  /**
+   * @brief Uploads the modelview matrices of the instances of a frame and
+   * starts drawing with the shader. The projection matrix, lights and
+   * material are the ones set in GL
+   *
+   * @param modelviews the modelview matrix of each instance
+  */
+  void begin(const std::vector<Mat4>& modelviews);
+
+  /**
+   * @brief Draws a model once for each of a range of the instances given to
+   * #begin, at the level of detail chosen for it. Its shape, texture and
+   * material must already be bound (see #RenderQueue)
+   *
+   * @param model the model
+   * @param first the first instance
+   * @param count the number of instances
+  */
+  void draw(const Model& model, size_t first, size_t count);
+
+  /**
+   * @brief Stops drawing with the shader, going back to the fixed-function pipeline
+  */
+  void end();
+
+private:
+  GLuint program;
+  GLuint instanceBuffer;
+  GLint lightsLocation;   ///< The location of the uniform with which lights are enabled
+  GLint texturedLocation; ///< The location of the uniform with whether the model is textured
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+/**
+ * @file jobsystem.hpp
+ * @brief File defining the @link JobSystem class, a pool of threads that
+ * split loops between them by work stealing
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The body of a parallel loop: runs the iterations in [begin, end)
+*/
+typedef std::function<void(size_t begin, size_t end)> JobBody;
+
+/**
+ * @brief A pool of worker threads running the iterations of parallel loops
+ *
+ * Each thread (the one calling #parallelFor included) has its own queue of
+ * ranges of iterations. A thread takes the range it pushed last, halving it
+ * (and pushing the other half) until it's small enough to run. A thread with
+ * an empty queue steals the oldest (and so largest) range of another one, so
+ * the work is balanced even when the iterations cost different amounts.
+*/
+class JobSystem {
+public:
+  /**
+   * @brief Starts the worker threads
+   *
+   * @param threads the number of threads running the loops, counting the one
+   * calling #parallelFor. If 0, one per hardware thread
+  */
+  JobSystem(unsigned int threads = 0);
+
+  /**
+   * @brief Stops the worker threads, once they finish what they are running
+  */
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator =(const JobSystem&) = delete;
+
+  /**
+   * @brief Returns the number of threads running the loops, counting the one
+   * calling #parallelFor
+  */
+  unsigned int threadCount() const;
+
+  /**
+   * @brief Runs @p body over the iterations [0, count), split in ranges of
+   * at most @p grain iterations, and waits for all of them to finish
+   *
+   * Must only be called from one thread at a time, and not from a body.
+  */
+  void parallelFor(size_t count, size_t grain, const JobBody& body);
+
+private:
+  /**
+   * @brief A range of iterations of the loop being run
+  */
+  struct Job {
+    size_t begin, end;
+  };
+
+  /**
+   * @brief The queue of ranges of a thread. Its owner pushes and takes at the
+   * back, while the others steal from the front
+  */
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  /**
+   * @brief Takes a range from the queue of the given thread, or steals one
+   *
+   * @return whether a range was found
+  */
+  bool take(unsigned int thread, Job& job);
+
+  /**
+   * @brief Runs a range of iterations, pushing halves of it to the queue of
+   * the given thread while it's larger than the grain
+  */
+  void run(unsigned int thread, Job job);
+
+  void workerLoop(unsigned int thread);
+
+  std::vector<std::unique_ptr<Queue>> queues; ///< The queue of each thread, the caller's first
+  std::vector<std::thread> workers;
+
+  const JobBody* body = nullptr; ///< The body of the loop being run
+  size_t grain = 1;
+  std::atomic<size_t> remaining{0}; ///< The iterations of the loop not run yet
+  std::atomic<size_t> queued{0};    ///< The ranges in the queues
+
+  std::mutex sleepMutex;
+  std::condition_variable wake; ///< Signaled when ranges are pushed, or the workers must stop
+  bool stopping = false;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * @file mappedfile.hpp
+ * @brief File declaring the #MappedFile class, a read-only memory mapping of a file
+*/
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * The contents of the file are paged in by the operating system on demand, so
+ * mapping a file is cheap regardless of its size. The mapping is released when
+ * the object is destroyed, invalidating any pointer obtained through #data.
+*/
+class MappedFile {
+public:
+  /**
+   * @brief Maps the given file into memory
+   *
+   * @param filePath the path of the file to map
+   *
+   * @throws std::runtime_error if the file can't be opened or mapped
+  */
+  explicit MappedFile(std::string filePath);
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * @brief Destructor (unmaps the file)
+  */
+  ~MappedFile();
+
+  /**
+   * @brief Returns a pointer to the first byte of the file
+  */
+  const unsigned char* data() const;
+
+  /**
+   * @brief Returns the size of the file, in bytes
+  */
+  size_t size() const;
+
+private:
+  /**
+   * @brief The start of the mapping
+  */
+  const unsigned char* bytes;
+
+  /**
+   * @brief The length of the mapping, in bytes
+  */
+  size_t length;
+
+#ifdef _WIN32
+  void* file;    ///< The handle of the open file
+  void* mapping; ///< The handle of the file mapping object
+#endif
+};
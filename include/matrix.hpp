@@ -0,0 +1,134 @@
+#pragma once
+
+/**
+ * @file matrix.hpp
+ * @brief File defining #Mat, a matrix with its size fixed at compile time, and
+ * its (inline) arithmetic
+ *
+ * The generic operations are constexpr and work for any element types with
+ * the needed operators (e.g. a matrix of #Point times a matrix of floats). The
+ * products of 4x4 float matrices with 4x4 matrices and 4D vectors have SSE
+ * versions, which do the same floating point operations in the same order as
+ * the generic ones, so both give bit-identical results.
+*/
+
+#include <cstddef>
+#include <utility>
+#include "vecmath.hpp"
+
+/**
+ * @brief A matrix of R rows and C columns, stored in row-major order
+ *
+ * It's an aggregate, so it can be initialized from its values in row-major
+ * order, e.g. <tt>Mat<2,2> m = { 1, 2, 3, 4 };</tt>. Its values are zero (the
+ * value-initialized T) otherwise.
+*/
+template <size_t R, size_t C, typename T = float> struct alignas(16) Mat {
+  T values[R * C] = {};
+
+  constexpr T& operator ()(size_t row, size_t col) { return values[row * C + col]; }
+  constexpr const T& operator ()(size_t row, size_t col) const { return values[row * C + col]; }
+
+  /**
+   * @brief Returns a pointer to the values, in row-major order
+  */
+  constexpr T* data() { return values; }
+  constexpr const T* data() const { return values; }
+};
+
+typedef Mat<4, 4> Mat4; ///< A 4x4 matrix of floats
+typedef Mat<4, 1> ColVec4; ///< A column vector of 4 floats
+typedef Mat<1, 4> RowVec4; ///< A row vector of 4 floats
+
+/**
+ * @brief Returns the N by N identity matrix
+*/
+template <size_t N, typename T = float> constexpr Mat<N, N, T> identity() {
+  Mat<N, N, T> ans;
+  for (size_t i = 0; i < N; i++)
+    ans(i, i) = 1;
+  return ans;
+}
+
+/**
+ * @brief Returns the transpose of a matrix
+*/
+template <size_t R, size_t C, typename T> constexpr Mat<C, R, T> transpose(const Mat<R, C, T>& a) {
+  Mat<C, R, T> ans;
+  for (size_t y = 0; y < R; y++)
+    for (size_t x = 0; x < C; x++)
+      ans(x, y) = a(y, x);
+  return ans;
+}
+
+/**
+ * @brief Multiplies two matrices
+ *
+ * It requires the product (* operator) to be defined for the types of the
+ * elements, as well as addition (+ operator) for the type of the result. The
+ * elements of the result are accumulated from their value-initialized value.
+ *
+ * @param a A matrix with R rows and K columns
+ * @param b A matrix with K rows and C columns
+ * @return The R by C product
+*/
+template <size_t R, size_t K, size_t C, typename A, typename B>
+constexpr auto operator *(const Mat<R, K, A>& a, const Mat<K, C, B>& b)
+  -> Mat<R, C, decltype(std::declval<A>() * std::declval<B>())> {
+
+  typedef decltype(std::declval<A>() * std::declval<B>()) U;
+  Mat<R, C, U> c;
+  for (size_t y = 0; y < R; y++) {
+    for (size_t x = 0; x < C; x++) {
+      U sum = U{};
+      for (size_t i = 0; i < K; i++)
+        sum = sum + a(y, i) * b(i, x);
+      c(y, x) = sum;
+    }
+  }
+  return c;
+}
+
+#ifdef VECMATH_SSE
+
+/**
+ * @brief Multiplies a row of 4 values by a 4x4 matrix whose rows are given
+ * as SSE registers
+*/
+inline __m128 rowTimesMatrix(const float* row, const __m128 rows[4]) {
+  __m128 r = _mm_setzero_ps();
+  for (int i = 0; i < 4; i++)
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(row[i]), rows[i]));
+  return r;
+}
+
+inline Mat4 operator *(const Mat4& a, const Mat4& b) {
+  const __m128 rows[4] = { _mm_load_ps(&b.values[0]), _mm_load_ps(&b.values[4]),
+                           _mm_load_ps(&b.values[8]), _mm_load_ps(&b.values[12]) };
+  Mat4 c;
+  for (int y = 0; y < 4; y++)
+    _mm_store_ps(&c.values[4 * y], rowTimesMatrix(&a.values[4 * y], rows));
+  return c;
+}
+
+inline RowVec4 operator *(const RowVec4& v, const Mat4& a) {
+  const __m128 rows[4] = { _mm_load_ps(&a.values[0]), _mm_load_ps(&a.values[4]),
+                           _mm_load_ps(&a.values[8]), _mm_load_ps(&a.values[12]) };
+  RowVec4 ans;
+  _mm_store_ps(ans.values, rowTimesMatrix(v.values, rows));
+  return ans;
+}
+
+inline ColVec4 operator *(const Mat4& a, const ColVec4& v) {
+  //with the columns of a in registers, a * v = v0 * col0 + v1 * col1 + ...
+  __m128 c0 = _mm_load_ps(&a.values[0]), c1 = _mm_load_ps(&a.values[4]);
+  __m128 c2 = _mm_load_ps(&a.values[8]), c3 = _mm_load_ps(&a.values[12]);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+  const __m128 columns[4] = { c0, c1, c2, c3 };
+  ColVec4 ans;
+  _mm_store_ps(ans.values, rowTimesMatrix(v.values, columns));
+  return ans;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+/**
+ * @file matrixstack.hpp
+ * @brief File defining the @link MatrixStack class, which keeps the modelview
+ * matrix on the CPU while the scene is traversed
+*/
+
+#include <vector>
+#include "geometry.hpp"
+#include "matrix.hpp"
+
+/**
+ * @brief A stack of row-major matrices, whose top is transformed the same way
+ * glTranslatef, glRotatef, glScalef and glMultMatrixf transform GL's current
+ * matrix (each multiplies it on the right)
+ *
+ * The modelview matrix is then known without reading it back from GL, which
+ * waits for the commands before it to be processed. It is only given to GL
+ * (with #upload) before something is drawn with it.
+*/
+class MatrixStack {
+public:
+  /**
+   * @brief Creates a stack with the identity matrix
+  */
+  MatrixStack();
+
+  /**
+   * @brief Returns the current matrix
+  */
+  const Mat4& top() const;
+
+  /**
+   * @brief Saves the current matrix, like glPushMatrix
+  */
+  void push();
+
+  /**
+   * @brief Restores the matrix saved last, like glPopMatrix
+  */
+  void pop();
+
+  /**
+   * @brief Replaces the current matrix
+  */
+  void load(const Mat4& m);
+
+  /**
+   * @brief Multiplies the current matrix by @p m on the right
+  */
+  void multiply(const Mat4& m);
+
+  void translate(float x, float y, float z);
+
+  /**
+   * @brief Rotates @p angle degrees around the axis (x, y, z), counterclockwise
+   * when looking against it. Does nothing if the axis is zero
+  */
+  void rotate(float angle, float x, float y, float z);
+
+  void scale(float x, float y, float z);
+
+  /**
+   * @brief Replaces the current matrix with the view matrix of gluLookAt
+  */
+  void lookAt(const Point& eye, const Point& center, const Vector& up);
+
+  /**
+   * @brief Loads the current matrix into GL's current (modelview) matrix
+  */
+  void upload() const;
+
+private:
+  std::vector<Mat4> matrices; ///< The saved matrices, with the current one last
+};
+
+/**
+ * @brief Loads a row-major matrix into GL's current (modelview) matrix
+*/
+void loadMatrix(const Mat4& m);
@@ -0,0 +1,77 @@
+#pragma once
+
+/**
+ * @file meshoptimizer.hpp
+ * @brief File declaring the functions used to reorder the triangles and
+ * vertices of an indexed mesh for faster rendering
+ *
+ * The triangles are given as a list of vertex indices, 3 per triangle.
+*/
+
+#include <vector>
+#include "geometry.hpp"
+
+/**
+ * @brief The size of the (FIFO) post-transform vertex cache the triangles are
+ * optimized for, and the ACMR is measured with
+*/
+#define VERTEX_CACHE_SIZE 16
+
+/**
+ * @brief Returns the average cache miss ratio (the number of vertices
+ * transformed per triangle, between 0.5 and 3) of drawing the given triangles
+ * with a FIFO vertex cache of the given size
+ *
+ * @param indices     the vertices of the triangles
+ * @param vertexCount the number of vertices
+ * @param cacheSize   the number of entries of the cache
+*/
+float vertexCacheACMR(const std::vector<int>& indices, size_t vertexCount,
+                      unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+/**
+ * @brief Reorders the triangles for post-transform vertex cache reuse, using
+ * Tipsify (Sander et al., "Fast Triangle Reordering for Vertex Locality and
+ * Reduced Overdraw", 2007)
+ *
+ * Triangles are emitted in fans around a vertex, moving on to the vertex
+ * (of the last fan) that will remain in the cache for all its triangles.
+ *
+ * @param indices     the vertices of the triangles, reordered in place
+ * @param vertexCount the number of vertices
+ * @param cacheSize   the number of entries of the cache
+ *
+ * @return the first triangle of each cluster: the points where the order had
+ * to jump to a vertex that isn't adjacent to the last fan
+*/
+std::vector<int> optimizeVertexCache(std::vector<int>& indices, size_t vertexCount,
+                                     unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+/**
+ * @brief Reorders clusters of triangles (as ordered by #optimizeVertexCache) so
+ * that the ones facing away from the center of the mesh are drawn first,
+ * occluding the rest
+ *
+ * The clusters are first split where that keeps the ACMR of each one within
+ * @p threshold times the ACMR of the whole cluster. Since sorting the clusters
+ * also costs the cache reuse across them, the triangles are left as they are
+ * when the ACMR of the result exceeds @p threshold times the one they had.
+ *
+ * @param indices   the vertices of the triangles, reordered in place
+ * @param points    the positions of the vertices
+ * @param clusters  the first triangle of each cluster
+ * @param threshold how much worse the ACMR may get to split the clusters
+*/
+void optimizeOverdraw(std::vector<int>& indices, const std::vector<Point>& points,
+                      const std::vector<int>& clusters, float threshold = 1.05f);
+
+/**
+ * @brief Renumbers the vertices in the order they are first used by the
+ * triangles, so they are fetched sequentially. Unused vertices go last
+ *
+ * @param indices     the vertices of the triangles, renumbered in place
+ * @param vertexCount the number of vertices
+ *
+ * @return the new index of each vertex
+*/
+std::vector<int> optimizeVertexFetch(std::vector<int>& indices, size_t vertexCount);
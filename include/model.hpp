@@ -6,9 +6,72 @@
 */
 
 #include "parser.hpp"
+#include "patchtessellator.hpp"
 #include "shape.hpp"
 #include "texture.hpp"
 
+/**
+ * @brief The error, in pixels, that the level of detail of a model may have
+ * on the screen (with no bias)
+*/
+#define LOD_PIXEL_ERROR 1.0f
+
+/**
+ * @brief How much further past #LOD_PIXEL_ERROR the error of a model must go
+ * for its level of detail to change, as a fraction of it. Keeps the levels of
+ * models around the switching distance from flickering
+*/
+#define LOD_HYSTERESIS 0.25f
+
+/**
+ * @brief The state of the frame needed to draw the models
+*/
+struct DrawContext {
+  Frustum viewFrustum; ///< The view frustum, in eye coordinates
+  float screenScale;   ///< The size of a unit at unit distance, in pixels (see Camera::screenScale)
+  float lodBias;       ///< Multiplies the error allowed on the screen by 2^lodBias
+};
+
+/**
+ * @brief The counts of what was culled, and of the GL calls made, while
+ * drawing a frame
+*/
+struct DrawStats {
+  int culledModels = 0; ///< The models outside the view frustum, including the ones in culled groups
+  int culledGroups = 0; ///< The groups whose whole subtree was outside the view frustum
+
+  int drawCalls = 0;       ///< The draw calls made for the models
+  long triangles = 0;      ///< The triangles drawn for the models, at their levels of detail
+  int shapeChanges = 0;    ///< The times the buffers of a different shape were bound
+  int textureChanges = 0;  ///< The times a different texture (or none) was bound
+  int materialChanges = 0; ///< The times a different material was set
+};
+
+/**
+ * @brief The colors a model is lit with, in RGB
+ *
+ * The values range from [0-1]. 1 corresponds to all of that color
+ * (255) and 0 to no color (0).
+*/
+struct Material {
+  Color emission;
+  Color ambient;
+  Color diffuse;
+  Color specular;
+  float shininess;
+
+  /**
+   * @brief Sets the material of the front faces in GL
+  */
+  void apply() const;
+
+  /**
+   * @brief Orders materials by their values, so equal ones can be grouped
+  */
+  bool operator <(const Material& material) const;
+  bool operator ==(const Material& material) const;
+};
+
 /**
  * @brief Represents a model that gets rendered into the world
  *
@@ -22,23 +85,45 @@ private:
   std::shared_ptr<Texture> texture;
 
   /**
-   * @brief The colors of the model in RGB.
-   * 
-   * The values range from [0-1]. 1 corresponds to all of that color
-   * (255) and 0 to no color (0).
-   * 
-   * 0 -> the red part of the color
-   * 1 -> the green part of the color
-   * 2 -> the blue part of the color
+   * @brief The colors of the model
   */
-  Color emission;
-  Color ambient;
-  Color diffuse;
-  Color specular;
-  float shininess;
+  Material material;
+
+  /**
+   * @brief The level of detail of the shape drawn last
+  */
+  size_t lod = 0;
+
+  /**
+   * @brief The tessellations of the Bezier patches of the model, if its
+   * shape is tessellated at the level its size on the screen asks for
+  */
+  std::shared_ptr<PatchTessellator> tessellator;
+
+  /**
+   * @brief The level of tessellation chosen by the last call to #selectLevels
+  */
+  size_t tessellationLevel = 0;
 
   void readColor(XMLParser color);
 
+  /**
+   * @brief Chooses the coarsest level of detail of the shape whose error on
+   * the screen is within the one allowed, with hysteresis around the level
+   * drawn last
+   *
+   * @param context   the context of the frame
+   * @param modelview the modelview matrix
+   * @param bb        the bounding box of the shape, in eye coordinates
+  */
+  void selectLOD(const DrawContext& context, const Mat4& modelview, const BoundingBox& bb);
+
+  /**
+   * @brief Chooses the coarsest level of tessellation of the model's patches
+   * whose error on the screen is within the one allowed, like #selectLOD
+  */
+  void selectTessellation(const DrawContext& context, const Mat4& modelview, const BoundingBox& bb);
+
 public:
   /**
    * @brief Constructs a new Model object from a given Shape, Texture and Colors
@@ -49,8 +134,54 @@ public:
   Model(XMLParser parser);
 
   /**
-   * @brief Draws the model by calling glut's static functions
+   * @brief Returns the bounding box of the model's shape in eye coordinates,
+   * to be tested against the view frustum
    *
+   * @param modelview the modelview matrix
+   */
+  BoundingBox getBoundingBox(const Mat4& modelview) const;
+
+  /**
+   * @brief Chooses the level of detail of the model's shape (and the level
+   * of tessellation of its patches) that fits its size on the screen
+   *
+   * Only changes the model itself, so different models can be updated from
+   * different threads.
+   *
+   * @param context   the context of the frame
+   * @param modelview the modelview matrix
+   * @param bb        the bounding box of the model in eye coordinates (see #getBoundingBox)
+   */
+  void selectLevels(const DrawContext& context, const Mat4& modelview, const BoundingBox& bb);
+
+  /**
+   * @brief Draws the model by calling glut's static functions, at the level of
+   * detail chosen by #selectLevels. The modelview matrix must already be loaded into GL
+   */
+  void draw() const;
+
+  /**
+   * @brief Swaps in the shape of the level of tessellation chosen by #selectLevels,
+   * if it's been tessellated, asking for it otherwise. Does nothing for the
+   * models that aren't tessellated at runtime. Must be called with the GL
+   * context current
+   *
+   * @return whether the shape of the model changed
+   */
+  bool updateTessellation();
+
+  const Shape* getShape() const;
+  const Texture* getTexture() const;
+  const Material& getMaterial() const;
+
+  /**
+   * @brief Returns the level of detail chosen by the last call to #selectLevels
+   */
+  size_t getLOD() const;
+
+  /**
+   * @brief Returns a sphere containing the model, in the coordinates of its
+   * group, at any of its levels of tessellation
    */
-  int draw(const Frustum& viewFrustum);
+  BoundingSphere getBound() const;
 };
@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+ * @file patchtessellator.hpp
+ * @brief File defining the @link PatchTessellator class, which tessellates
+ * the Bezier patches of a file at the levels the models using them ask for,
+ * on a thread of its own
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "shape.hpp"
+
+/**
+ * @brief The segments along each side of a patch at the finest level of
+ * tessellation. Each coarser level has half the segments of the one before,
+ * down to a single one (a power of 2)
+*/
+#define PATCH_MAX_SEGMENTS 64
+
+/**
+ * @brief The tessellations of the Bezier patches of a file, at levels from
+ * #PATCH_MAX_SEGMENTS segments along each side of a patch (level 0) down to
+ * one, like the levels of detail of a shape
+ *
+ * The control points are read once, and the error of every level computed
+ * up front, so a model can choose its level (see Model::selectLevels)
+ * before it's tessellated. The coarsest level is tessellated right away, to
+ * be drawn until then. The others are tessellated when first asked for, in
+ * the order they were asked for, by a worker thread that only builds the
+ * shapes: they are uploaded to GL by #collect, on the thread drawing them.
+*/
+class PatchTessellator {
+public:
+  static std::shared_ptr<PatchTessellator> fetchTessellator(std::string filePath);
+  static void clearCache();
+
+  /**
+   * @brief Sets whether the levels are tessellated and uploaded by #level
+   * itself, on the thread asking for them, instead of on the worker thread.
+   * The levels drawn then don't depend on how long the worker takes, so
+   * headless runs draw the same frames every time
+  */
+  static void setSynchronous(bool synchronous);
+
+  /**
+   * @brief Reads the patches of a file, tessellates the coarsest level and
+   * starts the worker thread
+   *
+   * @param filePath the path of the patch file (see #readBezierPatchFile)
+  */
+  PatchTessellator(std::string filePath);
+
+  /**
+   * @brief Stops the worker thread, once it finishes the level it's tessellating
+  */
+  ~PatchTessellator();
+
+  PatchTessellator(const PatchTessellator&) = delete;
+  PatchTessellator& operator =(const PatchTessellator&) = delete;
+
+  /**
+   * @brief Returns the number of levels of tessellation
+  */
+  size_t levelCount() const;
+
+  /**
+   * @brief Returns the number of samples along each side of a patch at a level
+  */
+  int levelDivisions(size_t level) const;
+
+  /**
+   * @brief Returns how far the tessellation at a level is from the patches
+   * (see #bezierTessellationError)
+  */
+  float levelError(size_t level) const;
+
+  /**
+   * @brief Returns the tessellation at a level, if it was uploaded by
+   * #collect, or asks the worker thread for it and returns null (see
+   * #setSynchronous). Must be called with the GL context current
+  */
+  std::shared_ptr<Shape> level(size_t level);
+
+  /**
+   * @brief Returns the tessellation at the coarsest level, which is uploaded
+   * by the first call to #collect
+  */
+  std::shared_ptr<Shape> coarsestLevel() const;
+
+  /**
+   * @brief Returns the bounding box of the control points of the patches,
+   * which contains every level (by the convex hull property of Bezier patches)
+  */
+  BoundingBox getBoundingBox() const;
+
+  /**
+   * @brief Uploads the levels the worker thread finished tessellating since
+   * the last call. Must be called with the GL context current
+  */
+  void collect();
+
+private:
+  void workerLoop();
+
+  std::vector<Point> controlPoints;
+  std::vector<int[16]> patches;
+  std::vector<float> errors; ///< The error of each level
+  BoundingBox hull;          ///< The bounding box of the control points of the patches
+
+  //only used by the thread drawing the shapes
+  std::vector<std::shared_ptr<Shape>> levels; ///< The uploaded tessellation of each level, if any
+  std::shared_ptr<Shape> coarsest;            ///< The tessellation of the coarsest level
+  std::vector<uint8_t> requested;             ///< Whether each level was asked for
+
+  std::mutex mutex;
+  std::condition_variable wake;    ///< Signaled when levels are asked for, or the worker must stop
+  std::deque<size_t> pending;      ///< The levels asked for and not yet tessellated
+  std::vector<std::pair<size_t, std::shared_ptr<Shape>>> finished; ///< The levels tessellated and not yet uploaded
+  std::atomic<bool> hasFinished{false}; ///< Whether #finished has levels, checked without locking
+  bool stopping = false;
+  std::thread worker;
+
+  /**
+   * @brief Cache of #PatchTessellator from file paths, so the models of the
+   * same file share their tessellations
+  */
+  static std::map<std::string, std::shared_ptr<PatchTessellator>> cache;
+
+  static bool synchronous; ///< See #setSynchronous
+};
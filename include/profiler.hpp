@@ -0,0 +1,168 @@
+#pragma once
+
+/**
+ * @file profiler.hpp
+ * @brief File defining the @link Profiler class, which times the stages of
+ * each frame on the CPU and the GPU and keeps the timings of the last frames
+*/
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "glut.hpp"
+#include "model.hpp"
+
+/**
+ * @brief The number of frames whose timings the profiler keeps
+*/
+#define PROFILER_FRAMES 1024
+
+/**
+ * @brief The number of frames after which the GPU timings of a frame are
+ * read, so reading them doesn't wait for the GPU to finish the frame
+*/
+#define PROFILER_LATENCY 4
+
+/**
+ * @brief The number of stages of a frame (see ProfileStage)
+*/
+#define PROFILE_STAGES 4
+
+/**
+ * @brief The stages a frame is timed in, in the order they run
+*/
+enum class ProfileStage {
+  Camera,   ///< Clearing the buffers and setting the view
+  Lighting, ///< Setting the lights, and drawing the axis
+  Update,   ///< Computing the matrices, culling and the draw list
+  Submit    ///< Drawing the traces and the models
+};
+
+/**
+ * @brief Returns the name of a stage, as written in the CSV and JSON files
+*/
+const char* profileStageName(ProfileStage stage);
+
+/**
+ * @brief The timings and draw stats of a frame, in milliseconds
+*/
+struct FrameProfile {
+  long frame;                  ///< The number of the frame, counted from the first profiled
+  float time;                  ///< The animation time of the frame, in seconds
+  double frameTime;            ///< The CPU time from the start to the end of the frame
+  double cpu[PROFILE_STAGES];  ///< The CPU time of each stage
+  double gpu[PROFILE_STAGES];  ///< The GPU time of each stage, negative if not measured (yet)
+  DrawStats stats;
+};
+
+/**
+ * @brief Times the stages of each frame, with a steady clock on the CPU and
+ * with GL_TIME_ELAPSED queries on the GPU, keeping the last
+ * #PROFILER_FRAMES frames in a ring buffer
+ *
+ * The GPU timings of a frame are read #PROFILER_LATENCY frames later, when
+ * its queries are reused, and are missing from the frames not yet read
+ * (see #flush). The GPU isn't timed if GL doesn't have timer queries.
+ *
+ * The stages must not be nested, since GL can only time one at a time.
+*/
+class Profiler {
+public:
+  Profiler();
+
+  /**
+   * @brief Deletes the queries
+  */
+  ~Profiler();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator =(const Profiler&) = delete;
+
+  /**
+   * @brief Times a stage, from its construction to its destruction
+  */
+  class Scope {
+  public:
+    Scope(Profiler& profiler, ProfileStage stage);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator =(const Scope&) = delete;
+
+  private:
+    Profiler& profiler;
+    ProfileStage stage;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  /**
+   * @brief Creates the timer queries, if the GL context has them (OpenGL 3.3
+   * or ARB_timer_query)
+  */
+  void initialize();
+
+  /**
+   * @brief Starts a frame, reading the GPU timings of the frame whose
+   * queries it reuses
+   *
+   * @param time the animation time of the frame
+  */
+  void beginFrame(float time);
+
+  /**
+   * @brief Ends the frame started with #beginFrame
+   *
+   * @param stats what the frame culled and drew
+  */
+  void endFrame(const DrawStats& stats);
+
+  /**
+   * @brief Waits for the GPU timings of the frames not yet read, and reads them
+  */
+  void flush();
+
+  /**
+   * @brief Returns the number of frames kept, at most #PROFILER_FRAMES
+  */
+  size_t frameCount() const;
+
+  /**
+   * @brief Returns a frame kept, the oldest being 0
+  */
+  const FrameProfile& frame(size_t i) const;
+
+  /**
+   * @brief Writes the frames kept as CSV, a row per frame, with empty cells
+   * for the GPU timings not measured
+  */
+  void writeCSV(std::ostream& out) const;
+
+  /**
+   * @brief Writes the frames kept as JSON, with null for the GPU timings not
+   * measured
+  */
+  void writeJSON(std::ostream& out) const;
+
+  /**
+   * @brief Writes the frames kept to a file, as CSV if its extension is
+   * .csv and as JSON otherwise
+   *
+   * @throws std::runtime_error if the file can't be written
+  */
+  void write(const std::string& path) const;
+
+private:
+  /**
+   * @brief Reads the GPU timings of the frame that last used a slot of queries
+  */
+  void readQueries(size_t slot);
+
+  std::vector<FrameProfile> frames; ///< The ring buffer of frames
+  long frameNumber = -1;            ///< The number of the current frame
+  std::chrono::steady_clock::time_point frameStart;
+
+  std::vector<GLuint> queries;      ///< The queries of each stage of each of the last #PROFILER_LATENCY frames
+  std::vector<uint8_t> issued;      ///< Whether each query was issued by its frame
+  std::vector<long> queryFrames;    ///< The frame each slot of queries was last used by, -1 if none
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * @file renderqueue.hpp
+ * @brief File defining the @link RenderQueue class, which submits the models
+ * of a frame sorted by the GL state they need
+*/
+
+#include <cstdint>
+#include <vector>
+#include "instancing.hpp"
+#include "matrix.hpp"
+#include "model.hpp"
+
+/**
+ * @brief A model to draw, with the group whose modelview matrix it's drawn with
+*/
+struct DrawItem {
+  const Model* model;
+  size_t node;   ///< The index of the group in the flattened scene
+  size_t bucket; ///< The bucket of the model's state (see RenderQueue::bucket)
+};
+
+/**
+ * @brief Submits the models of a frame grouped by the state they are drawn
+ * with, so each shape, texture and material is bound once for all the
+ * models sharing it
+ *
+ * Each combination of shape, texture, material and level of detail of the
+ * models is a bucket, numbered in that order of the keys, so sorting the
+ * models by bucket sorts them by state (the shape changing least often).
+ *
+ * The models with a translucent texture are drawn last, blended, from the
+ * back to the front, since they can't be drawn in the order of their state.
+*/
+class RenderQueue {
+public:
+  RenderQueue();
+
+  /**
+   * @brief Numbers the buckets of the given models
+   *
+   * @param models the models that will be drawn
+  */
+  RenderQueue(const std::vector<Model*>& models);
+
+  /**
+   * @brief Returns the bucket of a model at a level of detail
+   *
+   * @param model the index of the model, in the models given to the constructor
+   * @param lod   the level of detail
+  */
+  size_t bucket(size_t model, size_t lod) const;
+
+  /**
+   * @brief Draws the models of a frame. GL's modelview matrix is replaced
+   *
+   * The models of a bucket are drawn with a single instanced draw call if
+   * @p renderer is available, and one at a time otherwise.
+   *
+   * @param items    the models to draw
+   * @param matrices the modelview matrix of each group (see DrawItem::node)
+   * @param renderer the renderer of the instances
+   * @param stats    where to count the draw calls and state changes
+  */
+  void submit(const std::vector<DrawItem>& items, const std::vector<Mat4>& matrices,
+              InstanceRenderer& renderer, DrawStats& stats);
+
+private:
+  /**
+   * @brief Binds the shape, texture and material of a model that differ from
+   * the ones bound last
+  */
+  void bind(const Model& model, DrawStats& stats);
+
+  /**
+   * @brief Draws a model with the state #bind set
+   *
+   * @param instance the index of the model's matrix in #instances
+  */
+  void draw(const Model& model, size_t instance, size_t count, InstanceRenderer& renderer, DrawStats& stats);
+
+  std::vector<size_t> firstBuckets; ///< The bucket of each model at level 0, whose other levels follow
+  std::vector<uint8_t> translucent; ///< Whether each bucket is drawn blended
+  size_t bucketCount = 0;
+
+  //the state bound last, during #submit
+  const Shape* shape;
+  const Texture* texture;
+  const Material* material;
+  bool textureBound;
+  size_t loadedNode;
+
+  //the items of the frame, reused between frames
+  std::vector<size_t> bucketStarts; ///< The first item of each bucket, and the number of opaque items
+  std::vector<size_t> order;        ///< The indices of the opaque items sorted by bucket, then of the translucent ones back to front
+  std::vector<std::pair<float, size_t>> blended; ///< The depth and index of each translucent item
+  std::vector<Mat4> instances;      ///< The modelview matrix of each item, in order
+  std::vector<size_t> nodes;        ///< The group of each item, in order
+};
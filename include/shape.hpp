@@ -4,16 +4,129 @@
  * @brief File defining the @link Shape class
  */
 #pragma once
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
 #include <geometry.hpp>
+#include "mappedfile.hpp"
 #include "utils.hpp"
 #include "glut.hpp"
 
 typedef std::tuple<int,int,int> TriangleByPosition;
 
+/**
+ * @brief The magic bytes at the start of every binary 3D file
+*/
+#define SHAPE_FILE_MAGIC "CG3D"
+
+/**
+ * @brief The current version of the binary 3D file format
+*/
+#define SHAPE_FILE_VERSION 2
+
+/**
+ * @brief The directory where the Bezier patches tessellated by
+ * Shape::fetchPatchShape are cached, as binary 3D files
+*/
+#define PATCH_CACHE_DIRECTORY ".cache/patches"
+
+/**
+ * @brief The version of the tessellation of Bezier patches, part of the key
+ * of the cached ones so changing it invalidates them
+*/
+#define PATCH_CACHE_VERSION 1
+
+/**
+ * @brief The fraction of the triangles of the previous level of detail that
+ * each coarser level keeps, by default
+*/
+#define LOD_TRIANGLE_RATIO 0.25f
+
+/**
+ * @brief The largest error of a level of detail, relative to the size (the
+ * diagonal of the bounding box) of the shape
+*/
+#define LOD_MAX_ERROR 0.05f
+
+/**
+ * @brief The header of a binary 3D file.
+ *
+ * The header is followed by the vertex attributes and the triangles, each
+ * section starting at the given offset (in bytes, from the start of the file)
+ * and aligned to 16 bytes:
+ *
+ * - points:    vertexCount * 3 floats (x, y, z)
+ * - normals:   vertexCount * 3 floats (x, y, z)
+ * - textures:  vertexCount * 2 floats (u, v)
+ * - triangles: triangleCount * 3 uint32 (indices into the vertex attributes)
+ *
+ * An offset of zero means the section isn't present. All values are stored
+ * in little-endian byte order, so the sections can be used straight from a
+ * memory mapping of the file.
+ *
+ * Since version 2, the header is immediately followed by a table of lodCount
+ * #ShapeFileLOD, one per coarser level of detail, whose triangles are further
+ * sections indexing the same vertices. Version 1 files have no levels of detail.
+*/
+struct ShapeFileHeader {
+  char magic[4];          ///< Always #SHAPE_FILE_MAGIC
+  uint32_t version;       ///< The version of the format (#SHAPE_FILE_VERSION)
+  uint32_t vertexCount;   ///< The number of vertices
+  uint32_t triangleCount; ///< The number of triangles
+  float aabbMin[3];       ///< The minimum corner of the axis-aligned bounding box
+  float aabbMax[3];       ///< The maximum corner of the axis-aligned bounding box
+  uint32_t lodCount;      ///< The number of coarser levels of detail (zero in version 1)
+  uint32_t reserved;      ///< Unused, must be zero
+  uint64_t pointsOffset;    ///< Offset of the points section
+  uint64_t normalsOffset;   ///< Offset of the normals section
+  uint64_t texturesOffset;  ///< Offset of the texture coordinates section
+  uint64_t trianglesOffset; ///< Offset of the triangles section
+};
+
+static_assert(sizeof(ShapeFileHeader) == 80, "ShapeFileHeader must be tightly packed");
+
+/**
+ * @brief An entry of the level of detail table of a binary 3D file
+*/
+struct ShapeFileLOD {
+  uint32_t triangleCount;   ///< The number of triangles of the level
+  float error;              ///< The error of the level (see Simplifier::error)
+  uint64_t trianglesOffset; ///< Offset of the triangles section of the level
+};
+
+static_assert(sizeof(ShapeFileLOD) == 16, "ShapeFileLOD must be tightly packed");
+
+/**
+ * @brief A vertex of a shape, with its attributes interleaved as they are
+ * stored in the vertex buffer
+*/
+struct Vertex {
+  float position[3]; ///< The x, y, z coordinates of the vertex
+  float normal[3];   ///< The x, y, z coordinates of the normal
+  float texture[2];  ///< The u, v texture coordinates
+};
+
+/**
+ * @brief The attributes kept in the vertex buffer of a shape.
+ *
+ * Each layout is a prefix of #Vertex, so the stride of the buffer is the
+ * size of that prefix. The layouts are ordered from the least to the most
+ * attributes
+*/
+enum class VertexLayout {
+  Position,              ///< Only the positions
+  PositionNormal,        ///< The positions and the normals
+  PositionNormalTexture  ///< The positions, the normals and the texture coordinates
+};
+
+/**
+ * @brief Returns the size of a vertex, in bytes, in the given layout
+*/
+size_t vertexStride(VertexLayout layout);
+
 /**
  * @brief A class representing a shape in 3D space.
  *
@@ -23,6 +136,18 @@ typedef std::tuple<int,int,int> TriangleByPosition;
 class Shape {
 public:
   static std::shared_ptr<Shape> fetchShape(std::string filePath);
+
+  /**
+   * @brief Returns the shape of the Bezier patches of a file (see
+   * #generateBezierPatches), tessellated with the given divisions
+   *
+   * The tessellation is cached in #PATCH_CACHE_DIRECTORY, keyed by the hash
+   * of the file and the divisions, so it's only done the first time. If the
+   * cache can't be written the shape is still returned.
+   *
+   * @throws InvalidXMLStructure if the file doesn't exist
+  */
+  static std::shared_ptr<Shape> fetchPatchShape(std::string filePath, int divisions);
   static void clearCache();
   static void initShapes();
 
@@ -69,21 +194,88 @@ public:
   /**
    * @brief Exports the shape to a 3D file
    *
-   * The file follows the Wavefront .obj
-   * (https://en.wikipedia.org/wiki/Wavefront_.obj_file) file format
+   * The file is either written in the text format (the number of points
+   * followed by the points, normals and texture coordinates, and then the
+   * number of triangles followed by the triangles, and if the shape has
+   * coarser levels of detail, their number followed by the number of
+   * triangles, error and triangles of each) or in the binary format described
+   * by #ShapeFileHeader
    *
    * @param filePath the path of the file to write to
+   * @param binary   whether to use the binary format
    *
    * @return whether the operation was successful
    */
-  bool exportToFile(std::string filePath);
+  bool exportToFile(std::string filePath, bool binary = false);
 
   /**
-   * @brief Initializes the Shape's VBO
+   * @brief Initializes the Shape's VBOs.
+   *
+   * The welded vertices are uploaded once, with their attributes interleaved
+   * in a single buffer according to #vertexLayout, along with an element
+   * buffer with the indices of the vertices of each triangle, of every level
+   * of detail one after the other
    * 
    */
   void initialize();
 
+  /**
+   * @brief Sets the most attributes to keep in the vertex buffer. Must be
+   * called before #initialize to take effect.
+   *
+   * By default every attribute the shape has is kept
+   *
+   * @param layout the layout
+   */
+  void setVertexLayout(VertexLayout layout);
+
+  /**
+   * @brief Returns the layout of the vertex buffer: the one set through
+   * #setVertexLayout, without the attributes the shape doesn't have
+   */
+  VertexLayout vertexLayout() const;
+
+  /**
+   * @brief Reorders the triangles of the shape for post-transform vertex cache
+   * reuse and less overdraw, and then its vertices in the order they are first
+   * used (see meshoptimizer.hpp). Must be called before #initialize
+  */
+  void optimize();
+
+  /**
+   * @brief Returns the average cache miss ratio of drawing the shape, i.e. the
+   * number of vertices transformed per triangle (see #vertexCacheACMR)
+  */
+  float acmr() const;
+
+  /**
+   * @brief Replaces the levels of detail of the shape with coarser versions of
+   * it, simplified with a #Simplifier, each keeping @p ratio times the
+   * triangles of the previous one, within #LOD_MAX_ERROR. Levels that can't
+   * get halfway to that number of triangles aren't added
+   *
+   * @param levels the number of levels, including the full shape
+   * @param ratio  the fraction of the triangles kept by each level
+  */
+  void generateLODs(unsigned int levels, float ratio = LOD_TRIANGLE_RATIO);
+
+  /**
+   * @brief Returns the number of levels of detail of the shape, including the
+   * full shape (level 0)
+  */
+  size_t lodCount() const;
+
+  /**
+   * @brief Returns the number of triangles of a level of detail
+  */
+  size_t lodTriangleCount(size_t lod) const;
+
+  /**
+   * @brief Returns the error of a level of detail: how far its surface is from
+   * the one of the full shape (see Simplifier::error). Zero for level 0
+  */
+  float lodError(size_t lod) const;
+
   /**
    * @brief Returns a copy of the bounding box of the shape
    * 
@@ -95,17 +287,96 @@ public:
    * @brief Draws the shape by calling glut's static functions. No color or texture
    * is set, only the shape is drawn.
    * 
+   * @param lod the level of detail to draw (see #lodCount)
    */
-  void draw();
+  void draw(size_t lod = 0);
+
+  /**
+   * @brief Binds the buffers of the shape and points the vertex arrays at
+   * them, so it can be drawn any number of times with #drawBound, until
+   * #unbind is called
+   */
+  void bind() const;
+
+  /**
+   * @brief Draws the shape, which must be bound (see #bind)
+   *
+   * @param lod       the level of detail to draw (see #lodCount)
+   * @param instances the number of copies to draw. More than one are drawn
+   * with a single instanced draw call, left to a shader to tell apart
+   */
+  void drawBound(size_t lod, size_t instances = 1) const;
+
+  /**
+   * @brief Restores the vertex arrays #bind disabled, for the shapes bound next
+   */
+  void unbind() const;
 
 private:
   /**
    * @brief Constructs from the given file
+   *
+   * The format of the file (text or binary) is detected from its first bytes
    * 
    * @param filePath the path of the 3D file
   */
   Shape(std::string filePath);
 
+  /**
+   * @brief Reads the shape from a 3D file in the text format
+   *
+   * @param file the open file
+  */
+  void readTextFile(std::ifstream& file);
+
+  /**
+   * @brief Maps a 3D file in the binary format, pointing #mapped at its sections.
+   *
+   * @param filePath the path of the 3D file
+   *
+   * @throws If the file is malformed, an #InvalidXMLStructure exception
+   * is thrown
+  */
+  void mapBinaryFile(std::string filePath);
+
+  /**
+   * @brief Copies the data of a mapped binary file into the vectors of the
+   * shape and releases the mapping. Does nothing if the shape isn't mapped
+  */
+  void materialize();
+
+  /**
+   * @brief Welds the identical corners of a triangle soup (see #weldVertices)
+   * into the vectors of the shape
+   *
+   * @param corners      the vertices of the corners of the triangles
+   * @param withTextures whether to keep the texture coordinates of the corners
+  */
+  void weld(const std::vector<Vertex>& corners, bool withTextures);
+
+  /**
+   * @brief Returns the number of triangles of the shape
+  */
+  size_t triangleCount() const;
+
+  /**
+   * @brief Returns the number of vertices of the shape
+  */
+  size_t vertexCount() const;
+
+  /**
+   * @brief Returns the indices of the vertices of the triangles, 3 per triangle
+  */
+  std::vector<int> indexList() const;
+
+  /**
+   * @brief Returns the triangles of a level of detail of a mapped shape
+  */
+  const uint32_t* mappedTriangles(size_t lod) const;
+
+  bool writeTextFile(std::string filePath);
+  bool writeBinaryFile(std::string filePath);
+
 private:
   /**
    * @brief Cache of #Shape from file paths. Implemented to avoid reading from files multiple times
@@ -133,13 +404,67 @@ private:
   */
   BoundingBox boundingBox;
 
-  GLuint vbo_points;
-  GLuint vbo_normals;
-  GLuint vbo_textures;
+  /**
+   * @brief Views into a memory mapped binary 3D file.
+   *
+   * When the shape is read from a binary file, its data is never parsed: these
+   * pointers reference the sections of the mapping directly and the vectors of
+   * the shape stay empty
+  */
+  struct {
+    std::shared_ptr<MappedFile> file; ///< The mapping, null if the shape isn't mapped
+    const float* points = nullptr;
+    const float* normals = nullptr;
+    const float* textures = nullptr;
+    const uint32_t* triangles = nullptr;
+    const ShapeFileLOD* lods = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t triangleCount = 0;
+    uint32_t lodCount = 0;
+  } mapped;
+
+  /**
+   * @brief The attributes to keep in the vertex buffer
+  */
+  VertexLayout layout = VertexLayout::PositionNormalTexture;
+
+  /**
+   * @brief The vertex buffer, with the attributes of #layout interleaved
+  */
+  GLuint vbo_vertices;
+
+  /**
+   * @brief The element buffer with the indices of the vertices of each triangle
+  */
+  GLuint vbo_indices;
+
+  /**
+   * @brief The type of the indices in #vbo_indices. GL_UNSIGNED_SHORT when
+   * the shape has at most 65536 vertices, GL_UNSIGNED_INT otherwise
+  */
+  GLenum indexType;
+
+  /**
+   * @brief The first index of each level of detail in #vbo_indices
+  */
+  std::vector<size_t> lodFirstIndex;
 
   /**
    * @brief The triangles of the shape. For the i-th triangle, the tuple corresponds to
    * the index of the points in the points vector, following the right hand rule
   */
   std::vector<TriangleByPosition> trianglesByPos;
+
+  /**
+   * @brief A coarser version of the shape, using the same vertices
+  */
+  struct LOD {
+    std::vector<TriangleByPosition> triangles;
+    float error;
+  };
+
+  /**
+   * @brief The coarser levels of detail of the shape, from the finest
+  */
+  std::vector<LOD> lods;
 };
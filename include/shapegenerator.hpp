@@ -5,9 +5,12 @@
  */
 
 #pragma once
+#include "jobsystem.hpp"
 #include "shape.hpp"
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 /**
  * @brief Generates a sphere centered in the origin
@@ -94,23 +97,137 @@ std::unique_ptr<Shape> generateDonut(float radius, float length, float height,
                                      int stacks, int slices);
 
 /**
- * @brief Generates a #Shape based on the Bezier patches provided
- * in the input file.
- * 
+ * @brief Reads the control points of the Bezier patches of a file, and the
+ * indices of the 16 control points of each patch
+ *
  * The input file must have the following format:
- * 
+ *
  * A line with a single integer N. The numbers of patches in the file.
  * N lines follow. Each line contains 16 comma separated integers. The
  * indices (starting from 0) of the control points that make up the i-th patch.
- * 
+ *
  * A line with a single integer M. The number of control points. M lines follow.
  * The i-th line contains three floating point numbers: the coordinates of the i-th
  * control point
- * 
+ *
+ * @param inputFile     the path to the patch file
+ * @param controlPoints where the control points are added
+ * @param patches       where the patches are stored
+*/
+void readBezierPatchFile(std::string inputFile, std::vector<Point>& controlPoints, std::vector<int[16]>& patches);
+
+/**
+ * @brief Tessellates Bezier patches in a grid of divisions x divisions
+ * samples each
+ *
+ * The patches are tessellated in parallel if given the threads to. The
+ * samples of the borders the patches share (by their control points) have
+ * the same position. Where the normals of the patches agree (within
+ * BEZIER_CREASE_ANGLE) they are averaged, and the samples become the same
+ * vertices if their texture coordinates agree too. Across a crease each
+ * patch keeps its own normal.
+ *
+ * @param controlPoints the control points of the patches
+ * @param patches       the indices of the control points of each patch, row-major
+ * @param divisions     the number of samples along each side of a patch
+ * @param jobs          the threads tessellating the patches, if any
+ *
+ * @throws std::invalid_argument if there are fewer than 2 divisions
+*/
+std::unique_ptr<Shape> tessellateBezierPatches(const std::vector<Point>& controlPoints,
+                                               const std::vector<int[16]>& patches, int divisions,
+                                               JobSystem* jobs = nullptr);
+
+/**
+ * @brief Returns how far the tessellation of Bezier patches with the given
+ * divisions (see #tessellateBezierPatches) is from the patches: the largest
+ * distance between the middle of an edge of its triangles and the point of
+ * the patch there
+ *
+ * @throws std::invalid_argument if there are fewer than 2 divisions
+*/
+float bezierTessellationError(const std::vector<Point>& controlPoints, const std::vector<int[16]>& patches,
+                              int divisions);
+
+/**
+ * @brief Generates a #Shape based on the Bezier patches provided in the
+ * input file (see #readBezierPatchFile and #tessellateBezierPatches)
+ *
  * @param inputFile the path of the file containing the Bezier patch
  * @param divisions the number of divisions in the patch (e.g. 3 divisions
  * means the patch will be divided in a 3x3 grid)
- * 
+ * @param jobs      the threads tessellating the patches, if any
+ *
  * @returns         the corresponding #Shape
+ *
+ * @throws std::invalid_argument if there are fewer than 2 divisions
+*/
+std::unique_ptr<Shape> generateBezierPatches(std::string inputFile, int divisions, JobSystem* jobs = nullptr);
+
+/**
+ * @brief A surface sampled on a grid of (columns + 1) x (rows + 1) vertices,
+ * with two triangles per cell of the grid
+ *
+ * The triangles of the cell between vertices (c, r) and (c + 1, r + 1) are
+ * (c, r), (c, r + 1), (c + 1, r + 1) and (c, r), (c + 1, r + 1), (c + 1, r),
+ * so the surface faces the way of the direction of its rows crossed with the
+ * direction of its columns. Only one triangle is kept in the cells
+ * next to a collapsed row, such as the poles of a sphere, whose vertices all
+ * have the same position.
+*/
+struct GridSurface {
+  int columns;         ///< The number of cells of each row
+  int rows;            ///< The number of rows of cells
+  bool collapsedFirst; ///< Whether the vertices of row 0 share their position
+  bool collapsedLast;  ///< Whether the vertices of the last row share their position
+  std::function<Vertex(int column, int row)> vertex; ///< Returns the vertex at a column and row of the grid
+};
+
+/**
+ * @brief Returns the surface of a sphere centered in the origin
 */
-std::unique_ptr<Shape> generateBezierPatches(std::string inputFile, int divisions);
\ No newline at end of file
+std::vector<GridSurface> sphereSurfaces(float radius, int slices, int stacks);
+
+/**
+ * @brief Returns the surfaces of a cone with its base on the 0xz axis: its
+ * side and its base
+*/
+std::vector<GridSurface> coneSurfaces(float radius, float height, int slices, int stacks);
+
+/**
+ * @brief Returns the surfaces of a cylinder with its base on the 0xz axis:
+ * its side and its two caps
+*/
+std::vector<GridSurface> cylinderSurfaces(float radius, float height, int slices);
+
+/**
+ * @brief Returns the six faces of a cube centered in the origin
+*/
+std::vector<GridSurface> cubeSurfaces(float length, int divisions);
+
+/**
+ * @brief Returns the surface of a plane centered in the origin in the 0xz
+ * axis, facing up
+*/
+std::vector<GridSurface> planeSurfaces(float length, int divisions);
+
+/**
+ * @brief Returns the surface of a donut centered in the origin, with the
+ * parameters of #generateDonut
+*/
+std::vector<GridSurface> donutSurfaces(float radius, float length, float height, int stacks, int slices);
+
+/**
+ * @brief Generates a shape from grid surfaces, indexing their vertices as
+ * they are generated instead of welding them afterwards
+ *
+ * The vertices of a collapsed row that are all the same, and the last vertex
+ * of a row that is the same as the first, are shared.
+ *
+ * @param surfaces the surfaces of the shape
+ *
+ * @return         the shape
+ *
+ * @throws std::invalid_argument if a surface has no rows or columns
+ */
+std::unique_ptr<Shape> generateFromSurfaces(const std::vector<GridSurface>& surfaces);
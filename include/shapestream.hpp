@@ -0,0 +1,43 @@
+#pragma once
+
+/**
+ * @file shapestream.hpp
+ * @brief File defining the generation of shapes streamed straight to a
+ * binary 3D file, a few rows of vertices at a time, so the memory used
+ * doesn't grow with their divisions
+ *
+ * The shapes are described as grid surfaces (see shapegenerator.hpp), whose
+ * vertices and triangles can be generated in any order, and so in parallel.
+ * Unlike the shapes generated in memory, the vertices of their collapsed rows
+ * and seams aren't shared, nor optimized, and they have no levels of detail.
+*/
+
+#include "jobsystem.hpp"
+#include "shapegenerator.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * @brief The number of vertices each job generates and writes at once
+ * (rounded to whole rows, at least one)
+*/
+#define STREAM_CHUNK_VERTICES 65536
+
+/**
+ * @brief Writes surfaces as a single shape to a binary 3D file
+ *
+ * Since the number of vertices and triangles of each surface is known, the
+ * sections of the file are laid out up front, and the jobs write each chunk
+ * of rows to its place in them as soon as it's generated. The header, with
+ * the bounding box, is written last.
+ *
+ * @param surfaces the surfaces of the shape
+ * @param filePath the path of the file
+ * @param jobs     the threads generating the chunks
+ *
+ * @return whether the file was written
+ *
+ * @throws std::invalid_argument if a surface has no rows or columns, or the
+ * shape has more vertices or triangles than the format can count
+*/
+bool streamSurfaces(const std::vector<GridSurface>& surfaces, const std::string& filePath, JobSystem& jobs);
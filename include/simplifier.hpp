@@ -0,0 +1,123 @@
+#pragma once
+
+/**
+ * @file simplifier.hpp
+ * @brief File defining the @link Simplifier class, which reduces the number of
+ * triangles of an indexed mesh for coarser levels of detail
+ *
+ * The triangles are given as a list of vertex indices, 3 per triangle.
+*/
+
+#include <limits>
+#include <vector>
+#include "geometry.hpp"
+
+/**
+ * @brief The squared distances of a point to a set of planes, weighted by the
+ * area of the triangle each plane came from (Garland and Heckbert, "Surface
+ * Simplification Using Quadric Error Metrics", 1997)
+ *
+ * The quadric is the symmetric matrix sum(area * p * p^T) of the planes
+ * p = (a, b, c, d), stored as its upper triangle.
+*/
+struct Quadric {
+  double a2 = 0, ab = 0, ac = 0, ad = 0;
+  double b2 = 0, bc = 0, bd = 0;
+  double c2 = 0, cd = 0;
+  double d2 = 0;
+  double area = 0; ///< The sum of the weights
+
+  /**
+   * @brief Returns the quadric of the plane of a triangle, weighted by its area
+  */
+  static Quadric fromTriangle(const Point& p0, const Point& p1, const Point& p2);
+
+  Quadric& operator +=(const Quadric& q);
+
+  /**
+   * @brief Returns the mean squared distance of a point to the planes,
+   * weighted by their areas
+  */
+  float error(const Point& p) const;
+};
+
+/**
+ * @brief Simplifies a mesh by collapsing its edges, in the order of the error
+ * they introduce, which is measured with a #Quadric per vertex.
+ *
+ * Every collapse moves a vertex onto one of its neighbours (a half-edge
+ * collapse), so the simplified triangles only use the original vertices and
+ * can share their vertex buffer. The vertices on the border of the mesh, on
+ * non-manifold edges, and on attribute seams (several vertices at the same
+ * position, with different normals or texture coordinates) never move, so the
+ * outline and the texture mapping are kept.
+ *
+ * The collapses are done in passes: each pass sorts the candidate edges by
+ * error and collapses the cheapest ones that don't touch the neighbourhood of
+ * another collapse of the same pass, so the whole mesh is never re-sorted
+ * after a single collapse, and large meshes simplify in O(n log n).
+*/
+class Simplifier {
+public:
+  /**
+   * @brief Prepares to simplify the given mesh
+   *
+   * @param indices the vertices of the triangles
+   * @param points  the positions of the vertices, which must outlive the simplifier
+  */
+  Simplifier(const std::vector<int>& indices, const std::vector<Point>& points);
+
+  /**
+   * @brief Collapses edges until at most @p targetTriangles remain, or until
+   * no edge can be collapsed within @p maxError. Can be called repeatedly with
+   * lower targets for coarser levels of detail
+   *
+   * @param targetTriangles the number of triangles to reduce the mesh to
+   * @param maxError        the largest error (see #error) allowed
+   *
+   * @return the number of triangles left
+  */
+  size_t simplify(size_t targetTriangles, float maxError = std::numeric_limits<float>::infinity());
+
+  /**
+   * @brief Returns the vertices of the triangles left, 3 per triangle
+  */
+  const std::vector<int>& indices() const;
+
+  /**
+   * @brief Returns the error of the simplified mesh: the largest RMS distance
+   * (in the units of the points) of a collapsed vertex to the planes of the
+   * original triangles around it
+  */
+  float error() const;
+
+private:
+  /**
+   * @brief Does a pass of collapses
+   *
+   * @param goal          the most edges to collapse
+   * @param maxErrorSq    the largest squared error allowed
+   *
+   * @return the number of edges collapsed
+  */
+  size_t collapsePass(size_t goal, float maxErrorSq);
+
+  /**
+   * @brief Returns whether collapsing the vertex at position @p from onto
+   * @p to keeps the mesh manifold and doesn't flip any of its triangles
+   *
+   * @param vertex set to the vertex at @p to that replaces the one at @p from
+  */
+  bool canCollapse(int from, int to, const std::vector<size_t>& adjacencyStart,
+                   const std::vector<int>& adjacency, int& vertex);
+
+  const std::vector<Point>& points;
+  std::vector<int> current;      ///< The triangles left
+  std::vector<int> position;     ///< The first vertex at the position of each vertex
+  std::vector<bool> locked;      ///< Whether the vertices at a position can't move
+  std::vector<Quadric> quadrics; ///< The quadric of each position
+  std::vector<Vector> normals;   ///< The normals of the original triangles around each position, weighted by area
+  float errorSq = 0;             ///< The largest squared error of a collapse so far
+
+  std::vector<int> fromNeighbours, toNeighbours; ///< Scratch space of #canCollapse
+};
@@ -21,13 +21,19 @@ public:
     Texture& operator=(Texture&& texture);
 
     void initialize();
-    void bind();
+    void bind() const;
+
+    /**
+     * @brief Returns whether any texel of the texture is (partly) transparent
+    */
+    bool isTranslucent() const;
 
 private:
     static std::map<std::string, std::shared_ptr<Texture>> cache;
 
     int width, height;
     unsigned char* data;
+    bool translucent;
 
     GLuint texture;
 };
\ No newline at end of file
@@ -7,8 +7,17 @@
 */
 
 #include <memory>
+#include <vector>
 
+#include "matrixstack.hpp"
 #include "parser.hpp"
+#include "utils.hpp"
+
+/**
+ * @brief The number of up vectors sampled per segment of an aligned
+ * Catmull-Rom curve (see CatmullRom::ups)
+*/
+#define CATMULL_ROM_UP_SAMPLES 64
 
 /**
  * @brief An abstract class to generically represent a transformation
@@ -32,6 +41,15 @@ public:
   */
   static std::unique_ptr<Transformation> parse(XMLParser parser);
 
+  /**
+   * @brief Replaces each run of consecutive transformations that aren't
+   * animated with a single #MatrixTransformation, so they cost a single
+   * matrix product per frame
+   *
+   * @param transformations the transformations, in the order they are applied
+  */
+  static void fold(std::vector<std::unique_ptr<Transformation>>& transformations);
+
   /**
    * @brief Default destructor
   */
@@ -44,8 +62,27 @@ public:
 
   /**
    * @brief Applies a transformation to the scene
+   *
+   * The result only depends on the time, so a transformation can be applied
+   * from any thread.
+   *
+   * @param modelview the modelview matrix the transformation is multiplied into
+   * @param time      the time since the animations started, in seconds
   */
-  virtual void apply() = 0;
+  virtual void apply(MatrixStack& modelview, float time) const = 0;
+
+  /**
+   * @brief Returns whether the transformation changes with time
+  */
+  virtual bool isAnimated() const = 0;
+
+  /**
+   * @brief Returns a sphere containing the given one after the transformation,
+   * at any point of its animation
+   *
+   * @param sphere the sphere to transform
+  */
+  virtual BoundingSphere bound(const BoundingSphere& sphere) const = 0;
 };
 
 /**
@@ -63,7 +100,9 @@ public:
 
   Translation(XMLParser parser);
   Transformation* clone();
-  void apply();
+  void apply(MatrixStack& modelview, float time) const;
+  bool isAnimated() const;
+  BoundingSphere bound(const BoundingSphere& sphere) const;
 
 private:
   /**
@@ -95,7 +134,9 @@ public:
 
   Rotation(XMLParser parser);
   Transformation* clone();
-  void apply();
+  void apply(MatrixStack& modelview, float time) const;
+  bool isAnimated() const;
+  BoundingSphere bound(const BoundingSphere& sphere) const;
 
 private:
   /**
@@ -137,7 +178,9 @@ public:
 
   Scale(XMLParser parser);
   Transformation* clone();
-  void apply();
+  void apply(MatrixStack& modelview, float time) const;
+  bool isAnimated() const;
+  BoundingSphere bound(const BoundingSphere& sphere) const;
 
 private:
   /**
@@ -154,6 +197,25 @@ private:
   float z;
 };
 
+/**
+ * @brief A constant transformation given by its matrix, which replaces a run
+ * of transformations that aren't animated (see Transformation::fold)
+*/
+class MatrixTransformation : public Transformation {
+public:
+  MatrixTransformation(const Mat4& matrix);
+  Transformation* clone();
+  void apply(MatrixStack& modelview, float time) const;
+  bool isAnimated() const;
+  BoundingSphere bound(const BoundingSphere& sphere) const;
+
+private:
+  /**
+   * @brief the product of the matrices of the transformations replaced
+  */
+  Mat4 matrix;
+};
+
 
 /**
  * @brief A Catmull-Rom curve
@@ -169,8 +231,19 @@ public:
 
   CatmullRom(XMLParser parser);
   Transformation* clone();
-  void apply();
-  void draw();
+  void apply(MatrixStack& modelview, float time) const;
+  bool isAnimated() const;
+  BoundingSphere bound(const BoundingSphere& sphere) const;
+
+  /**
+   * @brief Returns whether a trace of the curve should be drawn
+  */
+  bool hasTrace() const;
+
+  /**
+   * @brief Draws the curve, in the coordinates GL's modelview matrix is in
+  */
+  void draw() const;
 
 private:
   /**
@@ -184,7 +257,7 @@ private:
   bool align;
 
   /**
-   * @brief if true, draws a trace of the curve when applied by cutting each segment into 10.
+   * @brief if true, a trace of the curve is drawn (see #draw) by cutting each segment into 10.
    * Performance intensive
   */
   bool trace;
@@ -195,8 +268,15 @@ private:
   std::vector<Point> points;
 
 
-  Vector y_0 = {0, 1, 0};
+  /**
+   * @brief the up vectors the aligned frame is built from, at
+   * #CATMULL_ROM_UP_SAMPLES times per segment. Each one is the up vector of
+   * the frame at the sample before it, starting from (0, 1, 0), so the frame
+   * turns as little as possible along the curve
+  */
+  std::vector<Vector> ups;
 
+  void computeUps();
 
-  void getGlobalCatmullRomPoint(float gt, Point& pos, Vector& deriv);
+  void getGlobalCatmullRomPoint(float gt, Point& pos, Vector& deriv) const;
 };
\ No newline at end of file
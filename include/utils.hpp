@@ -10,44 +10,68 @@
 #include <memory>
 #include <string>
 
+#include "culling.hpp"
 #include "geometry.hpp"
+#include "matrix.hpp"
 #include "parser.hpp"
 #include "exceptions/invalid_xml_file.hpp"
 
-#define GET_ALL(tuple) std::get<0>(tuple), std::get<1>(tuple), std::get<2>(tuple) 
+#define GET_ALL(tuple) component<0>(tuple), component<1>(tuple), component<2>(tuple)
 
 typedef std::tuple<float,float,float> Color; ///< Tuple representing RGB color values
 
 typedef std::tuple<int, int> WindowSize; ///< Tuple of a width and a height, both integers.
 
 
+/**
+ * @brief Returns the largest factor the given (affine) matrix scales lengths by
+ *
+ * @param m the matrix
+ */
+float maxScale(const Mat4& m);
+
+struct BoundingSphere {
+    Point center;
+    float radius; //negative for an empty sphere, which contains nothing
+
+    BoundingSphere();
+    BoundingSphere(Point center, float radius);
+
+    bool empty() const;
+    void merge(const BoundingSphere& sphere); //grows to also contain the given sphere
+    BoundingSphere transform(const Mat4& modelview) const; //contains the transformed sphere
+};
+
 class BoundingBox {
-    std::vector<Point> corners;
+    Point center;
+    Vector extents; //half the size along each axis, negative for an empty box
 
 public:
     BoundingBox();
     BoundingBox(const std::vector<Point>& points);
-    BoundingBox(const BoundingBox& bb);
-
-    BoundingBox& operator =(const BoundingBox& bb);
-
-    void transform(float modelview[16]);
-    bool isForward(Plane plane); //whether at least part of the AABB is in front
-                                 //of the plane (aka the direction the normal points)
+    BoundingBox(Point center, Vector extents);
+
+    bool empty() const;
+    const Point& getCenter() const;
+    const Vector& getExtents() const;
+
+    void transform(const Mat4& modelview); //becomes the AABB of the transformed box
+    bool isForward(const Plane& plane) const; //whether at least part of the AABB is in front
+                                              //of the plane (aka the direction the normal points)
+    float distanceFrom(const Point& point) const; //a lower bound of the distance from the
+                                                  //point to the box (zero if it's inside)
+    BoundingSphere boundingSphere() const; //the sphere around the corners
 };
 
 class Frustum {
-    //For all these, the normal vector points inwards
-    Plane up;
-    Plane down;
-    Plane left;
-    Plane right;
-    Plane near;
-    Plane far;
+    //up, down, left, right, near and far. The normals point inwards
+    FrustumPlanes planes;
 
 public:
     Frustum(Point position, Vector lookAtVector, Vector up, float near, float fat, float fov, float ratio);
-    bool contains(BoundingBox boundingBox) const;
+    bool contains(const BoundingBox& boundingBox) const;
+    bool contains(const BoundingSphere& sphere) const; //whether at least part of the sphere is inside
+    size_t contains(const BoxBatch& boxes, uint8_t* visible) const; //see cullBoxes
 };
 
 /**
@@ -206,42 +230,3 @@ template <class Superclass> struct dynamicParser<Superclass> {
   }
 };
 
-template <typename T> void transpose(int n, int m, T* a) {
-  for (int y = 1; y < m; y++) {
-    for (int x = 0; x < y; x++) {
-      T aux = a[y * n + x];
-      a[y * n + x] = a[x * n + y];
-      a[x * n + y] = aux;
-    }
-  }
-}
-
-
-/**
- * @brief A generic matrix multiplication function.
- * 
- * It requires the product (* operator) to be defined for the types
- * being multiplied, as well as addition (+ operator) for the type
- * of the output matrix.
- * 
- * It assumes the null (zero) value of the type
- * is one where the memory is all set to zero.
- * 
- * @param n The number of columns of the output matrix
- * @param m The number of rows of the output matrix
- * @param l The number of columns of the first input matrix (the
- * same as the number of rows of the second input matrix)
- * @param a The first input matrix
- * @param b The second input matrix
- * @param c The output matrix
-*/
-template <typename T, typename S, typename U> 
-void matrixProd(int n, int m, int l, T* a, S* b, U *c) {
-  for (int y = 0; y < m; y++) {
-    for (int x = 0; x < n; x++) {
-      c[n * y + x] = U{};
-      for (int i = 0; i < l; i++)
-        c[n * y + x] = c[n * y + x] + (a[l * y + i] * b[n * i + x]);
-    }
-  }
-};
@@ -0,0 +1,363 @@
+#pragma once
+
+/**
+ * @file vecmath.hpp
+ * @brief File defining the #Vec3 and #Vec4 vector types and their (inline)
+ * arithmetic
+ *
+ * Both types are 16 byte aligned, so that on x86 the operations can load a
+ * whole vector into an SSE register. Without SSE2 (or with @c VECMATH_NO_SIMD
+ * defined) the same operations are done one component at a time.
+ *
+ * The SSE path does the same floating point operations, in the same order, as
+ * the scalar one, so both give bit-identical results.
+*/
+
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#if !defined(VECMATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define VECMATH_SSE 1
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief A vector (or point) in 3D space
+ *
+ * Converts implicitly from and to @c std::tuple<float,float,float>, the type
+ * points used to be, so code dealing with tuples (such as the XML parser)
+ * keeps working.
+*/
+struct alignas(16) Vec3 {
+  float x, y, z;
+
+  /**
+   * @brief Padding up to 16 bytes. Always ignored by the operations
+  */
+  float pad;
+
+  Vec3() : x(0), y(0), z(0), pad(0) {}
+  Vec3(float x, float y, float z) : x(x), y(y), z(z), pad(0) {}
+
+  /**
+   * @brief Constructs from any 3 numbers, converting them to float (as the
+   * tuples did)
+  */
+  template <typename X, typename Y, typename Z,
+            typename = std::enable_if_t<std::is_arithmetic_v<X> && std::is_arithmetic_v<Y> && std::is_arithmetic_v<Z>>>
+  Vec3(X x, Y y, Z z) : Vec3((float)x, (float)y, (float)z) {}
+
+  Vec3(const std::tuple<float, float, float>& t) : Vec3(std::get<0>(t), std::get<1>(t), std::get<2>(t)) {}
+
+  operator std::tuple<float, float, float>() const { return { x, y, z }; }
+
+  /**
+   * @brief Returns a pointer to the 3 components, as expected by the @c *3fv
+   * OpenGL functions
+  */
+  const float* data() const { return &x; }
+  float* data() { return &x; }
+
+  float operator [](size_t i) const { return (&x)[i]; }
+  float& operator [](size_t i) { return (&x)[i]; }
+
+#ifdef VECMATH_SSE
+  explicit Vec3(__m128 v) { _mm_store_ps(&x, v); }
+
+  /**
+   * @brief Loads the vector into an SSE register
+  */
+  __m128 simd() const { return _mm_load_ps(&x); }
+#endif
+};
+
+/**
+ * @brief A vector in 4D space, such as a point in homogeneous coordinates
+*/
+struct alignas(16) Vec4 {
+  float x, y, z, w;
+
+  Vec4() : x(0), y(0), z(0), w(0) {}
+  Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+  Vec4(const Vec3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+  /**
+   * @brief Returns the first 3 components
+  */
+  Vec3 xyz() const { return { x, y, z }; }
+
+  const float* data() const { return &x; }
+  float* data() { return &x; }
+
+  float operator [](size_t i) const { return (&x)[i]; }
+  float& operator [](size_t i) { return (&x)[i]; }
+
+#ifdef VECMATH_SSE
+  explicit Vec4(__m128 v) { _mm_store_ps(&x, v); }
+  __m128 simd() const { return _mm_load_ps(&x); }
+#endif
+};
+
+static_assert(sizeof(Vec3) == 16 && alignof(Vec3) == 16, "Vec3 must fill an SSE register");
+static_assert(sizeof(Vec4) == 16 && alignof(Vec4) == 16, "Vec4 must fill an SSE register");
+
+/**
+ * @brief Returns the I-th component of a vector or of a tuple of 3 floats
+*/
+template <size_t I> inline float component(const Vec3& v) {
+  static_assert(I < 3, "Vec3 has 3 components");
+  return v[I];
+}
+
+template <size_t I> inline float component(const std::tuple<float, float, float>& t) {
+  return std::get<I>(t);
+}
+
+/**
+ * @brief Return the zero vector
+ * @return {0,0,0}
+ */
+inline Vec3 zero() {
+  return {};
+}
+
+/**
+ * @brief Multiplies a vector by a scalar
+ *
+ * @param x A scalar
+ * @param v A vector
+ * @return Vector The resulting vector
+ */
+inline Vec3 operator *(float x, const Vec3& v) {
+#ifdef VECMATH_SSE
+  return Vec3(_mm_mul_ps(_mm_set1_ps(x), v.simd()));
+#else
+  return { x * v.x, x * v.y, x * v.z };
+#endif
+}
+
+/**
+ * @brief Multiplies a vector by a scalar
+ *
+ * @param v A vector
+ * @param x A scalar
+ * @return Vector The resulting vector
+ */
+inline Vec3 operator *(const Vec3& v, float x) {
+  return x * v;
+}
+
+/**
+ * @brief Divides a vector by a scalar
+ *
+ * @param v A vector
+ * @param x A scalar
+ * @return Vector The resulting vector
+ */
+inline Vec3 operator /(const Vec3& v, float x) {
+#ifdef VECMATH_SSE
+  return Vec3(_mm_div_ps(v.simd(), _mm_set1_ps(x)));
+#else
+  return { v.x / x, v.y / x, v.z / x };
+#endif
+}
+
+/**
+ * @brief Sums two vectors
+ *
+ * @param v1 the first vector
+ * @param v2 the second vector
+ *
+ * @return the resulting vector
+ */
+inline Vec3 operator +(const Vec3& v1, const Vec3& v2) {
+#ifdef VECMATH_SSE
+  return Vec3(_mm_add_ps(v1.simd(), v2.simd()));
+#else
+  return { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z };
+#endif
+}
+
+/**
+ * @brief Returns the inverse of the given vector, such that their sum
+ * is the null vector
+ *
+ * @param v The given vector
+ * @return Vector The inverse
+ */
+inline Vec3 operator -(const Vec3& v) {
+#ifdef VECMATH_SSE
+  return Vec3(_mm_xor_ps(v.simd(), _mm_set1_ps(-0.0f)));
+#else
+  return { -v.x, -v.y, -v.z };
+#endif
+}
+
+/**
+ * @brief Returns the difference between two vectors
+ *
+ * @param p1 A point
+ * @param p2 Another one
+ * @return Vector Bites the dust
+ */
+inline Vec3 operator -(const Vec3& v1, const Vec3& v2) {
+#ifdef VECMATH_SSE
+  return Vec3(_mm_sub_ps(v1.simd(), v2.simd()));
+#else
+  return { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z };
+#endif
+}
+
+inline Vec3& operator +=(Vec3& v1, const Vec3& v2) {
+  return v1 = v1 + v2;
+}
+
+inline Vec3& operator -=(Vec3& v1, const Vec3& v2) {
+  return v1 = v1 - v2;
+}
+
+inline Vec3& operator *=(Vec3& v, float x) {
+  return v = x * v;
+}
+
+inline Vec3& operator /=(Vec3& v, float x) {
+  return v = v / x;
+}
+
+/**
+ * @brief Calculates the dot product between two vectors
+ *
+ * @param u A vector
+ * @param v Another one
+ * @return float Bytes the dust
+ */
+inline float operator *(const Vec3& v1, const Vec3& v2) {
+#ifdef VECMATH_SSE
+  __m128 m = _mm_mul_ps(v1.simd(), v2.simd());
+  __m128 s = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+  return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2))));
+#else
+  return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+#endif
+}
+
+/**
+ * @brief Calculates the cross product between two vectors
+ * Returns a vector perpendicular to the two given vectors, with the
+ * direction according to the right hand rule and a length that equals the
+ * product of the lengths of the two vectors when they are perpendicular and zero when
+ * they are colinear (and somewhere in between for other angles).
+ *
+ * @param u A vector
+ * @param v Another one
+ * @return float Bytes the dust
+ */
+inline Vec3 operator ^(const Vec3& v1, const Vec3& v2) {
+#ifdef VECMATH_SSE
+  __m128 a = v1.simd(), b = v2.simd();
+  __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 a_zxy = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+  __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 b_zxy = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+  return Vec3(_mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy), _mm_mul_ps(a_zxy, b_yzx)));
+#else
+  return { v1.y * v2.z - v1.z * v2.y,
+           v1.z * v2.x - v1.x * v2.z,
+           v1.x * v2.y - v1.y * v2.x };
+#endif
+}
+
+inline bool operator ==(const Vec3& v1, const Vec3& v2) {
+  return v1.x == v2.x && v1.y == v2.y && v1.z == v2.z;
+}
+
+inline bool operator !=(const Vec3& v1, const Vec3& v2) {
+  return !(v1 == v2);
+}
+
+/**
+ * @brief Compares two vectors lexicographically (like tuples), so they can be
+ * used as keys of a @c std::map
+*/
+inline bool operator <(const Vec3& v1, const Vec3& v2) {
+  if (v1.x != v2.x)
+    return v1.x < v2.x;
+  if (v1.y != v2.y)
+    return v1.y < v2.y;
+  return v1.z < v2.z;
+}
+
+/**
+ * @brief Calculates the square of the length of the vector.
+ * Is less expensive than length(), since to calculate the length
+ * one must calculate the square and then apply the square root.
+ *
+ * @param v
+ * @return float
+ */
+inline float square_length(const Vec3& v) {
+  return v * v;
+}
+
+/**
+ * @brief Calculates the length of the vector
+ *
+ * @param v The vector
+ * @return float The length
+ */
+inline float length(const Vec3& v) {
+  return std::sqrt(v * v);
+}
+
+/**
+ * @brief Returns a normalized vector (with length 1) with the same direction
+ *
+ * @param v A vector
+ * @return Vector A normalized vector
+ */
+inline Vec3 normalize(const Vec3& v) {
+  return (1 / length(v)) * v;
+}
+
+inline Vec4 operator +(const Vec4& v1, const Vec4& v2) {
+#ifdef VECMATH_SSE
+  return Vec4(_mm_add_ps(v1.simd(), v2.simd()));
+#else
+  return { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z, v1.w + v2.w };
+#endif
+}
+
+inline Vec4 operator -(const Vec4& v1, const Vec4& v2) {
+#ifdef VECMATH_SSE
+  return Vec4(_mm_sub_ps(v1.simd(), v2.simd()));
+#else
+  return { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z, v1.w - v2.w };
+#endif
+}
+
+inline Vec4 operator *(float x, const Vec4& v) {
+#ifdef VECMATH_SSE
+  return Vec4(_mm_mul_ps(_mm_set1_ps(x), v.simd()));
+#else
+  return { x * v.x, x * v.y, x * v.z, x * v.w };
+#endif
+}
+
+inline Vec4 operator *(const Vec4& v, float x) {
+  return x * v;
+}
+
+/**
+ * @brief Calculates the dot product between two 4D vectors
+*/
+inline float operator *(const Vec4& v1, const Vec4& v2) {
+#ifdef VECMATH_SSE
+  __m128 m = _mm_mul_ps(v1.simd(), v2.simd());
+  __m128 s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1))); //(x+y, y+x, z+w, w+z)
+  return _mm_cvtss_f32(_mm_add_ss(s, _mm_movehl_ps(s, s)));
+#else
+  return (v1.x * v2.x + v1.y * v2.y) + (v1.z * v2.z + v1.w * v2.w);
+#endif
+}
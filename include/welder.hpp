@@ -0,0 +1,37 @@
+#pragma once
+
+/**
+ * @file welder.hpp
+ * @brief File declaring the functions used to weld the identical vertices of a
+ * triangle soup
+*/
+
+#include <vector>
+#include "shape.hpp"
+
+/**
+ * @brief The number of corners from which #weldVertices splits the work across
+ * threads when the number of threads isn't given
+*/
+#define WELD_PARALLEL_THRESHOLD (1 << 20)
+
+/**
+ * @brief Welds the identical corners of a triangle soup into unique vertices.
+ *
+ * Two corners are identical when all their attributes have the same bit
+ * pattern (with -0.0 and +0.0 considered equal). The unique vertices are
+ * stored in order of first appearance, so the result only depends on the
+ * input, regardless of the number of threads.
+ *
+ * The corners are looked up in an open-addressing hash table. With more than
+ * one thread, the hashes are computed in parallel and the table is split in
+ * shards (by the high bits of the hash), each owned by a thread.
+ *
+ * @param corners  the vertices of the corners of the triangles
+ * @param vertices where to store the unique vertices
+ * @param indices  where to store, for each corner, the index of its vertex
+ * @param threads  the number of threads to use. If zero, more than one thread
+ *                 is only used for at least #WELD_PARALLEL_THRESHOLD corners
+*/
+void weldVertices(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices,
+                  std::vector<int>& indices, unsigned int threads = 0);
@@ -12,8 +12,23 @@
 #include "model.hpp"
 #include "parser.hpp"
 #include "camera.hpp"
+#include "flatscene.hpp"
 #include "group.hpp"
+#include "instancing.hpp"
+#include "jobsystem.hpp"
 #include "lighting.hpp"
+#include "profiler.hpp"
+
+/**
+ * @brief The seconds between the updates of the window's title with the
+ * frame rate and draw stats
+*/
+#define TITLE_INTERVAL 0.5f
+
+/**
+ * @brief The file the profile of the last frames is written to, unless set
+*/
+#define PROFILE_PATH "profile.json"
 
 /**
  * @class World
@@ -27,6 +42,15 @@ private:
     Lighting lighting; ///< The lighting to use for rendering the scene.
     Group root; ///< The root group of the scene.
     bool axis; ///< Whether to draw the axis
+    float lodBias = 0; ///< The bias of the levels of detail of the models (see DrawContext::lodBias)
+    MatrixStack modelview; ///< The view matrix of the camera, kept on the CPU
+    FlatScene scene; ///< The root group, flattened to be updated in parallel. Built by initScene
+    std::unique_ptr<JobSystem> jobs; ///< The threads the scene is updated on. Started by initScene
+    std::unique_ptr<InstanceRenderer> instances; ///< Draws the models sharing a shape in batches. Created by initScene
+    std::unique_ptr<Profiler> profiler = std::make_unique<Profiler>(); ///< Times the stages of the frames
+    std::string profilePath = PROFILE_PATH; ///< The file the profile is written to (see #writeProfile)
+    float titleTime = 0; ///< The time the title was last updated, in seconds
+    int titleFrames = 0; ///< The frames rendered since the title was last updated
 
     /**
      * @brief Constructs a World object with the given window size, camera, and group.
@@ -68,6 +92,12 @@ public:
      */
     void initScene();
 
+    /**
+     * @brief Sets up OpenGL and uploads the scene to it, in the current
+     * context: the window created by #initScene, or an offscreen one
+     */
+    void initGL();
+
     /**
      * @brief Handles a change in the window size.
      * @param width The new width of the window.
@@ -75,11 +105,42 @@ public:
      */
     void changeSize(int width, int height);
 
+    /**
+     * @brief Returns the size of the window set in the configuration file.
+     */
+    WindowSize getWindowSize() const;
+
+    /**
+     * @brief Returns the profiler timing the frames rendered.
+     */
+    Profiler& getProfiler();
+
+    /**
+     * @brief Sets the file #writeProfile writes to.
+     * @param path The path of the file, written as CSV if it ends in .csv and as JSON otherwise.
+     */
+    void setProfilePath(const std::string& path);
+
+    /**
+     * @brief Writes the profile of the last frames rendered. Doesn't wait for
+     * the GPU timings not yet read, so it can be called without a GL context.
+     * @throws std::runtime_error if the file can't be written
+     */
+    void writeProfile();
+
     /**
      * @brief Renders the scene using OpenGL and GLUT.
      */
     void renderScene();
 
+    /**
+     * @brief Renders a frame of the scene into the current framebuffer,
+     * without presenting it
+     * @param time The time since the animations started, in seconds.
+     * @return The counts of what was culled and drawn.
+     */
+    DrawStats renderFrame(float time);
+
     /**
      * @brief Handles a keyboard input event.
      * @param key The ASCII code of the key that was pressed.
@@ -47,6 +47,7 @@ void Camera::changeSize(WindowSize windowSize) {
 
   // compute window's aspect ratio
   ratio = width * 1.0f / height;
+  this->height = height;
   // Set the projection matrix as current
   glMatrixMode(GL_PROJECTION);
   // Load the identity matrix
@@ -59,19 +60,24 @@ void Camera::changeSize(WindowSize windowSize) {
   glMatrixMode(GL_MODELVIEW);
 }
 
-void Camera::setupScene() {
+void Camera::setupScene(MatrixStack& modelview) {
   /**
    * @brief loads the camera into the world
    * 
    */
-  glLoadIdentity();
-  gluLookAt(GET_ALL(position), GET_ALL(lookAt), GET_ALL(up));
+  modelview.lookAt(position, lookAt, up);
+  modelview.upload();
 }
 
 Frustum Camera::viewFrustum() {
   return Frustum(zero(), {0,0,-1}, {0,1,0}, near, far, fov, ratio);
 }
 
+float Camera::screenScale() const {
+  //the vertical field of view spans the height of the window
+  return height / (2 * tan(fov * M_PI / 360));
+}
+
 void Camera::handleKey(unsigned char key,
                        int x,
                        int y) {}
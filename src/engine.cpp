@@ -1,6 +1,9 @@
 #include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
 #include "glut.hpp"
 
+#include "headless.hpp"
 #include "parser.hpp"
 #include "utils.hpp"
 #include "world.hpp"
@@ -9,6 +12,11 @@
 #define ENGINE
 #endif
 
+/**
+ * @brief The number of frames rendered headless, unless given
+*/
+#define HEADLESS_FRAMES 100
+
 World world;
 
 void changeSize(int height, int width) { 
@@ -45,6 +53,17 @@ void handleSpecialKey(int key, int x, int y) {
   world.handleSpecialKey(key, x, y);
 }
 
+void writeProfile() {
+  /**
+   * @brief Writes the profile of the last frames, at exit
+   */
+  try {
+    world.writeProfile();
+  } catch (std::runtime_error& e) {
+    std::cout << e.what() << std::endl;
+  }
+}
+
 #ifdef ENGINE
 int main(int argc, char **argv) {
   /**
@@ -57,18 +76,54 @@ int main(int argc, char **argv) {
    * @return 1 if an error occurred
    */
 
-  if (argc != 2) {
-    std::cout << "Error: Invalid argument count, expected one argument but got "
-              << argc - 1 << "." << std::endl;
+  //options, before the configuration file
+  bool headless = false;
+  int frames = HEADLESS_FRAMES;
+  int width = 0, height = 0;
+  std::string profile;
+  int a = 1;
+  for (; a < argc - 1; a++) {
+    std::string option = argv[a];
+    if (option == "--headless") {
+      headless = true;
+    } else if (option == "--frames" && a + 1 < argc - 1) {
+      char* end;
+      long n = strtol(argv[++a], &end, 10);
+      if (end == argv[a] || *end != '\0' || n < 1 || n > INT_MAX) {
+        std::cout << "Error: Invalid number of frames \"" << argv[a] << "\", expected an integer of at least 1." << std::endl;
+        return 1;
+      }
+      frames = n;
+    } else if (option == "--profile" && a + 1 < argc - 1) {
+      profile = argv[++a];
+    } else if (option == "--size" && a + 1 < argc - 1) {
+      if (sscanf(argv[++a], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        std::cout << "Error: Invalid size \"" << argv[a] << "\", expected WIDTHxHEIGHT." << std::endl;
+        return 1;
+      }
+    } else {
+      std::cout << "Error: Invalid option \"" << option << "\"." << std::endl;
+      return 1;
+    }
+  }
+
+  if (a != argc - 1) {
+    std::cout << "Error: Invalid argument count, expected the configuration file." << std::endl;
     return 0;
   }
   //help command
-  std::string arg = argv[1];
+  std::string arg = argv[a];
   if (arg == "help") {
-    std::cout << "usage: engine [argument]\n";
+    std::cout << "usage: engine [options] [argument]\n";
     std::cout << "Arguments (and their description):\n";
     std::cout << "help    : displays the current message.\n";
     std::cout << "path    : set the configuration file (mandatory argument).\n";
+    std::cout << "Options (and their description):\n";
+    std::cout << "--headless     : renders offscreen, without a window, and prints the frame times as JSON.\n";
+    std::cout << "--frames N     : the number of frames rendered headless (" << HEADLESS_FRAMES << " by default).\n";
+    std::cout << "--size WxH     : the size of the headless framebuffer (the window's by default).\n";
+    std::cout << "--profile FILE : writes the timings of the last frames at exit, as CSV if FILE ends in .csv and JSON otherwise\n";
+    std::cout << "                 (also written, to " << PROFILE_PATH << " by default, by pressing 'p').\n";
     std::cout << std::endl;
     return 1;
   }
@@ -80,6 +135,24 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (!profile.empty()) {
+    world.setProfilePath(profile);
+    atexit(writeProfile);
+  }
+
+  if (headless) {
+    if (width == 0)
+      std::tie(width, height) = world.getWindowSize();
+
+    try {
+      runHeadless(world, arg, frames, width, height, std::cout);
+    } catch (std::runtime_error& e) {
+      std::cout << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
   // put GLUT's init here
   glutInit(&argc, argv);
 
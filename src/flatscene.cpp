@@ -0,0 +1,189 @@
+/**
+ * @file flatscene.cpp
+ *
+ * @brief File implementing the flattened scene and its parallel update
+ */
+
+#include "glut.hpp"
+
+#include "culling.hpp"
+#include "flatscene.hpp"
+#include "matrixstack.hpp"
+#include <algorithm>
+
+FlatScene::FlatScene() {}
+
+FlatScene::FlatScene(Group& root) {
+  std::vector<Group*> groups = { &root };
+  std::vector<size_t> firstChild;
+  nodes.push_back({ &root, NO_PARENT, 0, 0 });
+
+  //breadth first, a level at a time
+  levels.push_back(0);
+  for (size_t begin = 0; begin < nodes.size();) {
+    size_t end = nodes.size();
+    for (size_t n = begin; n < end; n++) {
+      firstChild.push_back(nodes.size());
+      for (Group& g : groups[n]->getSubgroups()) {
+        nodes.push_back({ &g, n, 0, 0 });
+        groups.push_back(&g);
+      }
+    }
+
+    levels.push_back(end);
+    begin = end;
+  }
+
+  flatten(0, groups, firstChild);
+
+  queue = RenderQueue(models);
+
+  matrices.resize(nodes.size());
+  states.resize(nodes.size());
+  culled.resize(models.size());
+  traceMatrices.resize(traces.size());
+  drawList.reserve(models.size());
+}
+
+void FlatScene::flatten(size_t node, const std::vector<Group*>& groups, const std::vector<size_t>& firstChild) {
+  Group& group = *groups[node];
+
+  for (Model& m : group.getModels()) {
+    models.push_back(&m);
+    modelNodes.push_back(node);
+  }
+
+  nodes[node].firstTrace = traces.size();
+  const std::vector<std::unique_ptr<Transformation>>& transformations = group.getTransformations();
+  for (size_t k = 0; k < transformations.size(); k++) {
+    const CatmullRom* curve = dynamic_cast<const CatmullRom*>(transformations[k].get());
+    if (curve != nullptr && curve->hasTrace())
+      traces.push_back({ curve, node, k });
+  }
+  nodes[node].traceCount = traces.size() - nodes[node].firstTrace;
+
+  for (size_t c = 0; c < group.getSubgroups().size(); c++)
+    flatten(firstChild[node] + c, groups, firstChild);
+}
+
+void FlatScene::update(JobSystem& jobs, const DrawContext& context, const Mat4& view, float time, DrawStats& stats) {
+  //the groups, a level at a time, since each needs the matrix of its parent
+  for (size_t l = 0; l + 1 < levels.size(); l++) {
+    size_t first = levels[l];
+
+    jobs.parallelFor(levels[l + 1] - first, SCENE_JOB_GRAIN, [&](size_t begin, size_t end) {
+      MatrixStack modelview;
+
+      for (size_t n = first + begin; n < first + end; n++) {
+        const Node& node = nodes[n];
+        bool root = node.parent == NO_PARENT;
+        const Mat4& parent = root ? view : matrices[node.parent];
+
+        //the bound is in the coordinates of the parent. A group with an empty
+        //one still has its transformations run if it draws traces
+        const BoundingSphere& bound = node.group->getBound();
+        if ((!root && states[node.parent] != Visible) || (bound.empty() && node.traceCount == 0)) {
+          states[n] = Hidden;
+          continue;
+        }
+        if (!bound.empty() && !context.viewFrustum.contains(bound.transform(parent))) {
+          states[n] = Culled;
+          continue;
+        }
+
+        modelview.load(parent);
+        const std::vector<std::unique_ptr<Transformation>>& transformations = node.group->getTransformations();
+        size_t trace = node.firstTrace;
+        for (size_t k = 0; k < transformations.size(); k++) {
+          if (trace < node.firstTrace + node.traceCount && traces[trace].transformation == k)
+            traceMatrices[trace++] = modelview.top();
+          transformations[k]->apply(modelview, time);
+        }
+
+        matrices[n] = modelview.top();
+        states[n] = Visible;
+      }
+    });
+  }
+
+  jobs.parallelFor(models.size(), SCENE_JOB_GRAIN, [&](size_t begin, size_t end) {
+    //the boxes of the models of a range are culled together (see cullBoxes),
+    //in a batch each thread reuses between ranges and frames
+    static thread_local BoxBatch batch;
+    static thread_local std::vector<size_t> batched;
+    static thread_local std::vector<uint8_t> visible;
+    batch.clear();
+    batched.clear();
+
+    for (size_t m = begin; m < end; m++) {
+      size_t node = modelNodes[m];
+      culled[m] = states[node] == Visible;
+      if (!culled[m])
+        continue;
+
+      BoundingBox bb = models[m]->getBoundingBox(matrices[node]);
+      if (!bb.empty()) {
+        batch.add(bb.getCenter(), bb.getExtents());
+        batched.push_back(m);
+      }
+    }
+
+    visible.resize(batch.size());
+    context.viewFrustum.contains(batch, visible.data());
+
+    for (size_t b = 0; b < batch.size(); b++) {
+      if (!visible[b])
+        continue;
+
+      size_t m = batched[b];
+      culled[m] = false;
+      BoundingBox bb({ batch.cx[b], batch.cy[b], batch.cz[b] }, { batch.ex[b], batch.ey[b], batch.ez[b] });
+      models[m]->selectLevels(context, matrices[modelNodes[m]], bb);
+    }
+  });
+
+  //the models drawn swap in the levels of tessellation they chose, which are
+  //different shapes, so the buckets are numbered again (only when they do)
+  bool swapped = false;
+  for (size_t m = 0; m < models.size(); m++)
+    if (states[modelNodes[m]] == Visible && !culled[m])
+      swapped |= models[m]->updateTessellation();
+  if (swapped)
+    queue = RenderQueue(models);
+
+  //the draw list, with the models in the order of the tree
+  drawList.clear();
+  for (size_t m = 0; m < models.size(); m++) {
+    if (states[modelNodes[m]] != Visible)
+      continue;
+
+    if (culled[m]) {
+      stats.culledModels++;
+    } else {
+      size_t lod = std::min(models[m]->getLOD(), models[m]->getShape()->lodCount() - 1);
+      drawList.push_back({ models[m], modelNodes[m], queue.bucket(m, lod) });
+    }
+  }
+
+  for (size_t n = 0; n < nodes.size(); n++) {
+    if (states[n] == Culled) {
+      stats.culledGroups++;
+      stats.culledModels += nodes[n].group->getModelCount();
+    }
+  }
+}
+
+void FlatScene::draw(InstanceRenderer& renderer, DrawStats& stats) {
+  for (size_t t = 0; t < traces.size(); t++) {
+    if (states[traces[t].node] == Visible) {
+      loadMatrix(traceMatrices[t]);
+      traces[t].curve->draw();
+    }
+  }
+
+  queue.submit(drawList, matrices, renderer, stats);
+}
+
+const std::vector<DrawItem>& FlatScene::getDrawList() const {
+  return drawList;
+}
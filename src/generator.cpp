@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include "shape.hpp"
 #include "shapegenerator.hpp"
+#include "meshoptimizer.hpp"
+#include "shapestream.hpp"
+#include "exceptions/invalid_xml_file.hpp"
 #include <cstring>
 #include <iostream>
 #include <stdexcept>
@@ -35,6 +38,48 @@ unsigned constexpr shapetoint(char *shape) {
   return *shape ? *shape + 33 * shapetoint(shape + 1) : 5381;
 }
 
+/**
+ * @brief Loads a shape from a 3D file and optimizes it for rendering (see
+ * Shape::optimize), printing the ACMR before and after
+ *
+ * @param filePath the path of the 3D file
+ *
+ * @return the optimized shape
+ */
+std::unique_ptr<Shape> optimizeShape(char *filePath) {
+  std::unique_ptr<Shape> shape = std::make_unique<Shape>(*Shape::fetchShape(filePath));
+
+  float before = shape->acmr();
+  shape->optimize();
+  std::cout << "ACMR (" << VERTEX_CACHE_SIZE << " entry FIFO): " << before
+            << " -> " << shape->acmr() << std::endl;
+
+  return shape;
+}
+
+/**
+ * @brief Loads a shape from a 3D file and adds coarser levels of detail to it
+ * (see Shape::generateLODs), printing the triangles and error of each level
+ *
+ * @param filePath the path of the 3D file
+ * @param levels   the number of levels, including the full shape
+ *
+ * @return the shape with its levels of detail
+ */
+std::unique_ptr<Shape> lodShape(char *filePath, int levels) {
+  if (levels < 1)
+    throw std::invalid_argument("The number of levels must be positive");
+
+  std::unique_ptr<Shape> shape = std::make_unique<Shape>(*Shape::fetchShape(filePath));
+  shape->generateLODs(levels);
+
+  for (size_t l = 0; l < shape->lodCount(); l++)
+    std::cout << "LOD " << l << ": " << shape->lodTriangleCount(l)
+              << " triangles, error " << shape->lodError(l) << std::endl;
+
+  return shape;
+}
+
 /**
  * @brief Generates the requested shape
  *
@@ -74,17 +119,73 @@ std::unique_ptr<Shape> generateShape(int argc, char *argv[]) {
   case shapetoint((char *)"obj"):
     ASSERT_ARG_LENGTH(4);
     return generateFromObj(argv[2]);
-  case shapetoint((char *)"patch"):
+  case shapetoint((char *)"patch"): {
     ASSERT_ARG_LENGTH(5);
-    return generateBezierPatches(argv[2], std::stoi(argv[3]));
+    JobSystem jobs;
+    return generateBezierPatches(argv[2], std::stoi(argv[3]), &jobs);
+  }
+  case shapetoint((char *)"optimize"):
+    ASSERT_ARG_LENGTH(4);
+    return optimizeShape(argv[2]);
+  case shapetoint((char *)"lod"):
+    ASSERT_ARG_LENGTH(5);
+    return lodShape(argv[2], std::stoi(argv[3]));
   default:
     throw std::invalid_argument("No such shape");
   }
 }
 
+/**
+ * @brief Returns the surfaces of the requested shape, to be streamed to a
+ * file (see #streamSurfaces)
+ *
+ * @param argc the number of arguments received
+ * @param argv the arguments received
+ *
+ * @return the surfaces of the requested shape
+ *
+ * @throws invalid_argument if the arguments received do not follow the
+ * specification, or the shape can't be streamed
+ */
+std::vector<GridSurface> generateSurfaces(int argc, char *argv[]) {
+  switch (shapetoint(argv[1])) {
+  case shapetoint((char *)"sphere"):
+    ASSERT_ARG_LENGTH(6);
+    return sphereSurfaces(std::stof(argv[2]), std::stoi(argv[3]),
+                          std::stoi(argv[4]));
+  case shapetoint((char *)"box"):
+    ASSERT_ARG_LENGTH(5);
+    return cubeSurfaces(std::stof(argv[2]), std::stoi(argv[3]));
+  case shapetoint((char *)"cone"):
+    ASSERT_ARG_LENGTH(7);
+    return coneSurfaces(std::stof(argv[2]), std::stof(argv[3]),
+                        std::stoi(argv[4]), std::stoi(argv[5]));
+  case shapetoint((char *)"plane"):
+    ASSERT_ARG_LENGTH(5);
+    return planeSurfaces(std::stof(argv[2]), std::stoi(argv[3]));
+  case shapetoint((char *)"cylinder"):
+    ASSERT_ARG_LENGTH(6);
+    return cylinderSurfaces(std::stof(argv[2]), std::stof(argv[3]),
+                            std::stoi(argv[4]));
+  case shapetoint((char *)"donut"):
+    ASSERT_ARG_LENGTH(8);
+    return donutSurfaces(std::stof(argv[2]), std::stof(argv[3]),
+                         std::stof(argv[4]), std::stoi(argv[5]),
+                         std::stoi(argv[6]));
+  default:
+    throw std::invalid_argument("Only the sphere, box, cone, plane, cylinder and donut can be streamed");
+  }
+}
+
 /**
  * @brief Generator program entry point
  *
+ * The shape is written in the text format, unless the first argument is
+ * @c --binary, in which case the binary (memory-mappable) format is used.
+ * With @c --stream instead, the shape is generated in parallel and written
+ * to a binary file a few rows at a time, in bounded memory, but without
+ * welding nor optimizing its vertices
+ *
  * @param argc the number of arguments received
  * @param argv the arguments received
  *
@@ -93,9 +194,29 @@ std::unique_ptr<Shape> generateShape(int argc, char *argv[]) {
  */
 #ifndef ENGINE
 int main(int argc, char *argv[]) {
+  bool binary = argc > 1 && strcmp(argv[1], "--binary") == 0;
+  bool stream = argc > 1 && strcmp(argv[1], "--stream") == 0;
+  if (binary || stream) {
+    argv[1] = argv[0];
+    argc--;
+    argv++;
+  }
+
   try {
+    if (argc < 2)
+      throw std::invalid_argument("Wrong number of arguments");
+
+    if (stream) {
+      JobSystem jobs;
+      if (!streamSurfaces(generateSurfaces(argc, argv), argv[argc - 1], jobs)) {
+        std::cout << "Error saving shape to file" << std::endl;
+        return 1;
+      }
+      return 0;
+    }
+
     std::unique_ptr<Shape> shape = generateShape(argc, argv);
-    if (!shape->exportToFile(argv[argc - 1])) {
+    if (!shape->exportToFile(argv[argc - 1], binary)) {
       std::cout << "Error saving shape to file" << std::endl;
       return 1;
     };
@@ -103,6 +224,9 @@ int main(int argc, char *argv[]) {
   } catch (std::invalid_argument const &e) {
     std::cout << e.what() << std::endl;
     return 1;
+  } catch (InvalidXMLStructure const &e) {
+    std::cout << e.what() << std::endl;
+    return 1;
   }
 }
 #endif
@@ -10,7 +10,9 @@ Group::Group() { }
 
 Group::Group(const Group& group) :
   subgroups(group.subgroups),
-  models(group.models)
+  models(group.models),
+  bound(group.bound),
+  modelCount(group.modelCount)
 {
   for (auto& t : group.transformations) {
     Transformation* copy = t->clone();
@@ -22,7 +24,9 @@ Group::Group(const Group& group) :
 Group::Group(Group&& group) :
   subgroups(std::move(group.subgroups)),
   models(std::move(group.models)),
-  transformations(std::move(group.transformations))
+  transformations(std::move(group.transformations)),
+  bound(group.bound),
+  modelCount(group.modelCount)
 {}
 
 Group::Group(XMLParser parser) {
@@ -31,11 +35,14 @@ Group::Group(XMLParser parser) {
   constructSubGroups(parser);
   constructModels(parser);
   constructTransformations(parser);
+  computeBound();
 }
 
 Group& Group::operator=(const Group& group) {
   this->subgroups = group.subgroups;
   this->models = group.models;
+  this->bound = group.bound;
+  this->modelCount = group.modelCount;
 
   for (auto& t : group.transformations) {
     Transformation* copy = t->clone();
@@ -50,27 +57,47 @@ Group& Group::operator=(Group&& group) {
   this->subgroups = std::move(group.subgroups);
   this->models = std::move(group.models);
   this->transformations = std::move(group.transformations);
+  this->bound = group.bound;
+  this->modelCount = group.modelCount;
   return *this;
 }
 
-int Group::draw(const Frustum& viewFrustum) {
-  int count = 0;
-  glPushMatrix();
+void Group::computeBound() {
+  //the bound of the contents, in the coordinates of the group
+  this->bound = BoundingSphere();
+  this->modelCount = this->models.size();
 
-  for (auto &t : this->transformations) {
-    t->apply();
-  }
+  for (const Model& m : this->models)
+    this->bound.merge(m.getBound());
 
-  for (auto &m : this->models) {
-    count += m.draw(viewFrustum);
+  for (const Group& g : this->subgroups) {
+    this->bound.merge(g.bound);
+    this->modelCount += g.modelCount;
   }
 
-  for (auto &g : this->subgroups) {
-    count += g.draw(viewFrustum);
-  }
+  //the transformations are applied to the contents from the last to the first
+  for (auto t = this->transformations.rbegin(); t != this->transformations.rend(); t++)
+    this->bound = (*t)->bound(this->bound);
+}
+
+std::vector<Group>& Group::getSubgroups() {
+  return this->subgroups;
+}
+
+std::vector<Model>& Group::getModels() {
+  return this->models;
+}
+
+const std::vector<std::unique_ptr<Transformation>>& Group::getTransformations() const {
+  return this->transformations;
+}
 
-  glPopMatrix();
-  return count;
+const BoundingSphere& Group::getBound() const {
+  return this->bound;
+}
+
+int Group::getModelCount() const {
+  return this->modelCount;
 }
 
 void Group::assertValidXML(XMLParser parser) {
@@ -104,4 +131,6 @@ void Group::constructTransformations(XMLParser parser) {
       this->transformations.push_back(std::move(Transformation::parse(transformTag)));
     }
   }
+
+  Transformation::fold(this->transformations);
 }
\ No newline at end of file
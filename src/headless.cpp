@@ -0,0 +1,254 @@
+/**
+ * @file headless.cpp
+ *
+ * @brief File implementing the headless context and benchmark run of the engine
+ */
+
+#include "glut.hpp"
+#include "headless.hpp"
+#include "patchtessellator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef __linux__
+/**
+ * @brief Returns the display of Mesa's surfaceless platform, which needs no
+ * display server, or the default display if EGL doesn't have it
+*/
+static EGLDisplay headlessDisplay() {
+  auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay != nullptr) {
+    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+      return display;
+  }
+
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+    throw std::runtime_error("Error creating the headless context: no EGL display");
+
+  return display;
+}
+#endif
+
+HeadlessContext::HeadlessContext(int width, int height) :
+  display(nullptr),
+  context(nullptr),
+  framebuffer(0),
+  colorBuffer(0),
+  depthBuffer(0)
+{
+#ifdef __linux__
+  EGLDisplay eglDisplay = headlessDisplay();
+  display = eglDisplay;
+
+  //the engine draws with the compatibility profile of desktop GL. The
+  //surfaceless platform only has configs for pbuffers, not windows (the default)
+  EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+  EGLConfig config;
+  EGLint configs = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configs) || configs == 0) {
+    eglTerminate(eglDisplay);
+    throw std::runtime_error("Error creating the headless context: no desktop OpenGL config");
+  }
+
+  //no surface, the framebuffer object is drawn into instead
+  context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, nullptr);
+  if (context == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    if (context != EGL_NO_CONTEXT)
+      eglDestroyContext(eglDisplay, context);
+    eglTerminate(eglDisplay);
+    throw std::runtime_error("Error creating the headless context: can't make a context current");
+  }
+
+  //GLEW loads the functions of the current context, and only fails after
+  //that, looking for the window system's extensions
+  glewInit();
+  if (!GLEW_VERSION_3_0) {
+    destroy();
+    throw std::runtime_error("Error creating the headless context: framebuffer objects need OpenGL 3.0");
+  }
+
+  glGenRenderbuffers(1, &colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+  glGenRenderbuffers(1, &depthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    destroy();
+    throw std::runtime_error("Error creating the headless context: incomplete framebuffer");
+  }
+
+  glDrawBuffer(GL_COLOR_ATTACHMENT0);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glViewport(0, 0, width, height);
+#else
+  throw std::runtime_error("Error creating the headless context: only supported with EGL, on Linux");
+#endif
+}
+
+HeadlessContext::~HeadlessContext() {
+  destroy();
+}
+
+void HeadlessContext::destroy() {
+#ifdef __linux__
+  if (context == nullptr)
+    return;
+
+  if (framebuffer != 0)
+    glDeleteFramebuffers(1, &framebuffer);
+  if (colorBuffer != 0)
+    glDeleteRenderbuffers(1, &colorBuffer);
+  if (depthBuffer != 0)
+    glDeleteRenderbuffers(1, &depthBuffer);
+
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display, context);
+  eglTerminate(display);
+  context = nullptr;
+#endif
+}
+
+std::string HeadlessContext::renderer() const {
+  const GLubyte* name = glGetString(GL_RENDERER);
+  return name == nullptr ? "" : (const char*) name;
+}
+
+/**
+ * @brief Writes a string as a JSON string literal
+*/
+static void writeJSONString(std::ostream& out, const std::string& s) {
+  out << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if ((unsigned char) c >= ' ')
+      out << c;
+  }
+  out << '"';
+}
+
+/**
+ * @brief Returns the nearest-rank percentile of sorted values
+*/
+static double percentile(const std::vector<double>& sorted, double p) {
+  size_t rank = (size_t) std::ceil(p / 100 * sorted.size());
+  return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+/**
+ * @brief Writes the median of some values, or null if there are none
+*/
+static void writeMedian(std::ostream& out, std::vector<double>& values) {
+  if (values.empty()) {
+    out << "null";
+    return;
+  }
+
+  std::sort(values.begin(), values.end());
+  out << percentile(values, 50);
+}
+
+void runHeadless(World& world, const std::string& scene, int frames, int width, int height, std::ostream& out) {
+  if (frames < 1)
+    throw std::invalid_argument("A headless run renders at least one frame");
+
+  //the patches are tessellated on the frame that asks for them, so every
+  //run draws the same frames
+  PatchTessellator::setSynchronous(true);
+
+  HeadlessContext context(width, height);
+  world.initGL();
+  world.changeSize(width, height);
+
+  std::vector<double> times;
+  times.reserve(frames);
+  DrawStats total;
+  for (int f = 0; f < frames; f++) {
+    auto start = std::chrono::steady_clock::now();
+    DrawStats stats = world.renderFrame(f * HEADLESS_FRAME_TIME);
+    glFinish();
+    times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    total.culledModels += stats.culledModels;
+    total.culledGroups += stats.culledGroups;
+    total.drawCalls += stats.drawCalls;
+    total.triangles += stats.triangles;
+    total.shapeChanges += stats.shapeChanges;
+    total.textureChanges += stats.textureChanges;
+    total.materialChanges += stats.materialChanges;
+  }
+
+  //the GPU timings of the last frames, before the context is destroyed
+  Profiler& profiler = world.getProfiler();
+  profiler.flush();
+
+  std::vector<double> cpuStages[PROFILE_STAGES], gpuStages[PROFILE_STAGES];
+  for (size_t i = 0; i < profiler.frameCount(); i++) {
+    const FrameProfile& profile = profiler.frame(i);
+    for (size_t s = 0; s < PROFILE_STAGES; s++) {
+      cpuStages[s].push_back(profile.cpu[s]);
+      if (profile.gpu[s] >= 0)
+        gpuStages[s].push_back(profile.gpu[s]);
+    }
+  }
+
+  double sum = 0;
+  for (double t : times)
+    sum += t;
+  std::vector<double> sorted = times;
+  std::sort(sorted.begin(), sorted.end());
+  double count = std::max(frames, 1);
+
+  out << "{\n  \"scene\": ";
+  writeJSONString(out, scene);
+  out << ",\n  \"renderer\": ";
+  writeJSONString(out, context.renderer());
+  out << ",\n  \"frames\": " << frames
+      << ",\n  \"width\": " << width
+      << ",\n  \"height\": " << height
+      << ",\n  \"frameTimeMs\": {";
+  if (!sorted.empty()) {
+    out << "\"mean\": " << sum / count
+        << ", \"min\": " << sorted.front()
+        << ", \"p50\": " << percentile(sorted, 50)
+        << ", \"p90\": " << percentile(sorted, 90)
+        << ", \"p95\": " << percentile(sorted, 95)
+        << ", \"p99\": " << percentile(sorted, 99)
+        << ", \"max\": " << sorted.back();
+  }
+  out << "},\n  \"stageMs\": {";
+  for (size_t s = 0; s < PROFILE_STAGES; s++) {
+    out << (s == 0 ? "" : ", ") << '"' << profileStageName((ProfileStage) s) << "\": {\"cpu\": ";
+    writeMedian(out, cpuStages[s]);
+    out << ", \"gpu\": ";
+    writeMedian(out, gpuStages[s]);
+    out << "}";
+  }
+  out << "},\n  \"perFrame\": {"
+      << "\"drawCalls\": " << total.drawCalls / count
+      << ", \"triangles\": " << total.triangles / count
+      << ", \"culledModels\": " << total.culledModels / count
+      << ", \"culledGroups\": " << total.culledGroups / count
+      << ", \"shapeChanges\": " << total.shapeChanges / count
+      << ", \"textureChanges\": " << total.textureChanges / count
+      << ", \"materialChanges\": " << total.materialChanges / count
+      << "}\n}" << std::endl;
+}
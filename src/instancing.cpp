@@ -0,0 +1,210 @@
+/**
+ * @file instancing.cpp
+ *
+ * @brief File implementing the instanced drawing of models
+ */
+
+#include "glut.hpp"
+#include "instancing.hpp"
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Places the instance with its modelview matrix and lights it like
+ * the fixed-function pipeline does
+ *
+ * The matrix is read from the attribute row by row, so the GLSL matrix is its
+ * transpose, and the vertex is multiplied with it on the left.
+*/
+static const char* vertexSource = R"(
+#version 120
+
+attribute mat4 instanceModelview;
+uniform bool lightEnabled[8];
+
+varying vec4 color;
+varying vec2 textureCoordinate;
+
+void main() {
+  vec4 eye = gl_Vertex * instanceModelview;
+  gl_Position = gl_ProjectionMatrix * eye;
+
+  //the normal is transformed by the inverse transpose of the upper 3x3 of
+  //the modelview: its cofactors, divided by the determinant, whose size is
+  //removed by normalizing
+  vec3 r0 = instanceModelview[0].xyz, r1 = instanceModelview[1].xyz, r2 = instanceModelview[2].xyz;
+  vec3 normal = gl_Normal * mat3(cross(r1, r2), cross(r2, r0), cross(r0, r1));
+  normal = normalize(normal) * sign(dot(r0, cross(r1, r2)));
+
+  vec4 sum = gl_FrontLightModelProduct.sceneColor;
+  for (int i = 0; i < 8; i++) {
+    if (!lightEnabled[i])
+      continue;
+
+    vec3 l = gl_LightSource[i].position.xyz;
+    float attenuation = 1.0;
+    if (gl_LightSource[i].position.w != 0.0) {
+      l -= eye.xyz;
+      float distance = length(l);
+      attenuation = 1.0 / (gl_LightSource[i].constantAttenuation + gl_LightSource[i].linearAttenuation * distance
+                           + gl_LightSource[i].quadraticAttenuation * distance * distance);
+    }
+    l = normalize(l);
+
+    if (gl_LightSource[i].spotCutoff != 180.0) {
+      float spot = dot(-l, normalize(gl_LightSource[i].spotDirection));
+      attenuation *= spot >= gl_LightSource[i].spotCosCutoff ? pow(spot, gl_LightSource[i].spotExponent) : 0.0;
+    }
+
+    sum += attenuation * gl_FrontLightProduct[i].ambient;
+
+    float diffuse = dot(normal, l);
+    if (diffuse > 0.0) {
+      float highlight = max(dot(normal, normalize(l + vec3(0.0, 0.0, 1.0))), 0.0);
+      float specular = gl_FrontMaterial.shininess == 0.0 ? 1.0 : pow(highlight, gl_FrontMaterial.shininess);
+      sum += attenuation * (diffuse * gl_FrontLightProduct[i].diffuse + specular * gl_FrontLightProduct[i].specular);
+    }
+  }
+
+  color = clamp(vec4(sum.rgb, gl_FrontMaterial.diffuse.a), 0.0, 1.0);
+  textureCoordinate = gl_MultiTexCoord0.xy;
+}
+)";
+
+/**
+ * @brief Modulates the lit color with the texture, like GL_MODULATE
+*/
+static const char* fragmentSource = R"(
+#version 120
+
+uniform sampler2D image;
+uniform bool textured;
+
+varying vec4 color;
+varying vec2 textureCoordinate;
+
+void main() {
+  gl_FragColor = textured ? color * texture2D(image, textureCoordinate) : color;
+}
+)";
+
+/**
+ * @brief Compiles a shader
+ *
+ * @throws std::runtime_error with the compiler's log if it fails
+*/
+static GLuint compileShader(GLenum type, const char* source) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+
+  GLint status;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024] = {};
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    glDeleteShader(shader);
+    throw std::runtime_error("Error compiling the instancing shader: " + std::string(log));
+  }
+
+  return shader;
+}
+
+InstanceRenderer::InstanceRenderer() :
+  program(0),
+  instanceBuffer(0),
+  lightsLocation(-1),
+  texturedLocation(-1)
+{}
+
+InstanceRenderer::~InstanceRenderer() {
+  if (program != 0)
+    glDeleteProgram(program);
+
+  if (instanceBuffer != 0)
+    glDeleteBuffers(1, &instanceBuffer);
+}
+
+void InstanceRenderer::initialize() {
+  if (program != 0 || !GLEW_VERSION_3_3)
+    return;
+
+  GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource);
+  GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+  program = glCreateProgram();
+  glAttachShader(program, vertex);
+  glAttachShader(program, fragment);
+  glBindAttribLocation(program, INSTANCE_ATTRIBUTE, "instanceModelview");
+  glLinkProgram(program);
+
+  //the program keeps the shaders until it's deleted
+  glDeleteShader(vertex);
+  glDeleteShader(fragment);
+
+  GLint status;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024] = {};
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    glDeleteProgram(program);
+    program = 0;
+    throw std::runtime_error("Error linking the instancing shader: " + std::string(log));
+  }
+
+  lightsLocation = glGetUniformLocation(program, "lightEnabled");
+  texturedLocation = glGetUniformLocation(program, "textured");
+
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "image"), 0);
+  glUseProgram(0);
+
+  glGenBuffers(1, &instanceBuffer);
+}
+
+bool InstanceRenderer::available() const {
+  return program != 0;
+}
+
+void InstanceRenderer::begin(const std::vector<Mat4>& modelviews) {
+  glUseProgram(program);
+
+  //the lights are the ones Lighting::setupScene enabled for the frame
+  GLint enabled[INSTANCE_LIGHTS];
+  for (int i = 0; i < INSTANCE_LIGHTS; i++)
+    enabled[i] = glIsEnabled(GL_LIGHT0 + i);
+  glUniform1iv(lightsLocation, INSTANCE_LIGHTS, enabled);
+
+  //the whole buffer is replaced, so GL can give it new memory instead of
+  //waiting for the draws of the previous frame
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  glBufferData(GL_ARRAY_BUFFER, modelviews.size() * sizeof(Mat4), modelviews.data(), GL_STREAM_DRAW);
+
+  for (GLuint row = 0; row < 4; row++) {
+    glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + row);
+    glVertexAttribDivisor(INSTANCE_ATTRIBUTE + row, 1);
+  }
+}
+
+void InstanceRenderer::draw(const Model& model, size_t first, size_t count) {
+  glUniform1i(texturedLocation, model.getTexture() != nullptr);
+
+  //the attributes keep reading from the instance buffer when the next shape
+  //binds its own vertex buffer
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  for (GLuint row = 0; row < 4; row++)
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE + row, 4, GL_FLOAT, GL_FALSE, sizeof(Mat4),
+                          (void*)(first * sizeof(Mat4) + row * 4 * sizeof(float)));
+
+  model.getShape()->drawBound(model.getLOD(), count);
+}
+
+void InstanceRenderer::end() {
+  for (GLuint row = 0; row < 4; row++) {
+    glVertexAttribDivisor(INSTANCE_ATTRIBUTE + row, 0);
+    glDisableVertexAttribArray(INSTANCE_ATTRIBUTE + row);
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glUseProgram(0);
+}
@@ -0,0 +1,126 @@
+/**
+ * @file jobsystem.cpp
+ *
+ * @brief File implementing the work stealing pool of threads
+ */
+
+#include "jobsystem.hpp"
+#include <algorithm>
+
+JobSystem::JobSystem(unsigned int threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned int t = 0; t < threads; t++)
+    queues.push_back(std::make_unique<Queue>());
+
+  for (unsigned int t = 1; t < threads; t++)
+    workers.emplace_back(&JobSystem::workerLoop, this, t);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+
+  for (std::thread& w : workers)
+    w.join();
+}
+
+unsigned int JobSystem::threadCount() const {
+  return queues.size();
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const JobBody& body) {
+  grain = std::max<size_t>(grain, 1);
+  if (count <= grain || workers.empty()) {
+    if (count > 0)
+      body(0, count);
+    return;
+  }
+
+  //the body and grain are published to the workers by the queue they take
+  //the ranges from
+  this->body = &body;
+  this->grain = grain;
+  remaining = count;
+  run(0, { 0, count });
+
+  Job job;
+  while (remaining > 0) {
+    if (take(0, job))
+      run(0, job);
+    else
+      std::this_thread::yield();
+  }
+
+  this->body = nullptr;
+}
+
+bool JobSystem::take(unsigned int thread, Job& job) {
+  {
+    Queue& own = *queues[thread];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = own.jobs.back();
+      own.jobs.pop_back();
+      queued--;
+      return true;
+    }
+  }
+
+  for (size_t k = 1; k < queues.size(); k++) {
+    Queue& victim = *queues[(thread + k) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = victim.jobs.front();
+      victim.jobs.pop_front();
+      queued--;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void JobSystem::run(unsigned int thread, Job job) {
+  while (job.end - job.begin > grain) {
+    size_t middle = job.begin + (job.end - job.begin) / 2;
+
+    //counted before it's pushed, so the count never falls below the ranges
+    //in the queues. The workers check it while holding the lock, so they
+    //can't miss it and sleep
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      queued++;
+    }
+    {
+      Queue& own = *queues[thread];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.jobs.push_back({ middle, job.end });
+    }
+    wake.notify_one();
+
+    job.end = middle;
+  }
+
+  (*body)(job.begin, job.end);
+  remaining -= job.end - job.begin;
+}
+
+void JobSystem::workerLoop(unsigned int thread) {
+  Job job;
+  while (true) {
+    if (take(thread, job)) {
+      run(thread, job);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wake.wait(lock, [this]() { return stopping || queued > 0; });
+    if (stopping)
+      return;
+  }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file mappedfile.cpp
+ *
+ * @brief File implementing the @link MappedFile class
+ */
+
+#include "mappedfile.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string filePath) : bytes(nullptr), length(0), file(nullptr), mapping(nullptr) {
+  HANDLE f = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (f == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Can't open file '" + filePath + "'");
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(f, &size) || size.QuadPart == 0) {
+    CloseHandle(f);
+    throw std::runtime_error("Can't map empty file '" + filePath + "'");
+  }
+
+  HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+  void* view = m != NULL ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : NULL;
+  if (view == NULL) {
+    if (m != NULL)
+      CloseHandle(m);
+    CloseHandle(f);
+    throw std::runtime_error("Can't map file '" + filePath + "'");
+  }
+
+  this->file = f;
+  this->mapping = m;
+  this->bytes = (const unsigned char*)view;
+  this->length = (size_t)size.QuadPart;
+}
+
+MappedFile::~MappedFile() {
+  UnmapViewOfFile(bytes);
+  CloseHandle((HANDLE)mapping);
+  CloseHandle((HANDLE)file);
+}
+
+#else
+
+MappedFile::MappedFile(std::string filePath) : bytes(nullptr), length(0) {
+  int fd = open(filePath.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Can't open file '" + filePath + "'");
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    throw std::runtime_error("Can't map empty file '" + filePath + "'");
+  }
+
+  void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); //the mapping keeps its own reference to the file
+
+  if (view == MAP_FAILED)
+    throw std::runtime_error("Can't map file '" + filePath + "'");
+
+  this->bytes = (const unsigned char*)view;
+  this->length = st.st_size;
+}
+
+MappedFile::~MappedFile() {
+  munmap((void*)bytes, length);
+}
+
+#endif
+
+const unsigned char* MappedFile::data() const {
+  return bytes;
+}
+
+size_t MappedFile::size() const {
+  return length;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file matrixstack.cpp
+ *
+ * @brief File implementing the CPU matrix stack
+ */
+
+#include "glut.hpp"
+
+#include "matrixstack.hpp"
+#include <cmath>
+
+MatrixStack::MatrixStack() : matrices({ identity<4>() }) {}
+
+const Mat4& MatrixStack::top() const {
+  return matrices.back();
+}
+
+void MatrixStack::push() {
+  matrices.push_back(matrices.back());
+}
+
+void MatrixStack::pop() {
+  if (matrices.size() > 1)
+    matrices.pop_back();
+}
+
+void MatrixStack::load(const Mat4& m) {
+  matrices.back() = m;
+}
+
+void MatrixStack::multiply(const Mat4& m) {
+  matrices.back() = matrices.back() * m;
+}
+
+void MatrixStack::translate(float x, float y, float z) {
+  //only the last column changes
+  Mat4& m = matrices.back();
+  for (size_t i = 0; i < 4; i++)
+    m(i, 3) = m(i, 0) * x + m(i, 1) * y + m(i, 2) * z + m(i, 3);
+}
+
+void MatrixStack::rotate(float angle, float x, float y, float z) {
+  float l = std::sqrt(x * x + y * y + z * z);
+  if (l == 0)
+    return;
+
+  x /= l;
+  y /= l;
+  z /= l;
+
+  float a = angle * M_PI / 180;
+  float c = std::cos(a), s = std::sin(a), t = 1 - c;
+
+  multiply({
+    x * x * t + c,     x * y * t - z * s, x * z * t + y * s, 0,
+    y * x * t + z * s, y * y * t + c,     y * z * t - x * s, 0,
+    z * x * t - y * s, z * y * t + x * s, z * z * t + c,     0,
+    0,                 0,                 0,                 1
+  });
+}
+
+void MatrixStack::scale(float x, float y, float z) {
+  Mat4& m = matrices.back();
+  for (size_t i = 0; i < 4; i++) {
+    m(i, 0) *= x;
+    m(i, 1) *= y;
+    m(i, 2) *= z;
+  }
+}
+
+void MatrixStack::lookAt(const Point& eye, const Point& center, const Vector& up) {
+  //the camera looks down its -z axis, with y as close to up as possible
+  Vector f = normalize(center - eye);
+  Vector s = normalize(f ^ up);
+  Vector u = s ^ f;
+
+  load({
+    s.x,  s.y,  s.z,  0,
+    u.x,  u.y,  u.z,  0,
+    -f.x, -f.y, -f.z, 0,
+    0,    0,    0,    1
+  });
+  translate(-eye.x, -eye.y, -eye.z);
+}
+
+void MatrixStack::upload() const {
+  loadMatrix(matrices.back());
+}
+
+void loadMatrix(const Mat4& m) {
+  //GL stores matrices in column-major order
+  glLoadMatrixf(transpose(m).data());
+}
@@ -0,0 +1,283 @@
+/**
+ * @file meshoptimizer.cpp
+ *
+ * @brief File implementing the reordering of the triangles and vertices of
+ * indexed meshes
+ */
+
+#include "meshoptimizer.hpp"
+#include <algorithm>
+
+/**
+ * @brief Simulates a FIFO post-transform vertex cache
+*/
+class VertexCache {
+public:
+  VertexCache(size_t vertexCount, unsigned int size) :
+    insertedAt(vertexCount, 0),
+    size(size),
+    time(size + 1)
+  {}
+
+  /**
+   * @brief Looks up a vertex in the cache, adding it if it isn't there
+   *
+   * @return whether the vertex wasn't in the cache
+  */
+  bool miss(int vertex) {
+    if (time - insertedAt[vertex] <= size)
+      return false;
+
+    insertedAt[vertex] = time++;
+    return true;
+  }
+
+  /**
+   * @brief Empties the cache
+  */
+  void clear() {
+    time += size + 1;
+  }
+
+private:
+  std::vector<size_t> insertedAt; ///< When each vertex was last added to the cache
+  size_t size;
+  size_t time; ///< The number of vertices added so far (plus size + 1)
+};
+
+float vertexCacheACMR(const std::vector<int>& indices, size_t vertexCount, unsigned int cacheSize) {
+  if (indices.size() < 3)
+    return 0;
+
+  VertexCache cache(vertexCount, cacheSize);
+  size_t misses = 0;
+  for (int i : indices)
+    misses += cache.miss(i);
+
+  return (float)misses / (indices.size() / 3);
+}
+
+std::vector<int> optimizeVertexCache(std::vector<int>& indices, size_t vertexCount, unsigned int cacheSize) {
+  size_t triangleCount = indices.size() / 3;
+
+  //the triangles each vertex is part of, and how many of them weren't emitted
+  std::vector<int> live(vertexCount, 0);
+  for (int i : indices)
+    live[i]++;
+
+  std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++)
+    adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+
+  std::vector<int> adjacency(indices.size());
+  std::vector<size_t> filled(adjacencyStart.begin(), adjacencyStart.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++)
+    adjacency[filled[indices[i]]++] = i / 3;
+
+  std::vector<size_t> cacheTime(vertexCount, 0);
+  size_t time = cacheSize + 1;
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<int> deadEnds; //recently emitted vertices, to continue from when a fan has no good successor
+  size_t cursor = 0; //the vertices before it have no live triangles left
+
+  //returns the next vertex with live triangles, when the last fan left none in the cache
+  auto skipDeadEnd = [&]() {
+    while (!deadEnds.empty()) {
+      int v = deadEnds.back();
+      deadEnds.pop_back();
+      if (live[v] > 0)
+        return v;
+    }
+
+    for (; cursor < vertexCount; cursor++)
+      if (live[cursor] > 0)
+        return (int)cursor;
+
+    return -1;
+  };
+
+  std::vector<int> output, clusters, candidates;
+  output.reserve(indices.size());
+
+  int fan = skipDeadEnd();
+  if (fan >= 0)
+    clusters.push_back(0);
+
+  while (fan >= 0) {
+    //emit every triangle around the vertex
+    candidates.clear();
+    for (size_t k = adjacencyStart[fan]; k < adjacencyStart[fan + 1]; k++) {
+      int t = adjacency[k];
+      if (emitted[t])
+        continue;
+
+      for (int c = 0; c < 3; c++) {
+        int v = indices[3 * t + c];
+        output.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+
+        if (time - cacheTime[v] > cacheSize)
+          cacheTime[v] = time++;
+      }
+      emitted[t] = true;
+    }
+
+    //continue from the oldest vertex that stays in the cache while its fan is emitted
+    int next = -1;
+    size_t best = 0;
+    for (int v : candidates) {
+      if (live[v] == 0)
+        continue;
+
+      size_t age = time - cacheTime[v];
+      if (age + 2 * live[v] <= cacheSize && age > best) {
+        best = age;
+        next = v;
+      }
+    }
+
+    if (next < 0) {
+      next = skipDeadEnd();
+      if (next >= 0)
+        clusters.push_back(output.size() / 3);
+    }
+
+    fan = next;
+  }
+
+  indices = output;
+  return clusters;
+}
+
+/**
+ * @brief Splits the clusters of triangles where the ACMR of the triangles since
+ * the last split is within threshold times the ACMR of the whole cluster
+*/
+static std::vector<int> splitClusters(const std::vector<int>& indices, size_t vertexCount,
+                                      const std::vector<int>& clusters, float threshold) {
+  size_t triangleCount = indices.size() / 3;
+  VertexCache cache(vertexCount, VERTEX_CACHE_SIZE);
+  std::vector<int> split;
+
+  for (size_t c = 0; c < clusters.size(); c++) {
+    size_t begin = clusters[c];
+    size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+    cache.clear();
+    size_t misses = 0;
+    for (size_t i = 3 * begin; i < 3 * end; i++)
+      misses += cache.miss(indices[i]);
+    float limit = threshold * misses / (end - begin);
+
+    split.push_back(begin);
+    cache.clear();
+    misses = 0;
+    size_t start = begin;
+    for (size_t t = begin; t < end; t++) {
+      for (int k = 0; k < 3; k++)
+        misses += cache.miss(indices[3 * t + k]);
+
+      if (t + 1 < end && (float)misses / (t + 1 - start) <= limit) {
+        split.push_back(t + 1);
+        start = t + 1;
+        cache.clear();
+        misses = 0;
+      }
+    }
+  }
+
+  return split;
+}
+
+/**
+ * @brief Returns the triangles with the clusters sorted so that the ones facing
+ * away from the center of the mesh come first
+*/
+static std::vector<int> sortClusters(const std::vector<int>& indices, const std::vector<Point>& points,
+                                     const std::vector<int>& clusters) {
+  size_t triangleCount = indices.size() / 3;
+
+  Point meshCenter = zero();
+  for (int i : indices)
+    meshCenter += points[i];
+  meshCenter = meshCenter / (float)indices.size();
+
+  //how much each cluster faces away from the center of the mesh
+  std::vector<float> facing(clusters.size());
+  for (size_t c = 0; c < clusters.size(); c++) {
+    size_t begin = clusters[c];
+    size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+    Vector normal = zero(); //sum of the normals weighted by (twice) the area
+    Point center = zero();
+    float area = 0;
+    for (size_t t = begin; t < end; t++) {
+      const Point& a = points[indices[3 * t]];
+      const Point& b = points[indices[3 * t + 1]];
+      const Point& d = points[indices[3 * t + 2]];
+
+      Vector n = (b - a) ^ (d - a);
+      float l = length(n);
+      normal += n;
+      center += l * (a + b + d);
+      area += l;
+    }
+
+    float l = length(normal);
+    if (area > 0 && l > 0)
+      facing[c] = (center / (3 * area) - meshCenter) * (normal / l);
+  }
+
+  std::vector<int> order(clusters.size());
+  for (size_t c = 0; c < order.size(); c++)
+    order[c] = c;
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return facing[a] > facing[b]; });
+
+  std::vector<int> sorted;
+  sorted.reserve(indices.size());
+  for (int c : order) {
+    size_t begin = clusters[c];
+    size_t end = c + 1 < (int)clusters.size() ? clusters[c + 1] : triangleCount;
+    sorted.insert(sorted.end(), indices.begin() + 3 * begin, indices.begin() + 3 * end);
+  }
+
+  return sorted;
+}
+
+void optimizeOverdraw(std::vector<int>& indices, const std::vector<Point>& points,
+                      const std::vector<int>& clusters, float threshold) {
+  if (indices.size() < 3)
+    return;
+
+  //sorting the clusters breaks the cache reuse across them, so smaller clusters
+  //are only kept if that doesn't cost more than the threshold, and any order
+  //only if it costs less than the threshold
+  float limit = threshold * vertexCacheACMR(indices, points.size());
+
+  for (const std::vector<int>& c : { splitClusters(indices, points.size(), clusters, threshold), clusters }) {
+    std::vector<int> sorted = sortClusters(indices, points, c);
+    if (vertexCacheACMR(sorted, points.size()) <= limit) {
+      indices = sorted;
+      return;
+    }
+  }
+}
+
+std::vector<int> optimizeVertexFetch(std::vector<int>& indices, size_t vertexCount) {
+  std::vector<int> remap(vertexCount, -1);
+  int next = 0;
+
+  for (int& i : indices) {
+    if (remap[i] < 0)
+      remap[i] = next++;
+    i = remap[i];
+  }
+
+  for (int& r : remap)
+    if (r < 0)
+      r = next++;
+
+  return remap;
+}
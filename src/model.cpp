@@ -5,6 +5,9 @@
 #include <cstring>
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include "model.hpp"
 #include "parser.hpp"
@@ -12,11 +15,7 @@
 Model::Model(Shape shape, Texture texture, Color emission, Color ambient, Color diffuse, Color specular, float shininess) :
   shape(std::move(std::shared_ptr<Shape>(new Shape(shape)))),
   texture(std::move(std::shared_ptr<Texture>(new Texture(texture)))),
-  emission(emission),
-  ambient(ambient),
-  diffuse(diffuse),
-  specular(specular),
-  shininess(shininess)
+  material({ emission, ambient, diffuse, specular, shininess })
 {}
 
 void Model::readColor(XMLParser color) {
@@ -24,7 +23,7 @@ void Model::readColor(XMLParser color) {
 
   if (color.get_opt_attr("hex", colorHex)) {
 
-    this->diffuse = parseHexColor(colorHex);
+    this->material.diffuse = parseHexColor(colorHex);
 
     if (color.get_nodes().size() != 0)
       throw InvalidXMLStructure("Can't define both hex and color values for a given color");
@@ -33,26 +32,22 @@ void Model::readColor(XMLParser color) {
       node.validate_node({});
       node.validate_attrs({"R","G","B","value"});
       if (node.name() == "diffuse")
-        diffuse = node.as_tuple<float,float,float>({"R","G","B"}) / 255.0f;
+        material.diffuse = node.as_tuple<float,float,float>({"R","G","B"}) / 255.0f;
       else if (node.name() == "ambient")
-        ambient = node.as_tuple<float,float,float>({"R","G","B"}) / 255.0f;
+        material.ambient = node.as_tuple<float,float,float>({"R","G","B"}) / 255.0f;
       else if (node.name() == "specular")
-        specular = node.as_tuple<float,float,float>({"R","G","B"}) / 255.0f;
+        material.specular = node.as_tuple<float,float,float>({"R","G","B"}) / 255.0f;
       else if (node.name() == "emissive")
-        emission = node.as_tuple<float,float,float>({"R","G","B"}) / 255.0f;
+        material.emission = node.as_tuple<float,float,float>({"R","G","B"}) / 255.0f;
       else //shininess
-        shininess = node.get_attr<float>("value");
+        material.shininess = node.get_attr<float>("value");
     }
   }
 }
 
 Model::Model(XMLParser parser) : 
   texture(nullptr),
-  emission({0, 0, 0}),
-  ambient({0.2, 0.2, 0.2}),
-  diffuse({0.8, 0.8, 0.8}),
-  specular({0, 0, 0}),
-  shininess(0)
+  material({ {0, 0, 0}, {0.2, 0.2, 0.2}, {0.8, 0.8, 0.8}, {0, 0, 0}, 0 })
 {
   /**
    * @brief parses the model atribute from the xml parser into a Model object
@@ -60,9 +55,29 @@ Model::Model(XMLParser parser) :
    */
   parser.validate_node({"texture", "color"});
   parser.validate_max_nodes(1, {"texture", "color"});
-  parser.validate_attrs({"file"});
-
-  this->shape = Shape::fetchShape(parser.get_attr<std::string>("file"));
+  parser.validate_attrs({"file", "divisions"});
+
+  std::string file = parser.get_attr<std::string>("file");
+  int divisions = 0;
+  bool patch = file.size() >= 6 && file.compare(file.size() - 6, 6, ".patch") == 0;
+  bool fixedDivisions = parser.get_opt_attr("divisions", divisions);
+  if (fixedDivisions && !patch)
+    throw InvalidXMLStructure("Only the models of .patch files have divisions");
+  if (fixedDivisions && divisions < 2)
+    throw InvalidXMLStructure("The divisions of a model must be at least 2");
+
+  //the Bezier patches are tessellated as they are loaded with the divisions
+  //given, and otherwise as finely as the model's size on the screen needs,
+  //starting from the coarsest level
+  if (!patch) {
+    this->shape = Shape::fetchShape(file);
+  } else if (fixedDivisions) {
+    this->shape = Shape::fetchPatchShape(file, divisions);
+  } else {
+    this->tessellator = PatchTessellator::fetchTessellator(file);
+    this->tessellationLevel = this->tessellator->levelCount() - 1;
+    this->shape = this->tessellator->coarsestLevel();
+  }
 
   for (XMLParser node : parser.get_nodes()) {
     if (node.name() == "color")
@@ -81,35 +96,130 @@ Model::Model(XMLParser parser) :
   }  
 }
 
-int Model::draw(const Frustum& viewFrustum)
-{
-  float modelview[16];
-  glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
-  transpose(4, 4, modelview); //glut stores matrices in column-major order. we want row-major
+BoundingSphere Model::getBound() const {
+  //the levels are swapped after the group bounds are computed, so they're
+  //bound by one containing all of them
+  if (tessellator != nullptr)
+    return tessellator->getBoundingBox().boundingSphere();
+  return shape->getBoundingBox().boundingSphere();
+}
+
+/**
+ * @brief Returns the coarsest of the levels, ordered from the finest, whose
+ * error on the screen is within the one allowed, moving from the current
+ * level only past #LOD_HYSTERESIS
+ *
+ * The errors are scaled by the largest scale of the modelview, and projected
+ * at the distance of the closest point of the bounding box.
+ *
+ * @param error the error of a level, in the coordinates of the model
+*/
+template <typename LevelError>
+static size_t selectLevel(size_t current, size_t levels, LevelError error,
+                          const DrawContext& context, const Mat4& modelview, const BoundingBox& bb) {
+  float scale = maxScale(modelview);
+  float distance = std::max(bb.distanceFrom(zero()), std::numeric_limits<float>::min());
+  float pixelsPerError = scale * context.screenScale / distance;
+  float allowed = LOD_PIXEL_ERROR * exp2(context.lodBias);
+
+  size_t level = std::min(current, levels - 1);
+  while (level + 1 < levels && error(level + 1) * pixelsPerError <= allowed / (1 + LOD_HYSTERESIS))
+    level++;
+  while (level > 0 && error(level) * pixelsPerError > allowed * (1 + LOD_HYSTERESIS))
+    level--;
+  return level;
+}
+
+void Model::selectLOD(const DrawContext& context, const Mat4& modelview, const BoundingBox& bb) {
+  size_t levels = shape->lodCount();
+  if (levels == 1) {
+    this->lod = 0;
+    return;
+  }
+
+  this->lod = selectLevel(this->lod, levels, [this](size_t l) { return shape->lodError(l); },
+                          context, modelview, bb);
+}
+
+void Model::selectTessellation(const DrawContext& context, const Mat4& modelview, const BoundingBox& bb) {
+  const PatchTessellator& t = *this->tessellator;
+  this->tessellationLevel = selectLevel(this->tessellationLevel, t.levelCount(),
+                                        [&t](size_t l) { return t.levelError(l); }, context, modelview, bb);
+}
 
+BoundingBox Model::getBoundingBox(const Mat4& modelview) const {
   BoundingBox bb = shape->getBoundingBox();
   bb.transform(modelview);
+  return bb;
+}
 
-  if (viewFrustum.contains(bb)) {
-    float emi[] = { GET_ALL(emission), 1.0 };
-    float amb[] = { GET_ALL(ambient), 1.0 };
-    float dif[] = { GET_ALL(diffuse), 1.0 };
-    float spec[] = { GET_ALL(specular), 1.0 };
-    
-    glMaterialfv(GL_FRONT, GL_EMISSION, emi);
-    glMaterialfv(GL_FRONT, GL_AMBIENT, amb);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, dif);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, spec);
-    glMaterialf(GL_FRONT, GL_SHININESS, shininess);
-
-    if (texture != nullptr)
-      texture->bind();
-    else
-      Texture::unbind();
-
-    shape->draw();
-    return 0;
-  } else {
-    return 1;
-  }
+void Model::selectLevels(const DrawContext& context, const Mat4& modelview, const BoundingBox& bb) {
+  selectLOD(context, modelview, bb);
+  if (tessellator != nullptr)
+    selectTessellation(context, modelview, bb);
+}
+
+bool Model::updateTessellation() {
+  if (tessellator == nullptr)
+    return false;
+
+  //the shape drawn until then is kept while the level is tessellated
+  tessellator->collect();
+  std::shared_ptr<Shape> level = tessellator->level(tessellationLevel);
+  if (level == nullptr || level == shape)
+    return false;
+
+  this->shape = level;
+  return true;
+}
+
+void Model::draw() const
+{
+  material.apply();
+
+  if (texture != nullptr)
+    texture->bind();
+  else
+    Texture::unbind();
+
+  shape->draw(this->lod);
+}
+
+const Shape* Model::getShape() const {
+  return shape.get();
+}
+
+const Texture* Model::getTexture() const {
+  return texture.get();
+}
+
+const Material& Model::getMaterial() const {
+  return material;
+}
+
+size_t Model::getLOD() const {
+  return lod;
+}
+
+void Material::apply() const {
+  float emi[] = { GET_ALL(emission), 1.0 };
+  float amb[] = { GET_ALL(ambient), 1.0 };
+  float dif[] = { GET_ALL(diffuse), 1.0 };
+  float spec[] = { GET_ALL(specular), 1.0 };
+  
+  glMaterialfv(GL_FRONT, GL_EMISSION, emi);
+  glMaterialfv(GL_FRONT, GL_AMBIENT, amb);
+  glMaterialfv(GL_FRONT, GL_DIFFUSE, dif);
+  glMaterialfv(GL_FRONT, GL_SPECULAR, spec);
+  glMaterialf(GL_FRONT, GL_SHININESS, shininess);
+}
+
+bool Material::operator <(const Material& material) const {
+  return std::tie(emission, ambient, diffuse, specular, shininess)
+       < std::tie(material.emission, material.ambient, material.diffuse, material.specular, material.shininess);
+}
+
+bool Material::operator ==(const Material& material) const {
+  return std::tie(emission, ambient, diffuse, specular, shininess)
+      == std::tie(material.emission, material.ambient, material.diffuse, material.specular, material.shininess);
 }
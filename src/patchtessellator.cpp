@@ -0,0 +1,148 @@
+/**
+ * @file patchtessellator.cpp
+ *
+ * @brief File implementing the tessellation of Bezier patches at the levels
+ * the models ask for, on a worker thread
+ */
+
+#include "patchtessellator.hpp"
+#include "shapegenerator.hpp"
+#include "exceptions/invalid_xml_file.hpp"
+#include <fstream>
+
+std::map<std::string, std::shared_ptr<PatchTessellator>> PatchTessellator::cache;
+bool PatchTessellator::synchronous = false;
+
+std::shared_ptr<PatchTessellator> PatchTessellator::fetchTessellator(std::string filePath) {
+  if (cache.find(filePath) != cache.end())
+    return cache[filePath];
+
+  std::shared_ptr<PatchTessellator> t = std::make_shared<PatchTessellator>(filePath);
+  cache[filePath] = t;
+  return t;
+}
+
+void PatchTessellator::clearCache() {
+  cache.clear();
+}
+
+void PatchTessellator::setSynchronous(bool synchronous) {
+  PatchTessellator::synchronous = synchronous;
+}
+
+PatchTessellator::PatchTessellator(std::string filePath) {
+  if (!std::ifstream(filePath))
+    throw InvalidXMLStructure("XMLParser@model: The file '" + filePath + "' does not exist.");
+  readBezierPatchFile(filePath, controlPoints, patches);
+
+  std::vector<Point> used;
+  for (const int* c : patches)
+    for (int l = 0; l < 16; l++)
+      used.push_back(controlPoints.at(c[l]));
+  hull = BoundingBox(used);
+
+  for (int segments = PATCH_MAX_SEGMENTS; segments >= 1; segments /= 2)
+    errors.push_back(bezierTessellationError(controlPoints, patches, segments + 1));
+
+  levels.resize(errors.size());
+  requested.resize(errors.size(), false);
+
+  //the coarsest level is uploaded along with the ones the worker finishes
+  coarsest = tessellateBezierPatches(controlPoints, patches, levelDivisions(levelCount() - 1));
+  requested.back() = true;
+  finished.push_back({ levelCount() - 1, coarsest });
+  hasFinished = true;
+
+  worker = std::thread(&PatchTessellator::workerLoop, this);
+}
+
+PatchTessellator::~PatchTessellator() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+size_t PatchTessellator::levelCount() const {
+  return errors.size();
+}
+
+int PatchTessellator::levelDivisions(size_t level) const {
+  return (PATCH_MAX_SEGMENTS >> level) + 1;
+}
+
+float PatchTessellator::levelError(size_t level) const {
+  return errors[level];
+}
+
+std::shared_ptr<Shape> PatchTessellator::level(size_t level) {
+  if (levels[level] == nullptr && synchronous) {
+    collect();
+    if (levels[level] == nullptr) {
+      requested[level] = true;
+      levels[level] = tessellateBezierPatches(controlPoints, patches, levelDivisions(level));
+      levels[level]->initialize();
+    }
+  }
+
+  if (levels[level] == nullptr && !requested[level]) {
+    requested[level] = true;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending.push_back(level);
+    }
+    wake.notify_one();
+  }
+
+  return levels[level];
+}
+
+std::shared_ptr<Shape> PatchTessellator::coarsestLevel() const {
+  return coarsest;
+}
+
+BoundingBox PatchTessellator::getBoundingBox() const {
+  return hull;
+}
+
+void PatchTessellator::collect() {
+  if (!hasFinished.load(std::memory_order_acquire))
+    return;
+
+  std::vector<std::pair<size_t, std::shared_ptr<Shape>>> shapes;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shapes.swap(finished);
+    hasFinished = false;
+  }
+
+  for (auto& [level, shape] : shapes) {
+    shape->initialize();
+    levels[level] = std::move(shape);
+  }
+}
+
+void PatchTessellator::workerLoop() {
+  while (true) {
+    size_t level;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+      if (stopping)
+        return;
+
+      level = pending.front();
+      pending.pop_front();
+    }
+
+    //the shape is only built here, since GL can only be called from the
+    //thread of its context
+    std::unique_ptr<Shape> shape = tessellateBezierPatches(controlPoints, patches, levelDivisions(level));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished.push_back({ level, std::move(shape) });
+    hasFinished.store(true, std::memory_order_release);
+  }
+}
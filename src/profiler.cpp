@@ -0,0 +1,190 @@
+/**
+ * @file profiler.cpp
+ *
+ * @brief File implementing the timing of the stages of the frames
+ */
+
+#include "glut.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+/**
+ * @brief The name of each stage, in the CSV and JSON files
+*/
+static const char* stageNames[PROFILE_STAGES] = { "camera", "lighting", "update", "submit" };
+
+const char* profileStageName(ProfileStage stage) {
+  return stageNames[(size_t) stage];
+}
+
+/**
+ * @brief Returns the milliseconds since a time of the steady clock
+*/
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Profiler::Profiler() :
+  frames(PROFILER_FRAMES)
+{}
+
+Profiler::~Profiler() {
+  if (!queries.empty())
+    glDeleteQueries(queries.size(), queries.data());
+}
+
+Profiler::Scope::Scope(Profiler& profiler, ProfileStage stage) :
+  profiler(profiler),
+  stage(stage),
+  start(std::chrono::steady_clock::now())
+{
+  if (!profiler.queries.empty()) {
+    size_t query = profiler.frameNumber % PROFILER_LATENCY * PROFILE_STAGES + (size_t) stage;
+    glBeginQuery(GL_TIME_ELAPSED, profiler.queries[query]);
+    profiler.issued[query] = true;
+  }
+}
+
+Profiler::Scope::~Scope() {
+  if (!profiler.queries.empty())
+    glEndQuery(GL_TIME_ELAPSED);
+
+  profiler.frames[profiler.frameNumber % PROFILER_FRAMES].cpu[(size_t) stage] += millisecondsSince(start);
+}
+
+void Profiler::initialize() {
+  if (!queries.empty() || !(GLEW_VERSION_3_3 || GLEW_ARB_timer_query))
+    return;
+
+  queries.resize(PROFILER_LATENCY * PROFILE_STAGES);
+  glGenQueries(queries.size(), queries.data());
+  issued.assign(queries.size(), false);
+  queryFrames.assign(PROFILER_LATENCY, -1);
+}
+
+void Profiler::beginFrame(float time) {
+  frameNumber++;
+
+  //the queries of the frame PROFILER_LATENCY frames ago are reused
+  if (!queries.empty()) {
+    size_t slot = frameNumber % PROFILER_LATENCY;
+    readQueries(slot);
+    std::fill(issued.begin() + slot * PROFILE_STAGES, issued.begin() + (slot + 1) * PROFILE_STAGES, false);
+    queryFrames[slot] = frameNumber;
+  }
+
+  FrameProfile& profile = frames[frameNumber % PROFILER_FRAMES];
+  profile = FrameProfile();
+  profile.frame = frameNumber;
+  profile.time = time;
+  std::fill(profile.gpu, profile.gpu + PROFILE_STAGES, -1.0);
+
+  frameStart = std::chrono::steady_clock::now();
+}
+
+void Profiler::endFrame(const DrawStats& stats) {
+  FrameProfile& profile = frames[frameNumber % PROFILER_FRAMES];
+  profile.frameTime = millisecondsSince(frameStart);
+  profile.stats = stats;
+}
+
+void Profiler::readQueries(size_t slot) {
+  long frame = queryFrames[slot];
+  if (frame < 0)
+    return;
+
+  //the frame may have left the ring buffer if it's shorter than the latency
+  FrameProfile& profile = frames[frame % PROFILER_FRAMES];
+  for (size_t s = 0; s < PROFILE_STAGES; s++) {
+    size_t query = slot * PROFILE_STAGES + s;
+    if (!issued[query])
+      continue;
+
+    GLuint64 nanoseconds;
+    glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds);
+    if (profile.frame == frame)
+      profile.gpu[s] = nanoseconds / 1e6;
+  }
+
+  queryFrames[slot] = -1;
+}
+
+void Profiler::flush() {
+  for (size_t slot = 0; slot < queryFrames.size(); slot++)
+    readQueries(slot);
+}
+
+size_t Profiler::frameCount() const {
+  return std::min<long>(frameNumber + 1, PROFILER_FRAMES);
+}
+
+const FrameProfile& Profiler::frame(size_t i) const {
+  return frames[(frameNumber + 1 - frameCount() + i) % PROFILER_FRAMES];
+}
+
+void Profiler::writeCSV(std::ostream& out) const {
+  out << "frame,time,frameMs";
+  for (const char* name : stageNames)
+    out << ",cpu_" << name << "Ms";
+  for (const char* name : stageNames)
+    out << ",gpu_" << name << "Ms";
+  out << ",drawCalls,triangles,culledModels,culledGroups,shapeChanges,textureChanges,materialChanges\n";
+
+  for (size_t i = 0; i < frameCount(); i++) {
+    const FrameProfile& f = frame(i);
+    out << f.frame << ',' << f.time << ',' << f.frameTime;
+    for (double cpu : f.cpu)
+      out << ',' << cpu;
+    for (double gpu : f.gpu) {
+      out << ',';
+      if (gpu >= 0)
+        out << gpu;
+    }
+    out << ',' << f.stats.drawCalls << ',' << f.stats.triangles
+        << ',' << f.stats.culledModels << ',' << f.stats.culledGroups
+        << ',' << f.stats.shapeChanges << ',' << f.stats.textureChanges << ',' << f.stats.materialChanges << '\n';
+  }
+  out.flush();
+}
+
+void Profiler::writeJSON(std::ostream& out) const {
+  out << "{\n  \"frames\": [";
+  for (size_t i = 0; i < frameCount(); i++) {
+    const FrameProfile& f = frame(i);
+    out << (i == 0 ? "\n" : ",\n")
+        << "    {\"frame\": " << f.frame << ", \"time\": " << f.time << ", \"frameMs\": " << f.frameTime;
+
+    out << ", \"cpuMs\": {";
+    for (size_t s = 0; s < PROFILE_STAGES; s++)
+      out << (s == 0 ? "" : ", ") << '"' << stageNames[s] << "\": " << f.cpu[s];
+
+    out << "}, \"gpuMs\": {";
+    for (size_t s = 0; s < PROFILE_STAGES; s++) {
+      out << (s == 0 ? "" : ", ") << '"' << stageNames[s] << "\": ";
+      if (f.gpu[s] >= 0)
+        out << f.gpu[s];
+      else
+        out << "null";
+    }
+
+    out << "}, \"drawCalls\": " << f.stats.drawCalls << ", \"triangles\": " << f.stats.triangles
+        << ", \"culledModels\": " << f.stats.culledModels << ", \"culledGroups\": " << f.stats.culledGroups
+        << ", \"shapeChanges\": " << f.stats.shapeChanges << ", \"textureChanges\": " << f.stats.textureChanges
+        << ", \"materialChanges\": " << f.stats.materialChanges << "}";
+  }
+  out << "\n  ]\n}" << std::endl;
+}
+
+void Profiler::write(const std::string& path) const {
+  std::ofstream file(path);
+  if (!file)
+    throw std::runtime_error("Error writing the profile to '" + path + "'");
+
+  bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+  if (csv)
+    writeCSV(file);
+  else
+    writeJSON(file);
+}
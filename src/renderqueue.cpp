@@ -0,0 +1,170 @@
+/**
+ * @file renderqueue.cpp
+ *
+ * @brief File implementing the state sorted submission of the models
+ */
+
+#include "glut.hpp"
+#include "renderqueue.hpp"
+#include "matrixstack.hpp"
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+/**
+ * @brief The node loaded into GL before any is
+*/
+#define NO_NODE ((size_t)-1)
+
+RenderQueue::RenderQueue() {}
+
+RenderQueue::RenderQueue(const std::vector<Model*>& models) {
+  std::map<std::tuple<const Shape*, const Texture*, Material>, size_t> keys;
+  for (const Model* m : models)
+    keys.emplace(std::make_tuple(m->getShape(), m->getTexture(), m->getMaterial()), 0);
+
+  //the buckets are numbered in the order of the keys, each followed by its
+  //levels of detail
+  for (auto& [key, first] : keys) {
+    first = bucketCount;
+    bucketCount += std::get<0>(key)->lodCount();
+
+    const Texture* texture = std::get<1>(key);
+    translucent.resize(bucketCount, texture != nullptr && texture->isTranslucent());
+  }
+
+  for (const Model* m : models)
+    firstBuckets.push_back(keys[std::make_tuple(m->getShape(), m->getTexture(), m->getMaterial())]);
+}
+
+size_t RenderQueue::bucket(size_t model, size_t lod) const {
+  return firstBuckets[model] + lod;
+}
+
+void RenderQueue::submit(const std::vector<DrawItem>& items, const std::vector<Mat4>& matrices,
+                         InstanceRenderer& renderer, DrawStats& stats) {
+  //counting sort of the opaque items by bucket, while the translucent ones
+  //are sorted by the depth of their centers in eye coordinates
+  bucketStarts.assign(bucketCount + 1, 0);
+  blended.clear();
+  for (size_t i = 0; i < items.size(); i++) {
+    const DrawItem& item = items[i];
+    if (translucent[item.bucket]) {
+      Point center = item.model->getBound().center;
+      ColVec4 eye = matrices[item.node] * ColVec4{ GET_ALL(center), 1 };
+      blended.push_back({ eye.values[2], i });
+    } else {
+      bucketStarts[item.bucket + 1]++;
+    }
+  }
+
+  for (size_t b = 0; b < bucketCount; b++)
+    bucketStarts[b + 1] += bucketStarts[b];
+  size_t opaque = bucketStarts[bucketCount];
+
+  order.resize(items.size());
+  for (size_t i = 0; i < items.size(); i++)
+    if (!translucent[items[i].bucket])
+      order[bucketStarts[items[i].bucket]++] = i;
+
+  //the camera looks down -z, so the furthest have the lowest depth
+  std::sort(blended.begin(), blended.end());
+  for (size_t j = 0; j < blended.size(); j++)
+    order[opaque + j] = blended[j].second;
+
+  instances.resize(order.size());
+  nodes.resize(order.size());
+  for (size_t k = 0; k < order.size(); k++) {
+    nodes[k] = items[order[k]].node;
+    instances[k] = matrices[nodes[k]];
+  }
+
+  shape = nullptr;
+  texture = nullptr;
+  material = nullptr;
+  textureBound = false;
+  loadedNode = NO_NODE;
+
+  if (renderer.available())
+    renderer.begin(instances);
+
+  //filling moved the start of each bucket to the start of the next
+  size_t first = 0;
+  for (size_t b = 0; b < bucketCount; b++) {
+    if (bucketStarts[b] > first) {
+      const Model& model = *items[order[first]].model;
+      bind(model, stats);
+      draw(model, first, bucketStarts[b] - first, renderer, stats);
+    }
+    first = bucketStarts[b];
+  }
+
+  if (!blended.empty()) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+
+    for (size_t k = opaque; k < order.size(); k++) {
+      const Model& model = *items[order[k]].model;
+      bind(model, stats);
+      draw(model, k, 1, renderer, stats);
+    }
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+  }
+
+  if (shape != nullptr)
+    shape->unbind();
+
+  if (renderer.available())
+    renderer.end();
+}
+
+void RenderQueue::bind(const Model& model, DrawStats& stats) {
+  if (model.getShape() != shape) {
+    if (shape != nullptr)
+      shape->unbind();
+
+    shape = model.getShape();
+    shape->bind();
+    stats.shapeChanges++;
+  }
+
+  if (!textureBound || model.getTexture() != texture) {
+    texture = model.getTexture();
+    if (texture != nullptr)
+      texture->bind();
+    else
+      Texture::unbind();
+
+    textureBound = true;
+    stats.textureChanges++;
+  }
+
+  if (material == nullptr || !(*material == model.getMaterial())) {
+    material = &model.getMaterial();
+    material->apply();
+    stats.materialChanges++;
+  }
+}
+
+void RenderQueue::draw(const Model& model, size_t instance, size_t count, InstanceRenderer& renderer, DrawStats& stats) {
+  stats.triangles += shape->lodTriangleCount(std::min(model.getLOD(), shape->lodCount() - 1)) * count;
+
+  if (renderer.available()) {
+    renderer.draw(model, instance, count);
+    stats.drawCalls++;
+    return;
+  }
+
+  for (size_t k = instance; k < instance + count; k++) {
+    if (nodes[k] != loadedNode) {
+      loadMatrix(instances[k]);
+      loadedNode = nodes[k];
+    }
+
+    shape->drawBound(model.getLOD());
+    stats.drawCalls++;
+  }
+}
@@ -0,0 +1,114 @@
+"""
+Checks that the tessellation of Bezier patches keeps the normal of each
+patch at its corners, within the crease angle: the normals of the patches
+meeting at a corner are only averaged where they agree, so creases (such as
+where the teapot's handle meets its body) stay sharp.
+
+The normal of a patch at a corner is the cross product of the tangents of
+its two borders there, taken from the control points next to it. Corners
+where a border collapses to a point have none, and aren't checked.
+
+The shape must be in the text .3d format, as written by the generator.
+
+Example, the teapot at 16 divisions:
+    ./generator patch models/teapot.patch 16 teapot.3d
+    python3 src/scripts/check_patch_normals.py models/teapot.patch teapot.3d
+"""
+
+import argparse
+import math
+import sys
+
+from collections import defaultdict
+
+# the decimals the positions are matched to
+POSITION_DECIMALS = 4
+
+
+def read_patches(path: str) -> tuple[list[list[int]], list[tuple[float, float, float]]]:
+    """Reads the indices of the control points of each patch, and the
+    control points."""
+    with open(path) as file:
+        lines = [line.strip() for line in file if line.strip()]
+
+    count = int(lines[0])
+    patches = [[int(i) for i in line.replace(",", " ").split()] for line in lines[1:count + 1]]
+    points = [tuple(float(c) for c in line.replace(",", " ").split())
+              for line in lines[count + 2:count + 2 + int(lines[count + 1])]]
+    return patches, points
+
+
+def read_shape(path: str) -> tuple[list[tuple[float, ...]], list[tuple[float, ...]]]:
+    """Reads the positions and normals of the vertices of a text .3d file."""
+    with open(path) as file:
+        count = int(file.readline())
+        positions = [tuple(float(c) for c in file.readline().split()) for _ in range(count)]
+        normals = [tuple(float(c) for c in file.readline().split()) for _ in range(count)]
+    return positions, normals
+
+
+def sub(a, b):
+    return tuple(x - y for x, y in zip(a, b))
+
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+
+def normalize(v):
+    length = math.sqrt(sum(c * c for c in v))
+    return tuple(c / length for c in v) if length > 1e-9 else None
+
+
+def corner_normals(patch: list[int], points) -> list[tuple[int, tuple[float, float, float]]]:
+    """Returns the control point of each corner of a patch with a normal, and
+    the normal, facing the way the tessellation does (dv x du)."""
+    p = [points[i] for i in patch]
+    result = []
+    for r, rn in ((0, 1), (3, 2)):
+        for c, cn in ((0, 1), (3, 2)):
+            # the tangents point into the patch, so the ones at the far
+            # borders are flipped
+            du = sub(p[4 * rn + c], p[4 * r + c]) if r == 0 else sub(p[4 * r + c], p[4 * rn + c])
+            dv = sub(p[4 * r + cn], p[4 * r + c]) if c == 0 else sub(p[4 * r + c], p[4 * r + cn])
+            normal = normalize(cross(dv, du))
+            if normal is not None:
+                result.append((patch[4 * r + c], normal))
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Checks the normals of tessellated Bezier patches at their corners.")
+    parser.add_argument("patch", help="the patch file")
+    parser.add_argument("shape", help="the tessellation, in the text .3d format")
+    parser.add_argument("--angle", type=float, default=30,
+                        help="the crease angle the generator was built with, in degrees")
+    args = parser.parse_args()
+
+    patches, points = read_patches(args.patch)
+    positions, normals = read_shape(args.shape)
+
+    at = defaultdict(list)
+    for position, normal in zip(positions, normals):
+        at[tuple(round(c, POSITION_DECIMALS) for c in position)].append(normal)
+
+    limit = math.cos(math.radians(args.angle)) - 1e-4
+    failures = 0
+    creases = set()
+    for index, patch in enumerate(patches):
+        for control, normal in corner_normals(patch, points):
+            found = at.get(tuple(round(c, POSITION_DECIMALS) for c in points[control]), [])
+            dots = [sum(a * b for a, b in zip(normal, n)) for n in found]
+            if not dots or max(dots) < limit:
+                failures += 1
+                best = math.degrees(math.acos(max(-1, min(1, max(dots))))) if dots else float("nan")
+                print(f"patch {index}, control point {control}: its normal is {best:.1f} degrees from the closest vertex's")
+            if len(set(found)) > 1:
+                creases.add(control)
+
+    print(f"{len(creases)} corners with several normals, {failures} patch normals lost")
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,249 @@
+"""
+Generates synthetic worlds, with as many groups, models, animations, shapes
+and textures as asked for, to measure how loading, traversal and culling
+scale with the size of the scene.
+
+The same arguments (and seed) always generate the same world. The shapes
+(spheres with different numbers of slices, in the text .3d format) and the
+textures (checkerboards, in the PPM format) are written to the assets
+directory, and referenced by their paths as given, so the engine must run
+from the directory the generator ran from.
+
+Example, a world of 10000 groups, 4 levels deep, 200 of them orbiting:
+    python3 src/scripts/scene_generator.py --groups 10000 --depth 4 --fanout 10 \
+        --rotations 100 --curves 100 --output xml/scale_10k.xml
+"""
+
+import argparse
+import math
+import os
+import random
+import sys
+
+from collections import namedtuple
+
+Node = namedtuple("Node", "parent depth children")
+
+# the diffuse colors of the models, cycled through by --materials
+PALETTE = [
+    (200, 60, 60), (60, 200, 60), (60, 60, 200), (200, 200, 60),
+    (200, 60, 200), (60, 200, 200), (220, 220, 220), (120, 80, 40),
+]
+
+# the points of each Catmull-Rom curve
+CURVE_POINTS = 8
+
+# the side of each texture, in pixels, and of each of its squares
+TEXTURE_SIZE = 64
+TEXTURE_SQUARE = 8
+
+
+def build_tree(groups: int, depth: int, fanout: int) -> list[Node]:
+    """Builds the tree breadth first, giving each group up to fanout
+    children, and none to those at the maximum depth."""
+    nodes = [Node(None, 0, [])]
+    parent = 0
+    while len(nodes) < groups:
+        if parent == len(nodes):
+            capacity = sum(fanout ** d for d in range(depth + 1))
+            sys.exit(f"error: a depth of {depth} and a fanout of {fanout} only fit {capacity} groups")
+
+        if nodes[parent].depth < depth:
+            for _ in range(min(fanout, groups - len(nodes))):
+                nodes[parent].children.append(len(nodes))
+                nodes.append(Node(parent, nodes[parent].depth + 1, []))
+        parent += 1
+
+    return nodes
+
+
+def write_sphere(path: str, slices: int, stacks: int):
+    """Writes a unit sphere in the text .3d format: the points, normals and
+    texture coordinates of the vertices, then the triangles."""
+    points = []
+    uvs = []
+    for j in range(stacks + 1):
+        beta = math.pi * j / stacks - math.pi / 2
+        for i in range(slices + 1):
+            alpha = 2 * math.pi * i / slices
+            points.append((math.cos(beta) * math.sin(alpha), math.sin(beta), math.cos(beta) * math.cos(alpha)))
+            uvs.append((i / slices, j / stacks))
+
+    triangles = []
+    for j in range(stacks):
+        for i in range(slices):
+            a = j * (slices + 1) + i
+            c = a + slices + 1
+            triangles.append((a, a + 1, c + 1))
+            triangles.append((a, c + 1, c))
+
+    with open(path, "w") as file:
+        file.write(f"{len(points)}\n")
+        file.writelines(f"{x:.6f} {y:.6f} {z:.6f}\n" for x, y, z in points)
+        file.writelines(f"{x:.6f} {y:.6f} {z:.6f}\n" for x, y, z in points)
+        file.writelines(f"{u:.6f} {v:.6f}\n" for u, v in uvs)
+        file.write(f"{len(triangles)}\n")
+        file.writelines(f"{a} {b} {c}\n" for a, b, c in triangles)
+
+
+def write_texture(path: str, color: tuple[int, int, int]):
+    """Writes a checkerboard of a color and white, in the binary PPM format."""
+    pixels = bytearray()
+    for y in range(TEXTURE_SIZE):
+        for x in range(TEXTURE_SIZE):
+            white = (x // TEXTURE_SQUARE + y // TEXTURE_SQUARE) % 2 == 0
+            pixels += bytes((255, 255, 255) if white else color)
+
+    with open(path, "wb") as file:
+        file.write(f"P6\n{TEXTURE_SIZE} {TEXTURE_SIZE}\n255\n".encode())
+        file.write(pixels)
+
+
+def write_assets(directory: str, shapes: int, textures: int, rng: random.Random) -> tuple[list[str], list[str]]:
+    """Writes the distinct shapes and textures, returning their paths."""
+    os.makedirs(directory, exist_ok=True)
+
+    shape_paths = []
+    for s in range(shapes):
+        path = os.path.join(directory, f"sphere_{s}.3d")
+        write_sphere(path, 8 + 2 * s, 6 + s)
+        shape_paths.append(path)
+
+    texture_paths = []
+    for t in range(textures):
+        path = os.path.join(directory, f"checker_{t}.ppm")
+        write_texture(path, (rng.randrange(256), rng.randrange(256), rng.randrange(256)))
+        texture_paths.append(path)
+
+    return shape_paths, texture_paths
+
+
+def curve_points(radius: float, rng: random.Random) -> list[tuple[float, float, float]]:
+    """Returns the points of a circle around the origin, tilted at random."""
+    tilt = rng.uniform(-0.3, 0.3)
+    result = []
+    for k in range(CURVE_POINTS):
+        theta = 2 * math.pi * k / CURVE_POINTS
+        x = radius * math.cos(theta)
+        z = radius * math.sin(theta)
+        result.append((x, z * tilt, z))
+    return result
+
+
+def write_world(out, nodes: list[Node], args, shape_paths: list[str], texture_paths: list[str], rng: random.Random):
+    """Writes the world, with each group placed at random around its parent.
+
+    Each group is moved up to spread units away from its parent and scaled by
+    1 / spread, so a group and its subgroups take about as much space as a
+    model, wherever it is in the tree."""
+    spread = 2 * args.fanout ** (1 / 3) + 2
+    scale = 1 / spread
+
+    # the groups animated, chosen among all but the root
+    animated = rng.sample(range(1, len(nodes)), min(args.rotations + args.curves, len(nodes) - 1))
+    rotating = set(animated[:args.rotations])
+    orbiting = set(animated[args.rotations:])
+
+    distance = args.distance * spread
+    out.write("<world>\n")
+    out.write(f'    <window width="{args.width}" height="{args.height}" axis="false"/>\n')
+    out.write('    <camera type="fps">\n')
+    out.write(f'        <position x="{distance:.4f}" y="{distance / 2:.4f}" z="{distance:.4f}" />\n')
+    out.write('        <lookAt x="0" y="0" z="0" />\n')
+    out.write('        <up x="0" y="1" z="0" />\n')
+    out.write(f'        <projection fov="60" near="0.1" far="{20 * max(distance, spread):.4f}" />\n')
+    out.write("    </camera>\n")
+    out.write("    <lights>\n")
+    out.write('        <ambient R="50" G="50" B="50"/>\n')
+    out.write('        <light type="directional" dirx="1" diry="1" dirz="1" />\n')
+    out.write('        <light type="point" posx="0" posy="0" posz="0" />\n')
+    out.write("    </lights>\n")
+
+    # depth first, without recursion, since the tree can be a long chain
+    stack = [(0, False)]
+    while stack:
+        node, closing = stack.pop()
+        indent = "    " * (nodes[node].depth + 1)
+        if closing:
+            out.write(f"{indent}</group>\n")
+            continue
+
+        out.write(f"{indent}<group>\n")
+        inner = indent + "    "
+
+        out.write(f"{inner}<models>\n")
+        for _ in range(args.models):
+            shape = rng.choice(shape_paths)
+            r, g, b = PALETTE[rng.randrange(args.materials)]
+            out.write(f'{inner}    <model file="{shape}">\n')
+            if texture_paths:
+                out.write(f'{inner}        <texture file="{rng.choice(texture_paths)}" />\n')
+            out.write(f'{inner}        <color>\n')
+            out.write(f'{inner}            <diffuse R="{r}" G="{g}" B="{b}" />\n')
+            out.write(f'{inner}        </color>\n')
+            out.write(f"{inner}    </model>\n")
+        out.write(f"{inner}</models>\n")
+
+        if node != 0:
+            out.write(f"{inner}<transform>\n")
+            if node in rotating:
+                out.write(f'{inner}    <rotate time="{rng.uniform(5, 30):.4f}" x="0" y="1" z="0" />\n')
+
+            if node in orbiting:
+                out.write(f'{inner}    <translate time="{rng.uniform(5, 30):.4f}" align="false">\n')
+                for x, y, z in curve_points(rng.uniform(0.5, 1) * spread, rng):
+                    out.write(f'{inner}        <point x="{x:.4f}" y="{y:.4f}" z="{z:.4f}" />\n')
+                out.write(f"{inner}    </translate>\n")
+            else:
+                x, y, z = (rng.uniform(-spread, spread) for _ in range(3))
+                out.write(f'{inner}    <translate x="{x:.4f}" y="{y:.4f}" z="{z:.4f}" />\n')
+
+            out.write(f'{inner}    <scale s="{scale:.6f}" />\n')
+            out.write(f"{inner}</transform>\n")
+
+        stack.append((node, True))
+        stack.extend((child, False) for child in reversed(nodes[node].children))
+
+    out.write("</world>\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generates a synthetic world XML for scaling tests.")
+    parser.add_argument("--groups", type=int, default=1000, help="the number of groups, the root included")
+    parser.add_argument("--depth", type=int, default=3, help="the maximum nesting depth of the groups")
+    parser.add_argument("--fanout", type=int, default=10, help="the maximum number of subgroups of a group")
+    parser.add_argument("--models", type=int, default=1, help="the number of models of each group")
+    parser.add_argument("--rotations", type=int, default=0, help="the number of groups rotating with time")
+    parser.add_argument("--curves", type=int, default=0, help="the number of groups moving along Catmull-Rom curves")
+    parser.add_argument("--shapes", type=int, default=4, help="the number of distinct shapes")
+    parser.add_argument("--textures", type=int, default=0, help="the number of distinct textures (0 for none)")
+    parser.add_argument("--materials", type=int, default=4, choices=range(1, len(PALETTE) + 1),
+                        metavar=f"1..{len(PALETTE)}", help="the number of distinct colors")
+    parser.add_argument("--width", type=int, default=800, help="the width of the window")
+    parser.add_argument("--height", type=int, default=800, help="the height of the window")
+    parser.add_argument("--distance", type=float, default=3,
+                        help="the distance of the camera from the root, in the units the groups are spread in "
+                             "(below 1 the camera is inside the scene, and culls part of it)")
+    parser.add_argument("--seed", type=int, default=42, help="the seed of the random placement")
+    parser.add_argument("--assets", default="scene_assets", help="the directory the shapes and textures are written to")
+    parser.add_argument("--output", help="the XML file to write (the standard output by default)")
+    args = parser.parse_args()
+
+    if args.groups < 1 or args.depth < 0 or args.fanout < 1 or args.models < 0 or args.shapes < 1:
+        sys.exit("error: there must be at least one group, shape and subgroup per group, and no negative counts")
+    if args.rotations + args.curves > args.groups - 1:
+        sys.exit("error: more animated groups than groups (the root isn't animated)")
+
+    rng = random.Random(args.seed)
+    nodes = build_tree(args.groups, args.depth, args.fanout)
+    shape_paths, texture_paths = write_assets(args.assets, args.shapes, args.textures, rng)
+
+    if args.output is None:
+        write_world(sys.stdout, nodes, args, shape_paths, texture_paths, rng)
+    else:
+        with open(args.output, "w") as out:
+            write_world(out, nodes, args, shape_paths, texture_paths, rng)
+
+
+if __name__ == "__main__":
+    main()
@@ -6,10 +6,20 @@
 
 #include "glut.hpp"
 #include "shape.hpp"
+#include "welder.hpp"
+#include "meshoptimizer.hpp"
+#include "simplifier.hpp"
+#include "shapegenerator.hpp"
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include "exceptions/invalid_xml_file.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
 #include <map>
 #include <tuple>
 
@@ -25,6 +35,69 @@ std::shared_ptr<Shape> Shape::fetchShape(std::string filePath) {
   return s;
 }
 
+/**
+ * @brief Returns the 64 bit FNV-1a hash of some bytes, continuing from a
+ * previous hash
+*/
+static uint64_t fnv1a(const char* data, size_t size, uint64_t hash = 0xcbf29ce484222325) {
+  for (size_t i = 0; i < size; i++) {
+    hash ^= (unsigned char) data[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+std::shared_ptr<Shape> Shape::fetchPatchShape(std::string filePath, int divisions) {
+  std::string key = filePath + "?divisions=" + std::to_string(divisions);
+  if (cache.find(key) != cache.end())
+    return cache[key];
+
+  std::ifstream file(filePath, std::ios::binary);
+  if (!file)
+    throw InvalidXMLStructure("XMLParser@model: The file '" + filePath + "' does not exist.");
+  std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  uint64_t hash = fnv1a(contents.data(), contents.size());
+  int salt[2] = { divisions, PATCH_CACHE_VERSION };
+  hash = fnv1a((const char*) salt, sizeof(salt), hash);
+
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.3d", (unsigned long long) hash);
+  std::filesystem::path cachePath = std::filesystem::path(PATCH_CACHE_DIRECTORY) / name;
+
+  std::shared_ptr<Shape> s;
+  std::error_code error;
+  if (std::filesystem::exists(cachePath, error)) {
+    try {
+      s = std::shared_ptr<Shape>(new Shape(cachePath.string()));
+    } catch (const InvalidXMLStructure& e) {
+      std::cerr << e.what() << ", tessellating '" << filePath << "' again" << std::endl;
+    }
+  }
+
+  if (s == nullptr) {
+    s = generateBezierPatches(filePath, divisions);
+
+    //written aside and renamed, so an interrupted write is never loaded
+    std::filesystem::path temporary = cachePath;
+    temporary += ".tmp";
+    std::filesystem::create_directories(cachePath.parent_path(), error);
+    bool cached = s->writeBinaryFile(temporary.string());
+    if (cached) {
+      std::filesystem::rename(temporary, cachePath, error);
+      cached = !error;
+    }
+
+    if (!cached) {
+      std::filesystem::remove(temporary, error);
+      std::cerr << "Couldn't cache the tessellation of '" << filePath << "' in " << cachePath << std::endl;
+    }
+  }
+
+  cache[key] = s;
+  return s;
+}
+
 void Shape::clearCache() {
   cache.clear();
 }
@@ -35,36 +108,31 @@ void Shape::initShapes() {
 }
 
 
-Shape::Shape() : vbo_points(0), vbo_normals(0), vbo_textures(0) {}
+Shape::Shape() : vbo_vertices(0), vbo_indices(0), indexType(GL_UNSIGNED_INT) {}
 
-Shape::Shape(const std::vector<Triangle>& triangles) : vbo_points(0), vbo_normals(0), vbo_textures(0) {
-  //points found in the vector of triangles and the position they will be stored in the points vector
-  std::map<std::pair<Point,Vector>, int> verticesFound; 
+/**
+ * @brief Builds the vertex of a corner of a triangle
+*/
+static Vertex makeCorner(const Point& p, const Vector& n, const Point2D& t) {
+  return {
+    { p.x, p.y, p.z },
+    { n.x, n.y, n.z },
+    { std::get<0>(t), std::get<1>(t) }
+  };
+}
+
+Shape::Shape(const std::vector<Triangle>& triangles) : vbo_vertices(0), vbo_indices(0), indexType(GL_UNSIGNED_INT) {
+  std::vector<Vertex> corners;
+  corners.reserve(3 * triangles.size());
 
   for (const Triangle& triangle : triangles) {
     Vector normal = getNormal(triangle);
-    std::pair<Point,Vector> vertices[3] = {
-      { std::get<0>(triangle), normal },
-      { std::get<1>(triangle), normal },
-      { std::get<2>(triangle), normal }
-    };
-    int pos[3];
-
-    for (int i = 0; i < 3; i++) {
-      auto it = verticesFound.find(vertices[i]);
-      if (it == verticesFound.end()) { // if the point wasn't found yet
-        this->points.push_back(vertices[i].first);
-        this->normals.push_back(vertices[i].second);
-        pos[i] = verticesFound[vertices[i]] = this->points.size() - 1; //add to the map where it is stored
-      } else {
-        pos[i] = it->second;
-      }
-    }
-    //save the triangle as the positions of the points in the vector of points
-    this->trianglesByPos.push_back({pos[0], pos[1], pos[2]});
+    corners.push_back(makeCorner(std::get<0>(triangle), normal, {0, 0}));
+    corners.push_back(makeCorner(std::get<1>(triangle), normal, {0, 0}));
+    corners.push_back(makeCorner(std::get<2>(triangle), normal, {0, 0}));
   }
 
-  this->boundingBox = BoundingBox(this->points);
+  weld(corners, false);
 }
 
 Shape::Shape(std::vector<Point> points, std::vector<Vector> normals, std::vector<Point2D> textures, std::vector<TriangleByPosition> trianglesByPos) :
@@ -72,82 +140,75 @@ Shape::Shape(std::vector<Point> points, std::vector<Vector> normals, std::vector
   normals(normals),
   textures(textures),
   boundingBox(points),
-  vbo_points(0),
-  vbo_normals(0),
-  vbo_textures(0),
+  vbo_vertices(0),
+  vbo_indices(0),
+  indexType(GL_UNSIGNED_INT),
   trianglesByPos(trianglesByPos)
 {}
 
 Shape::Shape(const std::vector<Triangle>& triangles, const std::vector<Vector>& normals, const std::vector<Point2D>& textureCoordinates) :
-  vbo_points(0),
-  vbo_normals(0),
-  vbo_textures(0)
+  vbo_vertices(0),
+  vbo_indices(0),
+  indexType(GL_UNSIGNED_INT)
 {
-  std::map<std::tuple<Point,Vector,Point2D>, int> verticesFound; 
+  std::vector<Vertex> corners;
+  corners.reserve(3 * triangles.size());
 
   for (int i = 0; i < (int)triangles.size(); i++) {
-    Triangle triangle = triangles[i];
-    std::tuple<Point,Vector,Point2D> vertices[3] = {
-      { std::get<0>(triangle), normals[3 * i], textureCoordinates[3 * i] },
-      { std::get<1>(triangle), normals[3 * i + 1], textureCoordinates[3 * i + 1] },
-      { std::get<2>(triangle), normals[3 * i + 2], textureCoordinates[3 * i + 2] }
-    };
-    int pos[3];
-
-    for (int i = 0; i < 3; i++) {
-      auto it = verticesFound.find(vertices[i]);
-      if (it == verticesFound.end()) { // if the point wasn't found yet
-        this->points.push_back(std::get<0>(vertices[i]));
-        this->normals.push_back(std::get<1>(vertices[i]));
-        this->textures.push_back(std::get<2>(vertices[i]));
-        pos[i] = verticesFound[vertices[i]] = this->points.size() - 1; //add to the map where it is stored
-      } else {
-        pos[i] = it->second;
-      }
-    }
-    //save the triangle as the positions of the points in the vector of points
-    this->trianglesByPos.push_back({pos[0], pos[1], pos[2]});
+    const Triangle& triangle = triangles[i];
+    corners.push_back(makeCorner(std::get<0>(triangle), normals[3 * i], textureCoordinates[3 * i]));
+    corners.push_back(makeCorner(std::get<1>(triangle), normals[3 * i + 1], textureCoordinates[3 * i + 1]));
+    corners.push_back(makeCorner(std::get<2>(triangle), normals[3 * i + 2], textureCoordinates[3 * i + 2]));
   }
 
-  this->boundingBox = BoundingBox(this->points);
+  weld(corners, true);
 }
 
 Shape::Shape(const std::vector<Triangle>& triangles, const std::map<Point, Point2D>& textureCoordinates) :
-  vbo_points(0),
-  vbo_normals(0),
-  vbo_textures(0)
+  vbo_vertices(0),
+  vbo_indices(0),
+  indexType(GL_UNSIGNED_INT)
 {
-  std::map<std::tuple<Point,Vector,Point2D>, int> verticesFound; 
+  std::vector<Vertex> corners;
+  corners.reserve(3 * triangles.size());
 
   for (const Triangle &triangle : triangles) {
     Vector normal = getNormal(triangle);
-    std::tuple<Point,Vector,Point2D> vertices[3] = {
-      { std::get<0>(triangle), normal, textureCoordinates.at(std::get<0>(triangle)) },
-      { std::get<1>(triangle), normal, textureCoordinates.at(std::get<1>(triangle)) },
-      { std::get<2>(triangle), normal, textureCoordinates.at(std::get<2>(triangle)) }
-    };
-    int pos[3];
-
-    for (int i = 0; i < 3; i++) {
-      auto it = verticesFound.find(vertices[i]);
-      if (it == verticesFound.end()) { // if the point wasn't found yet
-        this->points.push_back(std::get<0>(vertices[i]));
-        this->normals.push_back(std::get<1>(vertices[i]));
-        this->textures.push_back(std::get<2>(vertices[i]));
-        pos[i] = verticesFound[vertices[i]] = this->points.size() - 1; //add to the map where it is stored
-      } else {
-        pos[i] = it->second;
-      }
-    }
-    //save the triangle as the positions of the points in the vector of points
-    this->trianglesByPos.push_back({pos[0], pos[1], pos[2]});
+    corners.push_back(makeCorner(std::get<0>(triangle), normal, textureCoordinates.at(std::get<0>(triangle))));
+    corners.push_back(makeCorner(std::get<1>(triangle), normal, textureCoordinates.at(std::get<1>(triangle))));
+    corners.push_back(makeCorner(std::get<2>(triangle), normal, textureCoordinates.at(std::get<2>(triangle))));
+  }
+
+  weld(corners, true);
+}
+
+void Shape::weld(const std::vector<Vertex>& corners, bool withTextures) {
+  std::vector<Vertex> vertices;
+  std::vector<int> indices;
+  weldVertices(corners, vertices, indices);
+
+  this->points.reserve(vertices.size());
+  this->normals.reserve(vertices.size());
+  if (withTextures)
+    this->textures.reserve(vertices.size());
+
+  for (const Vertex& v : vertices) {
+    this->points.push_back({ v.position[0], v.position[1], v.position[2] });
+    this->normals.push_back({ v.normal[0], v.normal[1], v.normal[2] });
+    if (withTextures)
+      this->textures.push_back({ v.texture[0], v.texture[1] });
   }
 
+  //save the triangles as the positions of the points in the vector of points
+  this->trianglesByPos.reserve(indices.size() / 3);
+  for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    this->trianglesByPos.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+
   this->boundingBox = BoundingBox(this->points);
 }
 
-Shape::Shape(std::string filePath) : vbo_points(0), vbo_normals(0), vbo_textures(0) {
-  std::ifstream file(filePath); //open the file
+Shape::Shape(std::string filePath) : vbo_vertices(0), vbo_indices(0), indexType(GL_UNSIGNED_INT) {
+  std::ifstream file(filePath, std::ios::binary); //open the file
 
   if (!file) {
 
@@ -157,6 +218,23 @@ Shape::Shape(std::string filePath) : vbo_points(0), vbo_normals(0), vbo_textures
     throw InvalidXMLStructure(exception_message.str());
   }
 
+  //the format is chosen by the magic bytes at the start of the file
+  char magic[4] = {};
+  file.read(magic, sizeof(magic));
+
+  if (file.gcount() == sizeof(magic) && memcmp(magic, SHAPE_FILE_MAGIC, sizeof(magic)) == 0) {
+    file.close();
+    mapBinaryFile(filePath);
+  } else {
+    file.clear();
+    file.seekg(0);
+    readTextFile(file);
+    file.close();//close the file
+    this->boundingBox = BoundingBox(this->points);
+  }
+}
+
+void Shape::readTextFile(std::ifstream& file) {
   int n;
   file >> n; //read number of points
 
@@ -184,8 +262,266 @@ Shape::Shape(std::string filePath) : vbo_points(0), vbo_normals(0), vbo_textures
     this->trianglesByPos.push_back({t1, t2, t3}); // add the triangle to the vector of trianglesByPos
   }
 
-  file.close();//close the file
-  this->boundingBox = BoundingBox(this->points);
+  //the levels of detail are optional
+  int lodCount;
+  if (!(file >> lodCount))
+    return;
+
+  for (int l = 0; l < lodCount; l++) {
+    LOD lod;
+    file >> n >> lod.error; // read the number of triangles and the error of the level
+    for (int i = 0; i < n; i++) {
+      int t1, t2, t3;
+      file >> t1 >> t2 >> t3;
+      lod.triangles.push_back({t1, t2, t3});
+    }
+    this->lods.push_back(std::move(lod));
+  }
+}
+
+/**
+ * @brief Checks that a section of a binary 3D file lies inside the file
+ *
+ * @param offset      the offset of the section
+ * @param size        the size of the section, in bytes
+ * @param fileSize    the size of the file, in bytes
+ * @param optional    whether the section may be absent (zero offset)
+ *
+ * @return whether the section is valid
+*/
+static bool validSection(uint64_t offset, uint64_t size, uint64_t fileSize, bool optional) {
+  if (offset == 0)
+    return optional;
+
+  return offset % 4 == 0 && offset >= sizeof(ShapeFileHeader)
+      && offset <= fileSize && size <= fileSize - offset;
+}
+
+void Shape::mapBinaryFile(std::string filePath) {
+  auto file = std::make_shared<MappedFile>(filePath);
+  auto fail = [&filePath](std::string reason) {
+    throw InvalidXMLStructure("Shape: The file '" + filePath + "' is not a valid binary 3D file ("
+                              + reason + ").");
+  };
+
+  if (file->size() < sizeof(ShapeFileHeader))
+    fail("truncated header");
+
+  ShapeFileHeader header;
+  memcpy(&header, file->data(), sizeof(header));
+
+  if (header.version < 1 || header.version > SHAPE_FILE_VERSION)
+    fail("unsupported version " + std::to_string(header.version));
+
+  if (header.version < 2 && header.lodCount != 0)
+    fail("levels of detail in a version 1 file");
+
+  uint64_t n = header.vertexCount;
+  uint64_t t = header.triangleCount;
+  if (!validSection(header.pointsOffset, n * 3 * sizeof(float), file->size(), false)
+      || !validSection(header.normalsOffset, n * 3 * sizeof(float), file->size(), true)
+      || !validSection(header.texturesOffset, n * 2 * sizeof(float), file->size(), true)
+      || !validSection(header.trianglesOffset, t * 3 * sizeof(uint32_t), file->size(), false))
+    fail("section out of bounds");
+
+  //the level of detail table is right after the header
+  uint64_t lodTableSize = (uint64_t)header.lodCount * sizeof(ShapeFileLOD);
+  if (lodTableSize > file->size() - sizeof(header))
+    fail("level of detail table out of bounds");
+
+  const ShapeFileLOD* lods = (const ShapeFileLOD*)(file->data() + sizeof(header));
+  for (uint32_t l = 0; l < header.lodCount; l++)
+    if (!validSection(lods[l].trianglesOffset, lods[l].triangleCount * 3 * sizeof(uint32_t), file->size(), false))
+      fail("section out of bounds");
+
+  auto checkIndices = [&](uint64_t offset, uint64_t count) {
+    const uint32_t* triangles = (const uint32_t*)(file->data() + offset);
+    for (uint64_t i = 0; i < 3 * count; i++)
+      if (triangles[i] >= n)
+        fail("vertex index out of bounds");
+  };
+
+  checkIndices(header.trianglesOffset, t);
+  for (uint32_t l = 0; l < header.lodCount; l++)
+    checkIndices(lods[l].trianglesOffset, lods[l].triangleCount);
+
+  const unsigned char* base = file->data();
+  this->mapped.points = (const float*)(base + header.pointsOffset);
+  this->mapped.normals = header.normalsOffset != 0 ? (const float*)(base + header.normalsOffset) : nullptr;
+  this->mapped.textures = header.texturesOffset != 0 ? (const float*)(base + header.texturesOffset) : nullptr;
+  this->mapped.triangles = (const uint32_t*)(base + header.trianglesOffset);
+  this->mapped.lods = header.lodCount != 0 ? lods : nullptr;
+  this->mapped.vertexCount = header.vertexCount;
+  this->mapped.triangleCount = header.triangleCount;
+  this->mapped.lodCount = header.lodCount;
+  this->mapped.file = file;
+
+  //the bounding box is precomputed, so the points don't need to be visited
+  Point aabbMin = { header.aabbMin[0], header.aabbMin[1], header.aabbMin[2] };
+  Point aabbMax = { header.aabbMax[0], header.aabbMax[1], header.aabbMax[2] };
+  this->boundingBox = BoundingBox((aabbMin + aabbMax) / 2, (aabbMax - aabbMin) / 2);
+}
+
+void Shape::materialize() {
+  if (this->mapped.file == nullptr)
+    return;
+
+  for (uint32_t i = 0; i < this->mapped.vertexCount; i++) {
+    const float* p = &this->mapped.points[3 * i];
+    this->points.push_back({p[0], p[1], p[2]});
+
+    if (this->mapped.normals != nullptr) {
+      const float* n = &this->mapped.normals[3 * i];
+      this->normals.push_back({n[0], n[1], n[2]});
+    }
+
+    if (this->mapped.textures != nullptr) {
+      const float* t = &this->mapped.textures[2 * i];
+      this->textures.push_back({t[0], t[1]});
+    }
+  }
+
+  for (uint32_t i = 0; i < this->mapped.triangleCount; i++) {
+    const uint32_t* t = &this->mapped.triangles[3 * i];
+    this->trianglesByPos.push_back({(int)t[0], (int)t[1], (int)t[2]});
+  }
+
+  for (uint32_t l = 0; l < this->mapped.lodCount; l++) {
+    const ShapeFileLOD& entry = this->mapped.lods[l];
+    const uint32_t* triangles = (const uint32_t*)(this->mapped.file->data() + entry.trianglesOffset);
+
+    LOD lod;
+    lod.error = entry.error;
+    for (uint32_t i = 0; i < entry.triangleCount; i++)
+      lod.triangles.push_back({(int)triangles[3 * i], (int)triangles[3 * i + 1], (int)triangles[3 * i + 2]});
+    this->lods.push_back(std::move(lod));
+  }
+
+  this->mapped = decltype(this->mapped)();
+}
+
+size_t Shape::triangleCount() const {
+  return this->mapped.file != nullptr ? this->mapped.triangleCount : this->trianglesByPos.size();
+}
+
+size_t Shape::vertexCount() const {
+  return this->mapped.file != nullptr ? this->mapped.vertexCount : this->points.size();
+}
+
+std::vector<int> Shape::indexList() const {
+  std::vector<int> indices;
+  indices.reserve(3 * triangleCount());
+
+  if (this->mapped.file != nullptr) {
+    indices.assign(this->mapped.triangles, this->mapped.triangles + 3 * this->mapped.triangleCount);
+  } else {
+    for (const TriangleByPosition& t : this->trianglesByPos)
+      indices.insert(indices.end(), { std::get<0>(t), std::get<1>(t), std::get<2>(t) });
+  }
+
+  return indices;
+}
+
+/**
+ * @brief Reorders the elements of a vector, moving each to the given index
+*/
+template <typename T> static void permute(std::vector<T>& v, const std::vector<int>& newIndex) {
+  std::vector<T> permuted(v.size());
+  for (size_t i = 0; i < v.size(); i++)
+    permuted[newIndex[i]] = v[i];
+  v.swap(permuted);
+}
+
+void Shape::optimize() {
+  materialize();
+
+  std::vector<int> indices = indexList();
+  std::vector<int> clusters = optimizeVertexCache(indices, this->points.size());
+  optimizeOverdraw(indices, this->points, clusters);
+  std::vector<int> newIndex = optimizeVertexFetch(indices, this->points.size());
+
+  permute(this->points, newIndex);
+  if (!this->normals.empty())
+    permute(this->normals, newIndex);
+  if (!this->textures.empty())
+    permute(this->textures, newIndex);
+
+  for (size_t t = 0; t < this->trianglesByPos.size(); t++)
+    this->trianglesByPos[t] = { indices[3 * t], indices[3 * t + 1], indices[3 * t + 2] };
+
+  //the coarser levels use the same (renumbered) vertices
+  for (LOD& lod : this->lods) {
+    std::vector<int> lodIndices;
+    for (const TriangleByPosition& t : lod.triangles)
+      lodIndices.insert(lodIndices.end(), { newIndex[std::get<0>(t)], newIndex[std::get<1>(t)], newIndex[std::get<2>(t)] });
+
+    optimizeVertexCache(lodIndices, this->points.size());
+    for (size_t t = 0; t < lod.triangles.size(); t++)
+      lod.triangles[t] = { lodIndices[3 * t], lodIndices[3 * t + 1], lodIndices[3 * t + 2] };
+  }
+}
+
+float Shape::acmr() const {
+  return vertexCacheACMR(indexList(), vertexCount());
+}
+
+void Shape::generateLODs(unsigned int levels, float ratio) {
+  materialize();
+  this->lods.clear();
+
+  Point min = this->points.empty() ? zero() : this->points[0], max = min;
+  for (const Point& p : this->points) {
+    min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+    max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+  }
+  float maxError = LOD_MAX_ERROR * length(max - min);
+
+  Simplifier simplifier(indexList(), this->points);
+  size_t triangles = this->trianglesByPos.size();
+
+  //each level is simplified further from the previous one
+  for (unsigned int l = 1; l < levels; l++) {
+    size_t target = (size_t)(triangles * ratio);
+    size_t left = simplifier.simplify(target, maxError);
+    if (left > (triangles + target) / 2)
+      break;
+
+    std::vector<int> indices = simplifier.indices();
+    optimizeVertexCache(indices, this->points.size());
+
+    LOD lod;
+    lod.error = simplifier.error();
+    for (size_t t = 0; t < left; t++)
+      lod.triangles.push_back({ indices[3 * t], indices[3 * t + 1], indices[3 * t + 2] });
+    this->lods.push_back(std::move(lod));
+
+    triangles = left;
+  }
+}
+
+const uint32_t* Shape::mappedTriangles(size_t lod) const {
+  if (lod == 0)
+    return this->mapped.triangles;
+
+  return (const uint32_t*)(this->mapped.file->data() + this->mapped.lods[lod - 1].trianglesOffset);
+}
+
+size_t Shape::lodCount() const {
+  return 1 + (this->mapped.file != nullptr ? this->mapped.lodCount : this->lods.size());
+}
+
+size_t Shape::lodTriangleCount(size_t lod) const {
+  if (lod == 0)
+    return triangleCount();
+
+  return this->mapped.file != nullptr ? this->mapped.lods[lod - 1].triangleCount : this->lods[lod - 1].triangles.size();
+}
+
+float Shape::lodError(size_t lod) const {
+  if (lod == 0)
+    return 0;
+
+  return this->mapped.file != nullptr ? this->mapped.lods[lod - 1].error : this->lods[lod - 1].error;
 }
 
 Shape::Shape(const Shape& shape) :
@@ -193,10 +529,13 @@ Shape::Shape(const Shape& shape) :
   normals(shape.normals),
   textures(shape.textures),
   boundingBox(shape.boundingBox),
-  vbo_points(0),
-  vbo_normals(0),
-  vbo_textures(0),
-  trianglesByPos(shape.trianglesByPos)
+  mapped(shape.mapped),
+  layout(shape.layout),
+  vbo_vertices(0),
+  vbo_indices(0),
+  indexType(GL_UNSIGNED_INT),
+  trianglesByPos(shape.trianglesByPos),
+  lods(shape.lods)
 {}
 
 Shape::Shape(Shape&& shape) :
@@ -204,22 +543,23 @@ Shape::Shape(Shape&& shape) :
   normals(std::move(shape.normals)),
   textures(std::move(shape.textures)),
   boundingBox(shape.boundingBox),
-  vbo_points(shape.vbo_points),
-  vbo_normals(shape.vbo_normals),
-  vbo_textures(shape.vbo_textures),
-  trianglesByPos(std::move(shape.trianglesByPos))
+  mapped(std::move(shape.mapped)),
+  layout(shape.layout),
+  vbo_vertices(shape.vbo_vertices),
+  vbo_indices(shape.vbo_indices),
+  indexType(shape.indexType),
+  lodFirstIndex(std::move(shape.lodFirstIndex)),
+  trianglesByPos(std::move(shape.trianglesByPos)),
+  lods(std::move(shape.lods))
 {}
 
 
 Shape::~Shape() {
-  if(this->vbo_points != 0)
-    glDeleteBuffers(1, &this->vbo_points);
+  if(this->vbo_vertices != 0)
+    glDeleteBuffers(1, &this->vbo_vertices);
 
-  if (this->vbo_normals != 0)
-    glDeleteBuffers(1, &this->vbo_normals);
-
-  if (this->vbo_textures != 0)
-    glDeleteBuffers(1, &this->vbo_textures);
+  if (this->vbo_indices != 0)
+    glDeleteBuffers(1, &this->vbo_indices);
 }
 
 
@@ -228,23 +568,21 @@ Shape& Shape::operator=(const Shape& shape) {
   this->normals = shape.normals;
   this->textures = shape.textures;
   this->boundingBox = shape.boundingBox;
+  this->mapped = shape.mapped;
+  this->layout = shape.layout;
 
-  if (this->vbo_points != 0) {
-    glDeleteBuffers(1, &this->vbo_points);
-    this->vbo_points = 0;
-  }
-
-  if (this->vbo_normals != 0) {
-    glDeleteBuffers(1, &this->vbo_normals);
-    this->vbo_normals = 0;
+  if (this->vbo_vertices != 0) {
+    glDeleteBuffers(1, &this->vbo_vertices);
+    this->vbo_vertices = 0;
   }
 
-  if (this->vbo_textures != 0) {
-    glDeleteBuffers(1, &this->vbo_textures);
-    this->vbo_textures = 0;
+  if (this->vbo_indices != 0) {
+    glDeleteBuffers(1, &this->vbo_indices);
+    this->vbo_indices = 0;
   }
 
   this->trianglesByPos = shape.trianglesByPos;
+  this->lods = shape.lods;
   return *this;
 }
 
@@ -254,78 +592,193 @@ Shape& Shape::operator=(Shape&& shape) {
   this->normals = std::move(shape.normals);
   this->textures = std::move(shape.textures);
   this->boundingBox = shape.boundingBox;
+  this->mapped = std::move(shape.mapped);
+  this->layout = shape.layout;
 
-  if (this->vbo_points != 0)
-    glDeleteBuffers(1, &this->vbo_points);
+  if (this->vbo_vertices != 0)
+    glDeleteBuffers(1, &this->vbo_vertices);
 
-  if (this->vbo_normals != 0)
-    glDeleteBuffers(1, &this->vbo_normals);
+  if (this->vbo_indices != 0)
+    glDeleteBuffers(1, &this->vbo_indices);
 
-  if (this->vbo_textures != 0)
-    glDeleteBuffers(1, &this->vbo_textures);
-
-  this->vbo_points = shape.vbo_points;
-  this->vbo_normals = shape.vbo_normals;
-  this->vbo_textures = shape.vbo_textures;
+  this->vbo_vertices = shape.vbo_vertices;
+  this->vbo_indices = shape.vbo_indices;
+  this->indexType = shape.indexType;
+  this->lodFirstIndex = std::move(shape.lodFirstIndex);
   this->trianglesByPos = std::move(shape.trianglesByPos);
+  this->lods = std::move(shape.lods);
   return *this;
 }
 
 
-void push_tuple(std::vector<float>& v, std::tuple<float,float,float> t) {
-  v.push_back(std::get<0>(t));
-  v.push_back(std::get<1>(t));
-  v.push_back(std::get<2>(t));
+void copy_tuple(float* v, const Vec3& t) {
+  memcpy(v, t.data(), 3 * sizeof(float));
 }
 
-void push_tuple(std::vector<float>& v, std::tuple<float,float> t) {
-  v.push_back(std::get<0>(t));
-  v.push_back(std::get<1>(t));
+void copy_tuple(float* v, std::tuple<float,float> t) {
+  v[0] = std::get<0>(t);
+  v[1] = std::get<1>(t);
 }
 
-void Shape::initialize() {
-  std::vector<float> p, n, t;
+/**
+ * @brief Creates a buffer object and copies the given data to it
+ *
+ * @param target the target to bind the buffer to
+ * @param size   the size of the data, in bytes
+ * @param data   the data
+ *
+ * @return the name of the buffer
+*/
+static GLuint createBuffer(GLenum target, size_t size, const void* data) {
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+
+	// copiar o vector para a memória gráfica
+	glBindBuffer(target, buffer);
+	glBufferData(
+		target, // tipo do buffer, só é relevante na altura do desenho
+		size, // tamanho do vector em bytes
+		data, // os dados do array associado ao vector
+		GL_STATIC_DRAW // indicativo da utilização (estático e para desenho)
+	);
 
-  //TODO: use vbo indexes
-  for (TriangleByPosition tr : this->trianglesByPos) {
-    push_tuple(p, this->points[std::get<0>(tr)]);
-    push_tuple(p, this->points[std::get<1>(tr)]);
-    push_tuple(p, this->points[std::get<2>(tr)]);
+  return buffer;
+}
 
-    push_tuple(n, this->normals[std::get<0>(tr)]);
-    push_tuple(n, this->normals[std::get<1>(tr)]);
-    push_tuple(n, this->normals[std::get<2>(tr)]);
+/**
+ * @brief Uploads the indices of the triangles to an element buffer, using the
+ * smallest index type that can address all the vertices
+ *
+ * @param vertexCount the number of vertices
+ * @param indexCount  the number of indices
+ * @param index       returns the i-th index
+ * @param indexType   where to store the type of the uploaded indices
+ *
+ * @return the name of the buffer
+*/
+template <typename F>
+static GLuint createIndexBuffer(size_t vertexCount, size_t indexCount, F index, GLenum& indexType) {
+  if (vertexCount <= 65536) {
+    std::vector<GLushort> indices(indexCount);
+    for (size_t i = 0; i < indexCount; i++)
+      indices[i] = (GLushort)index(i);
+
+    indexType = GL_UNSIGNED_SHORT;
+    return createBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data());
+  }
+
+  std::vector<GLuint> indices(indexCount);
+  for (size_t i = 0; i < indexCount; i++)
+    indices[i] = (GLuint)index(i);
+
+  indexType = GL_UNSIGNED_INT;
+  return createBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data());
+}
 
-    push_tuple(t, this->textures[std::get<0>(tr)]);
-    push_tuple(t, this->textures[std::get<1>(tr)]);
-    push_tuple(t, this->textures[std::get<2>(tr)]);
+size_t vertexStride(VertexLayout layout) {
+  switch (layout) {
+  case VertexLayout::Position:
+    return offsetof(Vertex, normal);
+  case VertexLayout::PositionNormal:
+    return offsetof(Vertex, texture);
+  default:
+    return sizeof(Vertex);
   }
+}
 
-  glGenBuffers(1, &this->vbo_points);
+void Shape::setVertexLayout(VertexLayout layout) {
+  this->layout = layout;
+}
 
-	// copiar o vector para a memória gráfica
-	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_points);
-	glBufferData(
-		GL_ARRAY_BUFFER, // tipo do buffer, só é relevante na altura do desenho
-		sizeof(float) * p.size(), // tamanho do vector em bytes
-		p.data(), // os dados do array associado ao vector
-		GL_STATIC_DRAW // indicativo da utilização (estático e para desenho)
-	);
+VertexLayout Shape::vertexLayout() const {
+  bool hasNormals, hasTextures;
 
-  glGenBuffers(1, &this->vbo_normals);
-	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_normals);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * n.size(), n.data(), GL_STATIC_DRAW);
+  if (this->mapped.file != nullptr) {
+    hasNormals = this->mapped.normals != nullptr;
+    hasTextures = this->mapped.textures != nullptr;
+  } else {
+    hasNormals = !this->points.empty() && this->normals.size() == this->points.size();
+    hasTextures = !this->points.empty() && this->textures.size() == this->points.size();
+  }
+
+  //texture coordinates are only kept along with normals
+  VertexLayout available = !hasNormals ? VertexLayout::Position
+                         : !hasTextures ? VertexLayout::PositionNormal
+                         : VertexLayout::PositionNormalTexture;
 
-  glGenBuffers(1, &this->vbo_textures);
-  glBindBuffer(GL_ARRAY_BUFFER, this->vbo_textures);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * t.size(), t.data(), GL_STATIC_DRAW);
+  return std::min(this->layout, available);
+}
+
+void Shape::initialize() {
+  VertexLayout layout = vertexLayout();
+  size_t stride = vertexStride(layout);
+  size_t n = this->mapped.file != nullptr ? this->mapped.vertexCount : this->points.size();
+
+  //interleave the attributes of the layout in a single buffer. Since each
+  //layout is a prefix of Vertex, only the first `stride` bytes of each are kept
+  std::vector<unsigned char> vertices(n * stride);
+
+  for (size_t i = 0; i < n; i++) {
+    Vertex v;
+
+    if (this->mapped.file != nullptr) {
+      //the welded attributes are read straight from the mapped file
+      memcpy(v.position, &this->mapped.points[3 * i], sizeof(v.position));
+      if (layout >= VertexLayout::PositionNormal)
+        memcpy(v.normal, &this->mapped.normals[3 * i], sizeof(v.normal));
+      if (layout >= VertexLayout::PositionNormalTexture)
+        memcpy(v.texture, &this->mapped.textures[2 * i], sizeof(v.texture));
+    } else {
+      copy_tuple(v.position, this->points[i]);
+      if (layout >= VertexLayout::PositionNormal)
+        copy_tuple(v.normal, this->normals[i]);
+      if (layout >= VertexLayout::PositionNormalTexture)
+        copy_tuple(v.texture, this->textures[i]);
+    }
+
+    memcpy(&vertices[i * stride], &v, stride);
+  }
+
+  this->vbo_vertices = createBuffer(GL_ARRAY_BUFFER, vertices.size(), vertices.data());
+
+  //the levels of detail are stored one after the other
+  size_t levels = lodCount();
+  this->lodFirstIndex.assign(levels + 1, 0);
+  for (size_t l = 0; l < levels; l++)
+    this->lodFirstIndex[l + 1] = this->lodFirstIndex[l] + 3 * lodTriangleCount(l);
+
+  if (this->mapped.file != nullptr && n > 65536) {
+    this->indexType = GL_UNSIGNED_INT;
+    this->vbo_indices = createBuffer(GL_ELEMENT_ARRAY_BUFFER, this->lodFirstIndex[levels] * sizeof(uint32_t), nullptr);
+    for (size_t l = 0; l < levels; l++)
+      glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, this->lodFirstIndex[l] * sizeof(uint32_t),
+                      3 * lodTriangleCount(l) * sizeof(uint32_t), mappedTriangles(l));
+  } else {
+    //the indices are asked for in order, so the level they are in only moves forward
+    size_t lod = 0;
+    this->vbo_indices = createIndexBuffer(n, this->lodFirstIndex[levels], [this, &lod](size_t i) -> int {
+      while (i >= this->lodFirstIndex[lod + 1])
+        lod++;
+      i -= this->lodFirstIndex[lod];
+
+      if (this->mapped.file != nullptr)
+        return mappedTriangles(lod)[i];
+
+      const TriangleByPosition& tr = (lod == 0 ? this->trianglesByPos : this->lods[lod - 1].triangles)[i / 3];
+      return i % 3 == 0 ? std::get<0>(tr) : i % 3 == 1 ? std::get<1>(tr) : std::get<2>(tr);
+    }, this->indexType);
+  }
+
+  this->layout = layout;
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 BoundingBox Shape::getBoundingBox() {
   return boundingBox;
 }
 
-void Shape::draw() {
+void Shape::draw(size_t lod) {
   /*
   for (TriangleByPosition &triangle : this->trianglesByPos) {
     Point p1 = this->points[std::get<0>(triangle)];
@@ -334,53 +787,194 @@ void Shape::draw() {
 
     glBegin(GL_TRIANGLES);
 
-    glVertex3f(std::get<0>(p1), std::get<1>(p1), std::get<2>(p1));
-    glVertex3f(std::get<0>(p2), std::get<1>(p2), std::get<2>(p2));
-    glVertex3f(std::get<0>(p3), std::get<1>(p3), std::get<2>(p3));
+    glVertex3f(p1.x, p1.y, p1.z);
+    glVertex3f(p2.x, p2.y, p2.z);
+    glVertex3f(p3.x, p3.y, p3.z);
     glEnd();
   }
   */
 
-  if (vbo_points == 0 || vbo_normals == 0 || vbo_textures == 0)
+  bind();
+  drawBound(lod);
+  unbind();
+}
+
+void Shape::bind() const {
+  if (vbo_vertices == 0 || vbo_indices == 0)
     throw std::runtime_error("Attept to draw uninitialized shape");
 
-	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_points);
-	glVertexPointer(3, GL_FLOAT, 0, 0);
+  GLsizei stride = vertexStride(this->layout);
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_vertices);
+	glVertexPointer(3, GL_FLOAT, stride, (void*)offsetof(Vertex, position));
+
+  //the client states of the attributes missing from the layout are disabled
+  //while the shape is bound, as they would otherwise point into a previous shape
+  if (this->layout >= VertexLayout::PositionNormal)
+    glNormalPointer(GL_FLOAT, stride, (void*)offsetof(Vertex, normal));
+  else
+    glDisableClientState(GL_NORMAL_ARRAY);
+
+  if (this->layout >= VertexLayout::PositionNormalTexture)
+    glTexCoordPointer(2, GL_FLOAT, stride, (void*)offsetof(Vertex, texture));
+  else
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 
-  glBindBuffer(GL_ARRAY_BUFFER, this->vbo_normals);
-  glNormalPointer(GL_FLOAT, 0, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbo_indices);
+}
+
+void Shape::drawBound(size_t lod, size_t instances) const {
+  lod = std::min(lod, lodCount() - 1);
+  size_t indexSize = this->indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+  if (instances > 1)
+    glDrawElementsInstanced(GL_TRIANGLES, lodTriangleCount(lod) * 3, this->indexType,
+                            (void*)(this->lodFirstIndex[lod] * indexSize), instances);
+  else
+    glDrawElements(GL_TRIANGLES, lodTriangleCount(lod) * 3, this->indexType,
+                   (void*)(this->lodFirstIndex[lod] * indexSize));
+}
+
+void Shape::unbind() const {
+  if (this->layout < VertexLayout::PositionNormal)
+    glEnableClientState(GL_NORMAL_ARRAY);
 
-  glBindBuffer(GL_ARRAY_BUFFER, this->vbo_textures);
-  glTexCoordPointer(2, GL_FLOAT, 0, 0);
+  if (this->layout < VertexLayout::PositionNormalTexture)
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+}
 
-	glDrawArrays(GL_TRIANGLES, 0, this->trianglesByPos.size() * 3);
-  //glDrawElements(GL_TRIANGLES, this->points.size(), GL_UNSIGNED_INT, indices);
+bool Shape::exportToFile(std::string filePath, bool binary) {
+  materialize();
+  return binary ? writeBinaryFile(filePath) : writeTextFile(filePath);
 }
 
-bool Shape::exportToFile(std::string filePath) {
+bool Shape::writeTextFile(std::string filePath) {
   std::ofstream file(filePath);
   int n = this->points.size();
-  file << n << std::endl;//write the number of points
+  file << n << '\n';//write the number of points
 
   for (Point p : this->points) {
-    file << std::get<0>(p) << " " << std::get<1>(p) << " " << std::get<2>(p)
-         << std::endl; // for each point write its x,y,z coordenates
+    file << p.x << " " << p.y << " " << p.z
+         << '\n'; // for each point write its x,y,z coordenates
   }
 
   for (Vector n : this->normals)
-    file << std::get<0>(n) << " " << std::get<1>(n) << " " << std::get<2>(n)
-         << std::endl; // for each normal write its x,y,z coordenates
+    file << n.x << " " << n.y << " " << n.z
+         << '\n'; // for each normal write its x,y,z coordenates
 
   for (Point2D t : this->textures)
     file << std::get<0>(t) << " " << std::get<1>(t)
-         << std::endl; // for each point write its u,v coordenates
+         << '\n'; // for each point write its u,v coordenates
     
-  file << this->trianglesByPos.size() << std::endl;//write the number of triangles
+  file << this->trianglesByPos.size() << '\n';//write the number of triangles
   for (TriangleByPosition pos : this->trianglesByPos)
     file << std::get<0>(pos) << " " << std::get<1>(pos) << " "
-         << std::get<2>(pos) << std::endl; // for each triangle write the position in the points vector of the points that compose the triangle
+         << std::get<2>(pos) << '\n'; // for each triangle write the position in the points vector of the points that compose the triangle
+
+  if (!this->lods.empty()) {
+    file << this->lods.size() << '\n'; // write the number of levels of detail
+
+    for (const LOD& lod : this->lods) {
+      file << lod.triangles.size() << " " << lod.error << '\n';
+      for (const TriangleByPosition& pos : lod.triangles)
+        file << std::get<0>(pos) << " " << std::get<1>(pos) << " " << std::get<2>(pos) << '\n';
+    }
+  }
   
   file.close();
   
-  return true;
+  return !file.fail();
+}
+
+/**
+ * @brief Rounds the given offset up to the alignment of the sections of a binary 3D file
+*/
+static uint64_t alignSection(uint64_t offset) {
+  return (offset + 15) & ~(uint64_t)15;
+}
+
+bool Shape::writeBinaryFile(std::string filePath) {
+  std::vector<float> p, n, t;
+  std::vector<uint32_t> tr;
+
+  for (const Point& point : this->points)
+    p.insert(p.end(), { GET_ALL(point) });
+  for (const Vector& normal : this->normals)
+    n.insert(n.end(), { GET_ALL(normal) });
+  for (const Point2D& texture : this->textures)
+    t.insert(t.end(), { std::get<0>(texture), std::get<1>(texture) });
+  auto appendTriangles = [](std::vector<uint32_t>& tr, const std::vector<TriangleByPosition>& triangles) {
+    for (const TriangleByPosition& triangle : triangles)
+      tr.insert(tr.end(), { (uint32_t)std::get<0>(triangle), (uint32_t)std::get<1>(triangle), (uint32_t)std::get<2>(triangle) });
+  };
+  appendTriangles(tr, this->trianglesByPos);
+
+  std::vector<std::vector<uint32_t>> lodTr(this->lods.size());
+  std::vector<ShapeFileLOD> lodTable(this->lods.size());
+  for (size_t l = 0; l < this->lods.size(); l++) {
+    appendTriangles(lodTr[l], this->lods[l].triangles);
+    lodTable[l].triangleCount = this->lods[l].triangles.size();
+    lodTable[l].error = this->lods[l].error;
+  }
+
+  ShapeFileHeader header = {};
+  memcpy(header.magic, SHAPE_FILE_MAGIC, sizeof(header.magic));
+  header.version = SHAPE_FILE_VERSION;
+  header.vertexCount = this->points.size();
+  header.triangleCount = this->trianglesByPos.size();
+  header.lodCount = this->lods.size();
+
+  for (int i = 0; i < 3; i++) {
+    header.aabbMin[i] = header.vertexCount == 0 ? 0 : p[i];
+    header.aabbMax[i] = header.aabbMin[i];
+  }
+  for (size_t i = 0; i < p.size(); i++) {
+    header.aabbMin[i % 3] = std::min(header.aabbMin[i % 3], p[i]);
+    header.aabbMax[i % 3] = std::max(header.aabbMax[i % 3], p[i]);
+  }
+
+  //lay out the sections one after the other, after the level of detail table
+  uint64_t offset = alignSection(sizeof(header) + lodTable.size() * sizeof(ShapeFileLOD));
+  header.pointsOffset = offset;
+  offset = alignSection(offset + p.size() * sizeof(float));
+
+  if (this->normals.size() == this->points.size()) {
+    header.normalsOffset = offset;
+    offset = alignSection(offset + n.size() * sizeof(float));
+  }
+
+  if (this->textures.size() == this->points.size()) {
+    header.texturesOffset = offset;
+    offset = alignSection(offset + t.size() * sizeof(float));
+  }
+
+  header.trianglesOffset = offset;
+  offset = alignSection(offset + tr.size() * sizeof(uint32_t));
+
+  for (size_t l = 0; l < lodTable.size(); l++) {
+    lodTable[l].trianglesOffset = offset;
+    offset = alignSection(offset + lodTr[l].size() * sizeof(uint32_t));
+  }
+
+  std::ofstream file(filePath, std::ios::binary);
+  auto writeSection = [&file](uint64_t offset, const void* data, size_t size) {
+    if (offset == 0)
+      return;
+
+    static const char padding[16] = {};
+    file.write(padding, offset - file.tellp());
+    file.write((const char*)data, size);
+  };
+
+  file.write((const char*)&header, sizeof(header));
+  file.write((const char*)lodTable.data(), lodTable.size() * sizeof(ShapeFileLOD));
+  writeSection(header.pointsOffset, p.data(), p.size() * sizeof(float));
+  writeSection(header.normalsOffset, n.data(), n.size() * sizeof(float));
+  writeSection(header.texturesOffset, t.data(), t.size() * sizeof(float));
+  writeSection(header.trianglesOffset, tr.data(), tr.size() * sizeof(uint32_t));
+  for (size_t l = 0; l < lodTable.size(); l++)
+    writeSection(lodTable[l].trianglesOffset, lodTr[l].data(), lodTr[l].size() * sizeof(uint32_t));
+  file.close();
+
+  return !file.fail();
 }
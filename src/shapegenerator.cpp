@@ -8,12 +8,16 @@
 #include <cmath>
 #include "shapegenerator.hpp"
 #include "utils.hpp"
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <fstream>
 #include <iostream>
 #include <cstring>
+#include <iterator>
 #include <map>
 #include <regex>
+#include <stdexcept>
 
 std::vector<Point2D> generateTextureCoordinates(std::vector<Triangle>& triangles, std::map<Point, Point2D>& textures) {
   std::vector<Point2D> ans = std::vector<Point2D>();
@@ -28,504 +32,234 @@ std::vector<Point2D> generateTextureCoordinates(std::vector<Triangle>& triangles
 }
 
 
-// displacement is a fraction of the angle of slicing. 0.5 displacement means
-// the circle is offset by PI/slices rad
-std::vector<Point> generateCircle(Point center, float radius, int slices,
-                                  float displacement) {
-  std::vector<Point> ans;
-
-  for (int i = 0; i < slices; i++) {
-    float angle = 2 * M_PI * (i + displacement) / slices;
-    Vector v = {radius * cos(angle), 0, radius * sin(angle)};
-    ans.push_back(center + v);
-  }
-
-  return ans;
+/**
+ * @brief Returns a vertex from its position, normal and texture coordinates
+*/
+static Vertex makeVertex(Point p, Vector n, float u, float v) {
+  return { { p.x, p.y, p.z }, { n.x, n.y, n.z }, { u, v } };
 }
 
-void generateSquare(Point p1, Point p2, Point p3, Point p4,
-                    std::vector<Triangle> &triangles) {
-  triangles.push_back({p1, p2, p3});
-  triangles.push_back({p1, p3, p4});
+//the angles of the rounded shapes wrap around at the last column, so the
+//vertices of their seams are the same as those of the first column
+
+std::vector<GridSurface> sphereSurfaces(float radius, int slices, int stacks) {
+  //a column per slice and a row per stack, from the south to the north pole
+  return { { slices, stacks, true, true, [=](int column, int row) {
+    float alpha = 2 * M_PI * (column % slices) / slices;
+    float beta = -M_PI_2 + M_PI * row / stacks;
+    Vector n = { cosf(beta) * cosf(alpha), sinf(beta), cosf(beta) * sinf(alpha) };
+    return makeVertex(radius * n, n, 1 - (float) column / slices, (float) row / stacks);
+  } } };
 }
 
-void generatePolygon(std::vector<Point> vertices,
-                     std::vector<Triangle> &triangles) {
-  Point center = average(vertices.begin(), vertices.end());
-
-  for (int i = 0; i < (int)vertices.size(); i++)
-    triangles.push_back({vertices.at(i), vertices.at((i + 1) % vertices.size()), center});
+std::vector<GridSurface> coneSurfaces(float radius, float height, int slices, int stacks) {
+  GridSurface side = { slices, stacks, false, true, [=](int column, int row) {
+    float alpha = 2 * M_PI * (column % slices) / slices;
+    float r = radius * (stacks - row) / stacks;
+    Point p = { r * cosf(alpha), height * row / stacks, r * sinf(alpha) };
+    Vector n = normalize({ height * cosf(alpha), radius, height * sinf(alpha) });
+    return makeVertex(p, n, (float) column / slices, (float) row / stacks);
+  } };
+
+  //from the center to the rim, so it faces down
+  GridSurface base = { slices, 1, true, false, [=](int column, int row) {
+    float alpha = 2 * M_PI * (column % slices) / slices;
+    Point p = { row * radius * cosf(alpha), 0, row * radius * sinf(alpha) };
+    return makeVertex(p, { 0, -1, 0 }, p.x / (2 * radius) + 0.5f, p.z / (2 * radius) + 0.5f);
+  } };
+
+  return { side, base };
 }
 
-std::unique_ptr<Shape> generatePlane(float length, int divisions) {
-  /*
-
-  In order to generate a plane with length l and d divisions, we do the
-  following:
-
-  1. Compute all the relevant points in the plane and their respective
-  texture mapping
-  2. Create a mapping between these points and their indices in the
-  vector that stores them. This will be useful when computing the faces
-  3. Compute the vertices belonging to each face. Use the reverse mapping
-  to store the indices of all vertices of a face. They must be generated
-  in counter-clockwise fashion
-
-  Texture mapping is trivial. Point (x,y) will have texture coordinate
-  ( (x + (length / 2))/ length, (y / (length / 2)) / length)
-
-  Normals are simply equal to (0,1,0)
-
-  */
-  std::vector<Triangle> triangles;
-  std::vector<Vector> normals;
-  std::vector<Point2D> textureMapping;
-
-  float mid = length / 2.0;
-  float step = length / divisions;
-
-  for (int i = 0; i < divisions; i++) {
-    for (int j = 0; j < divisions; j++) {
-      generateSquare({-mid + i * step, 0, -mid + j * step},
-                     {-mid + i * step, 0, -mid + (j + 1) * step},
-                     {-mid + (i + 1) * step, 0, -mid + (j + 1) * step},
-                     {-mid + (i + 1) * step, 0, -mid + j * step}, triangles);
-    }
-  }
-
-  for(Triangle t : triangles) {
-    Point p[3] = {std::get<0>(t), std::get<1>(t), std::get<2>(t)};
-    for(int i = 0; i < 3; i++) {
-      float x = std::get<0>(p[i]);
-      float z = std::get<2>(p[i]);
-
-      textureMapping.push_back({(x + mid) / length, (z + mid) / length});
-      normals.push_back({0.0f, 1.0f, 0.0f});
-    }
-  }
-
-  return std::make_unique<Shape>(triangles, normals, textureMapping);
+std::vector<GridSurface> cylinderSurfaces(float radius, float height, int slices) {
+  GridSurface side = { slices, 1, false, false, [=](int column, int row) {
+    float alpha = 2 * M_PI * (column % slices) / slices;
+    Vector n = { cosf(alpha), 0, sinf(alpha) };
+    Point p = { radius * n.x, row * height, radius * n.z };
+    return makeVertex(p, n, 1 - (float) column / slices, 0.375f + row * 0.625f);
+  } };
+
+  //from the rim to the center, so it faces up
+  GridSurface top = { slices, 1, false, true, [=](int column, int row) {
+    float alpha = 2 * M_PI * (column % slices) / slices;
+    Point p = { (1 - row) * radius * cosf(alpha), height, (1 - row) * radius * sinf(alpha) };
+    float u = p.x / (2 * radius) + 0.5f, v = p.z / (2 * radius) + 0.5f;
+    return makeVertex(p, { 0, 1, 0 }, u * 0.375f + 0.25f, (1 - v) * 0.375f);
+  } };
+
+  //from the center to the rim, so it faces down
+  GridSurface bottom = { slices, 1, true, false, [=](int column, int row) {
+    float alpha = 2 * M_PI * (column % slices) / slices;
+    Point p = { row * radius * cosf(alpha), 0, row * radius * sinf(alpha) };
+    float u = p.x / (2 * radius) + 0.5f, v = p.z / (2 * radius) + 0.5f;
+    return makeVertex(p, { 0, -1, 0 }, u * 0.375f + 0.625f, (1 - v) * 0.375f);
+  } };
+
+  return { side, top, bottom };
 }
 
-std::unique_ptr<Shape> generateCube(float length, int divisions) {
-  std::vector<Triangle> triangles;
-  std::vector<Vector> normals;
-  std::vector<Point2D> textureMapping;
-
-  float mid = length / 2.0;
-  float step = length / divisions;
-  int count = 0;
-
-  for (int i = 0; i < divisions; i++) {
-    for (int j = 0; j < divisions; j++) {
-      generateSquare({-mid, -mid + i * step, -mid + j * step},
-                     {-mid, -mid + i * step, -mid + (j + 1) * step},
-                     {-mid, -mid + (i + 1) * step, -mid + (j + 1) * step},
-                     {-mid, -mid + (i + 1) * step, -mid + j * step}, triangles);
-    }
-  }
-  float p_x, p_y, p_z;
-  p_x = -mid;
-  p_y = -mid;
-  p_z = -mid;
-
-  //Face 4
-  for(; count < (int)triangles.size(); count++) {
-    Point p[3] = {std::get<0>(triangles[count]), std::get<1>(triangles[count]), std::get<2>(triangles[count])};
-    for(int i = 0; i < 3; i++) {
-      float y = std::get<1>(p[i]);
-      float z = std::get<2>(p[i]);
-
-      float u = (z - p_z) / length;
-      float v = (y - p_y) / length;
-
-      u = (u / 4.0f) + 0.75f;
-      v = (v / 3.0f) + (1.0f / 3.0f);
-
-      textureMapping.push_back({u, v});
-      normals.push_back({-1.0f, 0.0f, 0.0f});
-    }
-  }
-
-  for (int i = 0; i < divisions; i++) {
-    for (int j = 0; j < divisions; j++) {
-      generateSquare({mid, -mid + (i + 1) * step, -mid + j * step},
-                     {mid, -mid + (i + 1) * step, -mid + (j + 1) * step},
-                     {mid, -mid + i * step, -mid + (j + 1) * step},
-                     {mid, -mid + i * step, -mid + j * step}, triangles);
-    }
-  }
-
-  p_x = mid;
-  p_y = -mid;
-  p_z = -mid;
-
-  //Face 2
-  for(; count < (int)triangles.size(); count++) {
-    Point p[3] = {std::get<0>(triangles[count]), std::get<1>(triangles[count]), std::get<2>(triangles[count])};
-    for(int i = 0; i < 3; i++) {
-      float z = std::get<2>(p[i]);
-      float y = std::get<1>(p[i]);
-
-      float u = (z - p_z) / length;
-      float v = (y - p_y) / length;
-
-      u = 0.5f - (u / 4.0f) ;
-      v = (v / 3.0f) + (1.0f / 3.0f);
-
-      textureMapping.push_back({u, v});
-      normals.push_back({1.0f, 0.0f, 0.0f});
-    }
-  }
-
-  for (int i = 0; i < divisions; i++) {
-    for (int j = 0; j < divisions; j++) {
-      generateSquare({-mid + (i + 1) * step, -mid, -mid + j * step},
-                     {-mid + (i + 1) * step, -mid, -mid + (j + 1) * step},
-                     {-mid + i * step, -mid, -mid + (j + 1) * step},
-                     {-mid + i * step, -mid, -mid + j * step}, triangles);
-
-      
-    }
-  }
-
-  p_x = -mid;
-  p_y = -mid;
-  p_z = -mid;
-
-  //Face 6
-  for(; count < (int)triangles.size(); count++) {
-    Point p[3] = {std::get<0>(triangles[count]), std::get<1>(triangles[count]), std::get<2>(triangles[count])};
-    for(int i = 0; i < 3; i++) {
-      float x = std::get<0>(p[i]);
-      float z = std::get<2>(p[i]);
-
-      float v = (x - p_x) / length;
-      float u = 1.0f - (z - p_z) / length;
-
-      u = (u / 4.0f) + 0.25f;
-      v = (v / 3.0f);
+/**
+ * @brief Returns the texture coordinates of a point on a face of a cube, in
+ * a cross-shaped layout
+*/
+static Point2D cubeTexture(Vector normal, Point p, float length) {
+  float mid = length / 2;
+  if (normal.x < 0)
+    return { (p.z + mid) / length / 4 + 0.75f, (p.y + mid) / length / 3 + 1.0f / 3 };
+  if (normal.x > 0)
+    return { 0.5f - (p.z + mid) / length / 4, (p.y + mid) / length / 3 + 1.0f / 3 };
+  if (normal.y < 0)
+    return { (1 - (p.z + mid) / length) / 4 + 0.25f, (p.x + mid) / length / 3 };
+  if (normal.y > 0)
+    return { (mid - p.z) / length / 4 + 0.25f, (mid - p.x) / length / 3 + 2.0f / 3 };
+  if (normal.z < 0)
+    return { (-mid - p.x) / length / 4 - 0.75f, (p.y + mid) / length / 3 + 1.0f / 3 };
+  return { (p.x - mid) / length / 4 + 0.75f, (p.y + mid) / length / 3 + 1.0f / 3 };
+}
 
-      textureMapping.push_back({u, v});
-      normals.push_back({0.0f, -1.0f, 0.0f});
-    }
-  }
+std::vector<GridSurface> cubeSurfaces(float length, int divisions) {
+  //the normal of each face, and the directions of its columns and rows,
+  //such that the rows crossed with the columns give the normal
+  static const Vector faces[6][3] = {
+    { {  1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+    { { -1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+    { { 0,  1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+    { { 0, -1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+    { { 0, 0,  1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+    { { 0, 0, -1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+  };
 
-  for (int i = 0; i < divisions; i++) {
-    for (int j = 0; j < divisions; j++) {
-      generateSquare({-mid + i * step, mid, -mid + j * step},
-                     {-mid + i * step, mid, -mid + (j + 1) * step},
-                     {-mid + (i + 1) * step, mid, -mid + (j + 1) * step},
-                     {-mid + (i + 1) * step, mid, -mid + j * step}, triangles);
-    }
+  float mid = length / 2, step = length / divisions;
+  std::vector<GridSurface> surfaces;
+  for (const Vector* face : faces) {
+    Vector normal = face[0], columns = face[1], rows = face[2];
+    Point corner = mid * normal - mid * columns - mid * rows;
+
+    surfaces.push_back({ divisions, divisions, false, false, [=](int column, int row) {
+      Point p = corner + (column * step) * columns + (row * step) * rows;
+      Point2D t = cubeTexture(normal, p, length);
+      return makeVertex(p, normal, std::get<0>(t), std::get<1>(t));
+    } });
   }
 
-  p_x = mid;
-  p_y = mid;
-  p_z = mid;
-
-  //Face 5
-  for(; count < (int)triangles.size(); count++) {
-    Point p[3] = {std::get<0>(triangles[count]), std::get<1>(triangles[count]), std::get<2>(triangles[count])};
-    for(int i = 0; i < 3; i++) {
-      float x = std::get<0>(p[i]);
-      float z = std::get<2>(p[i]);
-
-      float v = (p_x - x) / length;
-      float u = (p_z - z) / length;
-
-      u = (u / 4.0f) + 0.25f;
-      v = (v / 3.0f) + (2.0f / 3.0f);
-
-      textureMapping.push_back({u, v});
-      normals.push_back({0.0f, 1.0f, 0.0f});
-    }
-  }
-
-  for (int i = 0; i < divisions; i++) {
-    for (int j = 0; j < divisions; j++) {
-      generateSquare({-mid + i * step, -mid + j * step, -mid},
-                     {-mid + i * step, -mid + (j + 1) * step, -mid},
-                     {-mid + (i + 1) * step, -mid + (j + 1) * step, -mid},
-                     {-mid + (i + 1) * step, -mid + j * step, -mid}, triangles);
-    }
-  }
+  return surfaces;
+}
 
-  p_x = -mid;
-  p_y = -mid;
-  p_z = -mid;
+std::vector<GridSurface> planeSurfaces(float length, int divisions) {
+  float mid = length / 2, step = length / divisions;
+  return { { divisions, divisions, false, false, [=](int column, int row) {
+    Point p = { -mid + column * step, 0, -mid + row * step };
+    return makeVertex(p, { 0, 1, 0 }, (float) column / divisions, (float) row / divisions);
+  } } };
+}
 
-  //Face 1
-  for(; count < (int)triangles.size(); count++) {
-    Point p[3] = {std::get<0>(triangles[count]), std::get<1>(triangles[count]), std::get<2>(triangles[count])};
-    for(int i = 0; i < 3; i++) {
-      float y = std::get<1>(p[i]);
-      float x = std::get<0>(p[i]);
+std::vector<GridSurface> donutSurfaces(float radius, float length, float height, int stacks, int slices) {
+  const float a = length / 2, b = height / 2;
 
-      float u = (p_x - x) / length;
-      float v = (y - p_y) / length;
+  //a column per stack, around the ellipse, and a row per slice, around the y axis
+  return { { stacks, slices, false, false, [=](int column, int row) {
+    float theta = 2 * M_PI * (column % stacks) / stacks;
+    float alpha = 2 * M_PI * (row % slices) / slices;
 
-      u = (u / 4.0f) - 0.75f;
-      v = (v / 3) + (1.0f / 3.0f);
+    float r = a * b / sqrtf((b * cosf(theta)) * (b * cosf(theta)) + (a * sinf(theta)) * (a * sinf(theta)));
+    float x = r * cosf(theta), y = r * sinf(theta);
+    Point p = rotate({ 0, 1, 0 }, { radius - a + x, y, 0 }, alpha);
+    Vector n = rotate({ 0, 1, 0 }, normalize({ x / (a * a), y / (b * b), 0 }), alpha);
+    return makeVertex(p, n, (float) column / stacks, (float) row / slices);
+  } } };
+}
 
-      textureMapping.push_back({u, v});
-      normals.push_back({0.0f, 0.0f, -1.0f});
-    }
-  }
+/**
+ * @brief Returns whether two vertices have the same attributes, comparing
+ * them as floats so 0 and -0 are the same
+*/
+static bool sameVertex(const Vertex& v1, const Vertex& v2) {
+  return std::equal(std::begin(v1.position), std::end(v1.position), std::begin(v2.position))
+      && std::equal(std::begin(v1.normal), std::end(v1.normal), std::begin(v2.normal))
+      && std::equal(std::begin(v1.texture), std::end(v1.texture), std::begin(v2.texture));
+}
 
-  for (int i = 0; i < divisions; i++) {
-    for (int j = 0; j < divisions; j++) {
-      generateSquare({-mid + (i + 1) * step, -mid + j * step, mid},
-                     {-mid + (i + 1) * step, -mid + (j + 1) * step, mid},
-                     {-mid + i * step, -mid + (j + 1) * step, mid},
-                     {-mid + i * step, -mid + j * step, mid}, triangles);
-    }
+std::unique_ptr<Shape> generateFromSurfaces(const std::vector<GridSurface>& surfaces) {
+  std::vector<Point> points;
+  std::vector<Vector> normals;
+  std::vector<Point2D> textures;
+  std::vector<TriangleByPosition> triangles;
+
+  size_t vertexCount = 0, triangleCount = 0;
+  for (const GridSurface& surface : surfaces) {
+    if (surface.columns < 1 || surface.rows < 1)
+      throw std::invalid_argument("The number of slices, stacks and divisions must be positive");
+    vertexCount += (size_t) (surface.columns + 1) * (surface.rows + 1);
+    triangleCount += (size_t) 2 * surface.columns * surface.rows;
   }
-  
-  p_x = mid;
-  p_y = -mid;
-  p_z = mid;
-
-  //Face 3
-  for(; count < (int)triangles.size(); count++) {
-    Point p[3] = {std::get<0>(triangles[count]), std::get<1>(triangles[count]), std::get<2>(triangles[count])};
-    for(int i = 0; i < 3; i++) {
-      float y = std::get<1>(p[i]);
-      float x = std::get<0>(p[i]);
+  points.reserve(vertexCount);
+  normals.reserve(vertexCount);
+  textures.reserve(vertexCount);
+  triangles.reserve(triangleCount);
+
+  for (const GridSurface& surface : surfaces) {
+    //the index of each vertex of the previous and the current row
+    std::vector<int> previous(surface.columns + 1), current(surface.columns + 1);
+
+    for (int row = 0; row <= surface.rows; row++) {
+      bool collapsed = (row == 0 && surface.collapsedFirst) || (row == surface.rows && surface.collapsedLast);
+
+      //the vertices equal to the first of their row are shared instead of
+      //repeated: those of a collapsed row, and the last of a closed one
+      Vertex first;
+      for (int column = 0; column <= surface.columns; column++) {
+        Vertex v = surface.vertex(column, row);
+        if (column == 0) {
+          first = v;
+        } else if ((collapsed || column == surface.columns) && sameVertex(v, first)) {
+          current[column] = current[0];
+          continue;
+        }
 
-      float u = (x - p_x) / length;
-      float v = (y - p_y) / length;
+        current[column] = points.size();
+        points.push_back({ v.position[0], v.position[1], v.position[2] });
+        normals.push_back({ v.normal[0], v.normal[1], v.normal[2] });
+        textures.push_back({ v.texture[0], v.texture[1] });
+      }
 
-      u = (u / 4.0f) + 0.75f;
-      v = (v / 3.0f) + (1.0f / 3.0f);
+      //the cells between the previous row and this one, as in GridSurface
+      for (int column = 0; row > 0 && column < surface.columns; column++) {
+        int a = previous[column], b = previous[column + 1], c = current[column], d = current[column + 1];
+        if (!(surface.collapsedLast && row == surface.rows))
+          triangles.push_back({ a, c, d });
+        if (!(surface.collapsedFirst && row == 1))
+          triangles.push_back({ a, d, b });
+      }
 
-      textureMapping.push_back({u, v});
-      normals.push_back({0.0f, 0.0f, 1.0f});
+      std::swap(previous, current);
     }
   }
 
-
-  return std::make_unique<Shape>(triangles, normals, textureMapping);
+  return std::make_unique<Shape>(std::move(points), std::move(normals), std::move(textures), std::move(triangles));
 }
 
-std::unique_ptr<Shape> generateCylinder(float radius, float height,
-                                        int slices) {
-  std::vector<Point> top = generateCircle({0, height, 0}, radius, slices, 0);
-  std::vector<Point> bottom = generateCircle({0, 0, 0}, radius, slices, 0.5);
-  std::vector<Triangle> ans;
-  std::vector<Vector> normals;
-  std::vector<Point2D> textures;
-
-  for (int i = 0; i < slices; i++) {
-    int i2 = (i + 1) % slices;
-    ans.push_back({top[i], top[i2], bottom[i]});
-    ans.push_back({bottom[i2], bottom[i], top[i2]});
-
-    normals.push_back(normalize({std::get<0>(top[i]), 0.0f, std::get<2>(top[i])}));
-    normals.push_back(normalize({std::get<0>(top[i2]), 0.0f, std::get<2>(top[i2])}));
-    normals.push_back(normalize({std::get<0>(bottom[i]), 0.0f, std::get<2>(bottom[i])}));
-    normals.push_back(normalize({std::get<0>(bottom[i2]), 0.0f, std::get<2>(bottom[i2])}));
-    normals.push_back(normalize({std::get<0>(bottom[i]), 0.0f, std::get<2>(bottom[i])}));
-    normals.push_back(normalize({std::get<0>(top[i2]), 0.0f, std::get<2>(top[i2])}));
-
-    i2 = i == slices - 1 ? slices : i2;
-    textures.push_back({1.0f - (float)i / slices, 1.0f});
-    textures.push_back({1.0f - (float)i2 / slices, 1.0f});
-    textures.push_back({1.0f - (float)i / slices, 0.375f});
-    textures.push_back({1.0f - (float)i2 / slices, 0.375f});
-    textures.push_back({1.0f - (float)i / slices, 0.375f});
-    textures.push_back({1.0f - (float)i2 / slices, 1.0f});
-
-    
-  }
-  int count = ans.size();
-  reverse(top.begin(), top.end());
-  generatePolygon(top, ans);
-
-  for(; count < (int)ans.size(); count++) {
-    Point p[3] = {std::get<0>(ans[count]), std::get<1>(ans[count]), std::get<2>(ans[count])};
-    for(int i = 0; i < 3; i++) {
-      float x = std::get<0>(p[i]);
-      float z = std::get<2>(p[i]);
-
-      float u = x / (2 * radius) + 0.5f;
-      float v = z / (2 * radius) + 0.5f;
-      v = 1 - v;
-      u *= 0.375;
-      v *= 0.375;
-      u += 0.25;
-      textures.push_back({u,v});
-      normals.push_back({0.0f, 1.0f, 0.0f});
-    }     
-  }
-
-  generatePolygon(bottom, ans);
-
-  for(; count < (int)ans.size(); count++) {
-    Point p[3] = {std::get<0>(ans[count]), std::get<1>(ans[count]), std::get<2>(ans[count])};
-    for(int i = 0; i < 3; i++) {
-      float x = std::get<0>(p[i]);
-      float z = std::get<2>(p[i]);
-
-      float u = x / (2 * radius) + 0.5f;
-      float v = z / (2 * radius) + 0.5f;
-      v = 1 - v;
-      u *= 0.375;
-      v *= 0.375;
-      u += 0.625;
-      textures.push_back({u,v});
-      normals.push_back({0.0f, -1.0f, 0.0f});
-    }     
-  }
-
-  return std::make_unique<Shape>(ans, normals, textures);
+std::unique_ptr<Shape> generatePlane(float length, int divisions) {
+  return generateFromSurfaces(planeSurfaces(length, divisions));
 }
 
-std::unique_ptr<Shape> generateCone(float radius, float height, int slices,
-                                    int stacks) {
-
-  std::vector<Triangle> ans;
-  std::vector<Vector> normals;
-  std::vector<Point> prev;
-  std::vector<Point2D> textures;
-  
-  int count = 0;
-
-  float angle = atan(radius / height);
-
-  for (int i = 0; i <= stacks; i++) {
-    float r = radius * (stacks - i) / stacks;
-
-    std::vector<Point> cur =
-        generateCircle({0, height * i / stacks, 0}, r, slices, 0);
-
-    if(i == 0) {
-      generatePolygon(cur, ans);
-
-      for(; count < (int)ans.size(); count++) {
-        Point p[3] = {std::get<0>(ans[count]), std::get<1>(ans[count]), std::get<2>(ans[count])};
-        for(int i = 0; i < 3; i++) {
-          float x = std::get<0>(p[i]);
-          float z = std::get<2>(p[i]);
-
-          float u = x / (2 * radius) + 0.5f;
-          float v = z / (2 * radius) + 0.5f;
-          textures.push_back({u,v});
-          normals.push_back({0.0f, -1.0f, 0.0f});
-        }     
-      }
-    } else {
-      for (int j = 0; j < slices; j++) {
-        Point p1 = prev.at((j + 1) % slices);
-        Point p2 = prev.at(j);
-        Point p3 = cur.at(j);
-        Point p4 = cur.at((j + 1) % slices);
-
-        ans.push_back({p1, p2, p3});
-        ans.push_back({p1, p3, p4});
-
-        textures.push_back({(float)(j + 1) / slices, (float)(i - 1) / stacks});
-        textures.push_back({(float)j / slices, (float)(i - 1) / stacks});
-        textures.push_back({(float)j / slices, (float)i / stacks});
-        textures.push_back({(float)(j + 1) / slices, (float)(i - 1) / stacks});
-        textures.push_back({(float)j / slices, (float)i / stacks});
-        textures.push_back({(float)(j + 1) / slices, (float)i / stacks});
-
-        float w = ((float)(j + 1) / slices) * 2 * M_PI;
-        normals.push_back(normalize({cos(angle) * cos(w), sin(angle), sin(w)}));
-        w = ((float)j / slices) * 2 * M_PI;
-        normals.push_back(normalize({cos(angle) * cos(w), sin(angle), sin(w)}));
-        w = ((float)j / slices) * 2 * M_PI;
-        normals.push_back(normalize({cos(angle) * cos(w), sin(angle), sin(w)}));
-        w = ((float)(j + 1) / slices) * 2 * M_PI;
-        normals.push_back(normalize({cos(angle) * cos(w), sin(angle), sin(w)}));
-        w = ((float)j / slices) * 2 * M_PI;
-        normals.push_back(normalize({cos(angle) * cos(w), sin(angle), sin(w)}));
-        w = ((float)(j + 1) / slices) * 2 * M_PI;
-        normals.push_back(normalize({cos(angle) * cos(w), sin(angle), sin(w)}));
-      }
-    }
+std::unique_ptr<Shape> generateCube(float length, int divisions) {
+  return generateFromSurfaces(cubeSurfaces(length, divisions));
+}
 
-    prev = cur;
-  }
+std::unique_ptr<Shape> generateCylinder(float radius, float height, int slices) {
+  return generateFromSurfaces(cylinderSurfaces(radius, height, slices));
+}
 
-  return std::make_unique<Shape>(ans, normals, textures);
+std::unique_ptr<Shape> generateCone(float radius, float height, int slices, int stacks) {
+  return generateFromSurfaces(coneSurfaces(radius, height, slices, stacks));
 }
 
 std::unique_ptr<Shape> generateSphere(float radius, int slices, int stacks) {
-  std::vector<Triangle> ans;
-  std::vector<Vector> normals;
-  std::vector<Point2D> textureMapping;
-  std::vector<Point> prev;
-
-  for (int i = 0; i <= stacks; i++) {
-    float h = radius * sin(-M_PI / 2.0f + ((double)i / stacks) * M_PI);
-    float r = sqrt(radius * radius - h * h);
-
-    std::vector<Point> cur = generateCircle({0, h, 0}, r, slices, 0);
-    cur.push_back(cur[0]);
-
-    if (i != 0)
-      for (int j = 0; j < slices; j++) {
-        Point p1 = prev.at(j + 1);
-        Point p2 = prev.at(j);
-        Point p3 = cur.at(j);
-        Point p4 = cur.at(j + 1);
-
-        ans.push_back({p1, p2, p3});
-        ans.push_back({p1, p3, p4});
-
-        //float u = 0.5f - (atan2(std::get<2>(p1) / radius, std::get<0>(p1) / radius)) / (2 * M_PI);
-        //float v = 0.5f + asin(std::get<1>(p1) / radius) / M_PI;
-
-        textureMapping.push_back({-(float)(j + 1) / slices,  (float)(i - 1) / stacks});
-        textureMapping.push_back({-(float)(j) / slices,  (float)(i - 1) / stacks});
-        textureMapping.push_back({-(float)(j) / slices,  (float)(i) / stacks});
-        textureMapping.push_back({-(float)(j + 1) / slices,  (float)(i - 1) / stacks});
-        textureMapping.push_back({-(float)(j) / slices,   (float)(i) / stacks});
-        textureMapping.push_back({-(float)(j + 1) / slices,  (float)(i) / stacks});
-
-        //textureMapping.push_back({u,v});
-
-        /*textureMapping.push_back({u + 1.0f / slices,v});
-        textureMapping.push_back({u,v});
-        textureMapping.push_back({u,v + 1.0f / stacks});
-        textureMapping.push_back({u + 1.0f / slices,v});
-        textureMapping.push_back({u, v + 1.0f /  stacks});
-        textureMapping.push_back({u + 1.0f / slices, v + 1.0f /  (stacks - 1)});*/
-
-        /*u = 0.5f - (atan2(std::get<2>(p2) / radius, std::get<0>(p2) / radius)) / (2 * M_PI);
-        v = 0.5f + asin(std::get<1>(p2) / radius) / M_PI;
-        textureMapping.push_back({u,v});
-
-        u = 0.5f - (atan2(std::get<2>(p3) / radius, std::get<0>(p3) / radius)) / (2 * M_PI);
-        v = 0.5f + asin(std::get<1>(p3) / radius) / M_PI;
-        textureMapping.push_back({u,v});
-
-        u = j == slices - 1 ? 1.0f : 0.5f - (atan2(std::get<2>(p1) / radius, std::get<0>(p1) / radius)) / (2 * M_PI);
-        v = 0.5f + asin(std::get<1>(p1) / radius) / M_PI;
-        textureMapping.push_back({u,v});
-
-        u = 0.5f - (atan2(std::get<2>(p3) / radius, std::get<0>(p3) / radius)) / (2 * M_PI);
-        v = 0.5f + asin(std::get<1>(p3) / radius) / M_PI;
-        textureMapping.push_back({u,v});
-
-        u = j == slices - 1 ? 1.0f : 0.5f - (atan2(std::get<2>(p4) / radius, std::get<0>(p4) / radius)) / (2 * M_PI);
-        v = 0.5f + asin(std::get<1>(p4) / radius) / M_PI;
-        textureMapping.push_back({u,v});*/
-      }
-
-    prev = cur;
-  }
-
-  for(Triangle t : ans) {
-    Point ps[3] = {std::get<0>(t), std::get<1>(t), std::get<2>(t)};
-
-    for(Point& p : ps)
-      normals.push_back(normalize(p));
-  }
+  return generateFromSurfaces(sphereSurfaces(radius, slices, stacks));
+}
 
-  return std::make_unique<Shape>(ans, normals, textureMapping);
+std::unique_ptr<Shape> generateDonut(float radius, float length, float height, int stacks, int slices) {
+  return generateFromSurfaces(donutSurfaces(radius, length, height, stacks, slices));
 }
 
 std::unique_ptr<Shape> generateFromObj(std::string srcFile) {
@@ -542,11 +276,11 @@ std::unique_ptr<Shape> generateFromObj(std::string srcFile) {
   std::ifstream file = std::ifstream(srcFile);
 
   std::string line = "";
-  const std::regex vertex(R"(v +(-?\d+\.?\ std::vector<Vector>()d*) (-?\d+\.?\d*) (-?\d+\.?\d*))");
+  const std::regex vertex(R"(v +(-?\d+\.?\d*) +(-?\d+\.?\d*) +(-?\d+\.?\d*))");
   const std::regex face(
       R"(f +((\d+)(\/?\d*\/?\d*)? ){2,}((\d+)(\/?\d*\/?\d*)?))");
   const std::regex textureRegex(R"(vt +(\d+\.?\d*) +(\d+\.?\d*))");
-  const std::regex normalRegex(R"(vn +(\d+\.?\d*) +(\d+\.?\d*))");
+  const std::regex normalRegex(R"(vn +(-?\d+\.?\d*) +(-?\d+\.?\d*) +(-?\d+\.?\d*))");
   const std::regex face_vertice(R"((\d+)\/?(\d*)\/?(\d*))");
   int count = 0;
   while (std::getline(file, line)) {
@@ -574,8 +308,8 @@ std::unique_ptr<Shape> generateFromObj(std::string srcFile) {
         int index = std::stoi(match[1]);
         temp.push_back(vertices[index]);
 
-        if(match[1] != "") {
-          int j = std::stoi(match[2]);
+        if(match[3] != "") {
+          int j = std::stoi(match[3]);
           normalMap[vertices[index]] = normals[j];
         }
 
@@ -587,18 +321,20 @@ std::unique_ptr<Shape> generateFromObj(std::string srcFile) {
         line = match.suffix().str();
       }
 
-      triangles.push_back({temp[0], temp[1], temp[2]});
+      //faces of more than 3 vertices are split in a fan around the first
+      for(size_t i = 1; i + 1 < temp.size(); i++)
+        triangles.push_back({temp[0], temp[i], temp[i + 1]});
+
       for(; count < (int)triangles.size(); count++) {
         Point p[3] = {std::get<0>(triangles[count]), std::get<1>(triangles[count]), std::get<2>(triangles[count])};
 
+        //each attribute the vertex doesn't give is zero
         for(int k = 0; k < 3; k++) {
-          if(textureMap.find(p[k]) == textureMap.end()) {
-            textureMapping.push_back({0,0});
-            normalMapping.push_back({0,0,0});
-          } else {
-            textureMapping.push_back(textureMap[p[k]]);
-            normalMapping.push_back(normalMap[p[k]]);
-          }
+          auto texture = textureMap.find(p[k]);
+          textureMapping.push_back(texture != textureMap.end() ? texture->second : Point2D{0,0});
+
+          auto normal = normalMap.find(p[k]);
+          normalMapping.push_back(normal != normalMap.end() ? normal->second : Vector{0,0,0});
         }
       }
     } // We ignore everything else
@@ -608,113 +344,8 @@ std::unique_ptr<Shape> generateFromObj(std::string srcFile) {
   return std::make_unique<Shape>(triangles, normalMapping, textureMapping);
 }
 
-std::unique_ptr<Shape> generateDonut(float radius, float length, float height,
-                                     int stacks, int slices) {
-  
-  std::vector<Triangle> triangles;
-  std::vector<Vector> normals;
-  std::vector<Point2D> textures;
-
-  const float a = length / 2.0;
-  const float b = height / 2.0;
-
-  std::vector<Point> ellipse;
-  std::vector<Vector> ellipse_n;
-
-  for (int j = 0; j < stacks; j++) {
-    float theta = (float)j / stacks * 2 * M_PI;
-    float r = a * b / sqrt((b * cos(theta)) * (b * cos(theta)) + (a * sin(theta)) * (a * sin(theta)));
-    float x = r * cos(theta);
-    float y = r * sin(theta);
-    ellipse.push_back({ radius - a + x, y, 0 });
-
-    if (abs(x) == a)
-      ellipse_n.push_back({x > 0 ? 1 : -1, 0, 0});
-    else {
-      float gamma = b*x / (a*sqrt(a*a-x*x));
-      ellipse_n.push_back(normalize({gamma, y < 0 ? -1 : 1, 0}));
-    }
-  }
-
-  for (int i = 1; i <= slices; i++)
-  {
-    float alpha0 = 2.0f * M_PI * (i - 1) / slices;
-    float alpha = 2.0f * M_PI * i / slices;
-
-    std::vector<Point> prev;
-    std::vector<Point> cur;
-    std::vector<Vector> prev_n;
-    std::vector<Vector> cur_n;
-
-    for (int j = 0; j < stacks; j++) {
-      prev.push_back(rotate({0,1,0}, ellipse[j], alpha0));
-      cur.push_back(rotate({0,1,0}, ellipse[j], alpha));
-      prev_n.push_back(rotate({0,1,0}, ellipse_n[j], alpha0));
-      cur_n.push_back(rotate({0,1,0}, ellipse_n[j], alpha));
-    }
-
-    for (int j = 0; j < stacks; j++) {
-      int loopj = (j + 1) % stacks;
-
-      Point p1 = prev[loopj];
-      Point p2 = prev[j];
-      Point p3 = cur[j];
-      Point p4 = cur[loopj];
-
-      triangles.push_back({p1, p2, p3});
-      triangles.push_back({p1, p3, p4});
-
-      Vector n1 = prev_n[loopj];
-      Vector n2 = prev_n[j];
-      Vector n3 = cur_n[j];
-      Vector n4 = cur_n[loopj];
-
-      normals.push_back(n1);
-      normals.push_back(n2);
-      normals.push_back(n3);
-      normals.push_back(n1);
-      normals.push_back(n3);
-      normals.push_back(n4);
-
-      Point2D t1 = { (float)j / stacks, (float)(i - 1) / slices };
-      Point2D t2 = { (float)(j + 1) / stacks, (float)(i - 1) / slices };
-      Point2D t3 = { (float)(j + 1) / stacks, (float)i / slices };
-      Point2D t4 = { (float)j / stacks, (float)i / slices };
-
-      textures.push_back(t1);
-      textures.push_back(t2);
-      textures.push_back(t3);
-      textures.push_back(t1);
-      textures.push_back(t3);
-      textures.push_back(t4);
-    }
-  }
 
-  return std::make_unique<Shape>(triangles, normals, textures);
-}
-
-/**
- * @brief Reads the data from a patch file.
- * 
- * Auxiliary function to #generateBezierPatches
- * 
- * The input file must have the following format:
- * 
- * A line with a single integer N. The numbers of patches in the file.
- * N lines follow. Each line contains 16 comma separated integers. The
- * indices (starting from 0) of the control points that make up the i-th patch.
- * 
- * A line with a single integer M. The number of control points. M lines follow.
- * The i-th line contains three floating point numbers: the coordinates of the i-th
- * control point.
- * 
- * The input vectors must be initialized, but their capacity can be zero.
- * 
- * @param inputFile     the path to the patch file
- * @param controlPoints the control points
- * @param patches       the patches
-*/
-inline void readBezierPatchFile(std::string inputFile, std::vector<Point>& controlPoints, std::vector<int[16]>& patches) {
+void readBezierPatchFile(std::string inputFile, std::vector<Point>& controlPoints, std::vector<int[16]>& patches) {
   std::ifstream file(inputFile);
 
   int patchCount;
@@ -757,167 +388,326 @@ inline void readBezierPatchFile(std::string inputFile, std::vector<Point>& contr
 }
 
 /**
- * @brief Computes the triangles needed to render the bezier patches provided.
- * 
- * Auxiliary function to #generateBezierPatches
- * 
- * @param controlPoints the control points
- * @param patches       the patches
- * @param divisions     the number of divisions of a patch in one axis
- * @param triangles     the vector in which to store the triangles
- * @param normals       the vector in which to store the vertex normals
- * @param textures      the vector in which to store the texture coordinates
+ * @brief How far a sample of a Bezier patch is moved into the patch, in
+ * parameter space, to find the normal where the patch is degenerate (such as
+ * the poles of the teapot's lid)
 */
-inline void generateBezierTriangles(std::vector<Point>& controlPoints, std::vector<int[16]>& patches,
- int divisions, std::vector<Triangle>& triangles, std::vector<Vector>& normals, std::vector<Point2D>& textures) {
-  /*
-  
-  Given 16 control points p[0][0], p[0][1], ..., p[3][2], p[3][3], the Bezier patch
-  is calculated as:
-
-                           (p[0][0] p[0][1] p[0][2] p[0][3])     (v^3)
-  p(u,v) = (u^3 u^2 u 1) M (p[1][0] p[1][1] p[1][2] p[1][3]) M^T (v^2)
-                           (p[2][0] p[2][1] p[2][2] p[2][3])     ( v )
-                           (p[3][0] p[3][1] p[3][2] p[3][3])     ( 1 )
-
-      (-1 3 -3 1)
-  M = (3 -6  3  0)
-      (-3 3  0  0)
-      (1  0  0  0)
-  
-  Note that M = M^T
+#define BEZIER_NORMAL_NUDGE 1e-3f
+
+/**
+ * @brief The largest angle, in degrees, between the normals of patches
+ * sharing a border for them to be averaged. Past it the border is a crease,
+ * such as where the teapot's handle meets its body, and each patch keeps its own
+*/
+#define BEZIER_CREASE_ANGLE 30.0f
+
+/**
+ * @brief Computes the cubic Bernstein polynomials and their derivatives at t
+ *
+ * These are the rows of (t^3 t^2 t 1) M and (3t^2 2t 1 0) M, so the patch is
+ * B(u) P B(v)^T, with M folded into the basis instead of the geometry matrix.
+*/
+static void bernstein(float t, float basis[4], float derivative[4]) {
+  float s = 1 - t;
+  basis[0] = s * s * s;
+  basis[1] = 3 * t * s * s;
+  basis[2] = 3 * t * t * s;
+  basis[3] = t * t * t;
+  derivative[0] = -3 * s * s;
+  derivative[1] = 3 * s * s - 6 * t * s;
+  derivative[2] = 6 * t * s - 3 * t * t;
+  derivative[3] = 3 * t * t;
+}
+
+/**
+ * @brief The position and the tangents of a point of a Bezier patch
+*/
+struct BezierSample {
+  Point position;
+  Vector du, dv;
+};
+
+/**
+ * @brief Evaluates a Bezier patch at the point whose u and v basis are given
+ *
+ * @param p  the control points of the patch, row-major (a row per u)
+ * @param bu the basis and its derivative at u
+ * @param bv the basis and its derivative at v
+*/
+static BezierSample evaluateBezier(const Point p[16], const float bu[2][4], const float bv[2][4]) {
+  BezierSample sample = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+  for (int r = 0; r < 4; r++) {
+    Point row = bv[0][0] * p[4 * r] + bv[0][1] * p[4 * r + 1] + bv[0][2] * p[4 * r + 2] + bv[0][3] * p[4 * r + 3];
+    Vector rowDv = bv[1][0] * p[4 * r] + bv[1][1] * p[4 * r + 1] + bv[1][2] * p[4 * r + 2] + bv[1][3] * p[4 * r + 3];
+    sample.position += bu[0][r] * row;
+    sample.du += bu[1][r] * row;
+    sample.dv += bu[0][r] * rowDv;
+  }
+  return sample;
+}
+
+/**
+ * @brief Returns the normal of a sample of a Bezier patch, facing the way the
+ * triangles of #tessellateBezierPatch do, or a null vector if it has none
+*/
+static Vector bezierNormal(const BezierSample& sample) {
+  Vector n = sample.dv ^ sample.du;
+  float l = length(n);
+  return l > 0 ? n / l : Vector(0, 0, 0);
+}
 
-  u,v range from [0,1]. We will divide this range in `divisions`. E.g. if divisions = 4
-  we will compute the patch for u,v in {0, 0.25, 0.5, 0.75, 1}
+/**
+ * @brief Tessellates a Bezier patch in a grid of divisions x divisions samples
+ *
+ * @param p         the control points of the patch, row-major
+ * @param basis     the basis (and its derivative) of each of the divisions
+ * samples of u and of v, as computed by #bernstein
+ * @param divisions the number of samples along u and v
+ * @param points    where the position of sample (j, k) is stored, at j * divisions + k
+ * @param normals   where the normal of sample (j, k) is stored
+*/
+static void tessellateBezierPatch(const Point p[16], const std::vector<std::array<float[4], 2>>& basis,
+                                  int divisions, Point* points, Vector* normals) {
+  for (int j = 0; j < divisions; j++) {
+    for (int k = 0; k < divisions; k++) {
+      BezierSample sample = evaluateBezier(p, basis[j].data(), basis[k].data());
+      points[j * divisions + k] = sample.position;
+      normals[j * divisions + k] = bezierNormal(sample);
+      if (normals[j * divisions + k] != Vector(0, 0, 0))
+        continue;
+
+      //the tangents vanish where the patch collapses to a point or a curve:
+      //take the normal of a point just inside the patch instead
+      float t = (float) 1 / (divisions - 1), nudged[2][2][4];
+      bernstein(std::clamp(j * t, BEZIER_NORMAL_NUDGE, 1 - BEZIER_NORMAL_NUDGE), nudged[0][0], nudged[0][1]);
+      bernstein(std::clamp(k * t, BEZIER_NORMAL_NUDGE, 1 - BEZIER_NORMAL_NUDGE), nudged[1][0], nudged[1][1]);
+      normals[j * divisions + k] = bezierNormal(evaluateBezier(p, nudged[0], nudged[1]));
+    }
+  }
+}
 
-  */
-  float m[16] = {
-    -1.0f, 3.0f, -3.0f, 1.0f,
-    3.0f, -6.0f, 3.0f, 0.0f,
-    -3.0f, 3.0f, 0.0f, 0.0f,
-    1.0f, 0.0f, 0.0f, 0.0f
+/**
+ * @brief Identifies a sample on the border of a Bezier patch by the control
+ * points it depends on, so the patches sharing the border find the same one
+ *
+ * A sample on an edge is identified by the indices of the 4 control points
+ * of the edge, in the order smaller of the two, and its position along them.
+ * A corner, or any sample of an edge whose control points are all the same,
+ * is identified by its control point alone.
+*/
+typedef std::array<int, 5> BezierBorderKey;
+
+/**
+ * @brief Returns the key of the sample at position s (of divisions) along a
+ * border of a patch with the control points given
+*/
+static BezierBorderKey bezierBorderKey(std::array<int, 4> edge, int s, int divisions) {
+  if (s == 0 || (edge[0] == edge[1] && edge[1] == edge[2] && edge[2] == edge[3]))
+    return { edge[0], edge[0], edge[0], edge[0], 0 };
+  if (s == divisions - 1)
+    return { edge[3], edge[3], edge[3], edge[3], 0 };
+
+  std::array<int, 4> reversed = { edge[3], edge[2], edge[1], edge[0] };
+  if (reversed < edge)
+    return { reversed[0], reversed[1], reversed[2], reversed[3], divisions - 1 - s };
+  return { edge[0], edge[1], edge[2], edge[3], s };
+}
+
+std::unique_ptr<Shape> tessellateBezierPatches(const std::vector<Point>& controlPoints,
+                                               const std::vector<int[16]>& patches, int divisions, JobSystem* jobs) {
+  if (divisions < 2)
+    throw std::invalid_argument("A patch needs at least 2 divisions");
+
+  //the basis of each sample is the same for every patch, and for u and v
+  std::vector<std::array<float[4], 2>> basis(divisions);
+  for (int i = 0; i < divisions; i++)
+    bernstein((float) i / (divisions - 1), basis[i][0], basis[i][1]);
+
+  size_t samples = (size_t) divisions * divisions;
+  std::vector<Point> patchPoints(patches.size() * samples);
+  std::vector<Vector> patchNormals(patches.size() * samples);
+
+  JobBody tessellate = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      Point p[16];
+      for (int l = 0; l < 16; l++)
+        p[l] = controlPoints.at(patches[i][l]);
+      tessellateBezierPatch(p, basis, divisions, &patchPoints[i * samples], &patchNormals[i * samples]);
+    }
   };
-  
-  Point* points = new Point[divisions * divisions];
-  Vector* normalArr = new Vector[divisions * divisions];
+  if (jobs != nullptr)
+    jobs->parallelFor(patches.size(), 1, tessellate);
+  else
+    tessellate(0, patches.size());
+
+  //give every sample a position, shared by the samples of the borders the
+  //patches share. The normals of the patches at a position are summed in
+  //smoothing groups of the ones within BEZIER_CREASE_ANGLE of each other,
+  //linked from the last added
+  std::vector<int> samplePositions(patchPoints.size()), sampleGroups(patchPoints.size());
+  std::vector<Point> positions;
+  std::vector<int> lastGroup, previousGroup;
+  std::vector<Vector> normalSums;
+  std::map<BezierBorderKey, int> borders;
+  float crease = cos(BEZIER_CREASE_ANGLE * M_PI / 180);
+
+  for (size_t i = 0; i < patches.size(); i++) {
+    const int* c = patches[i];
+    std::array<int, 4> edges[4] = {
+      { c[0], c[1], c[2], c[3] },    //j = 0
+      { c[12], c[13], c[14], c[15] }, //j = divisions - 1
+      { c[0], c[4], c[8], c[12] },    //k = 0
+      { c[3], c[7], c[11], c[15] },   //k = divisions - 1
+    };
 
-  for(int* patch : patches) {
-    //Compute the matrix that depends on the control points. The matrix is 
-    //stored row-major
-    Point p[16];
-    for(int l = 0; l < 16; l++)
-      p[l] = controlPoints[patch[l]];
-
-    for(int j = 0; j < divisions; j++) {
-      for(int k = 0; k < divisions; k++) {
-        /*
-        We need to create the vectors dependent of u and v. We need to normalize
-        the indices of our loops j and k, and we do that by dividing by (divisions - 1)
-        as j and k range from 0 to (divisions - 1).
-
-        So u = j / (divisions - 1) and v = k / (divisions - 1)
-
-        To calculate powers of u and v, note that u^n = (j / (divisions - 1))^n 
-        = (j^n) / (divisions - 1)^n. The same for v
-
-        That is why we are computing d2 and d3 and using them in the vectors
-        */
-        float d2 = (float)(divisions - 1)*(divisions - 1); //(divisions - 1)^2
-        float d3 = (float)(divisions - 1)*d2; //(divisions - 1)^3
-        float u[4] = {(float)(j*j*j) / d3, (float)(j*j) / d2, (float)j / (divisions - 1), 1};
-        float du[4] = {3.0f * (float)(j*j) / d2, 2.0f * (float)j / (divisions - 1), 1.0f, 0.0f};
-        float v[4] = {(float)(k*k*k) / d3, (float)(k*k) / d2, (float)k / (divisions - 1), 1};
-        float dv[4] = {3.0f * (float)(k*k) / d2, 2.0f * (float)k / (divisions - 1), 1.0f, 0.0f};
-        
-        /*
-         Matrix multiplications: Coordinates
-        */
-        float temp1[4];
-        Point temp2[16];
-        Point temp3[16];
-        matrixProd(1,4, 4, m, v, temp1);
-        matrixProd(1,4, 4, p, temp1, temp2);
-        matrixProd(1,4, 4, m, temp2, temp3);
-        //Compute the result and store it in (j,k) position of the matrix
-        matrixProd(1, 1, 4, u, temp3, &points[j * divisions + k]);
-
-         /*
-         Matrix multiplications: Normals
-        */
-        //du
-        Vector du_vector;
-        matrixProd(1,4, 4, m, v, temp1);
-        matrixProd(1,4, 4, p, temp1, temp2);
-        matrixProd(1,4, 4, m, temp2, temp3);
-        //Compute the result and store it in (j,k) position of the matrix
-        matrixProd(1, 1, 4, du, temp3, &du_vector);
-        //dv
-        Vector dv_vector;
-        matrixProd(1, 4, 4, m, dv, temp1);
-        matrixProd(1, 4, 4, p, temp1, temp2);
-        matrixProd(1, 4, 4, m, temp2, temp3);
-        //Compute the result and store it in (j,k) position of the matrix
-        matrixProd(1, 1, 4, u, temp3, &dv_vector);
-
-        Vector temp = dv_vector ^ du_vector;
-        if(length(temp) == 0)
-          temp = {0.0f, 1.0f, 0.0f};
+    for (int j = 0; j < divisions; j++) {
+      for (int k = 0; k < divisions; k++) {
+        size_t sample = i * samples + j * divisions + k;
+        int position = positions.size();
+
+        bool border = true;
+        BezierBorderKey key;
+        if (j == 0 || j == divisions - 1)
+          key = bezierBorderKey(edges[j == 0 ? 0 : 1], k, divisions);
+        else if (k == 0 || k == divisions - 1)
+          key = bezierBorderKey(edges[k == 0 ? 2 : 3], j, divisions);
         else
-          temp = normalize(temp);
-        normalArr[j * divisions + k] = temp;
+          border = false;
+
+        if (border)
+          position = borders.emplace(key, position).first->second;
+        if (position == (int) positions.size()) {
+          positions.push_back(patchPoints[sample]);
+          lastGroup.push_back(-1);
+        }
+
+        //a null normal (of a degenerate patch) agrees with any
+        const Vector& normal = patchNormals[sample];
+        int group = lastGroup[position];
+        while (group >= 0 && normal != Vector(0, 0, 0)
+               && normalSums[group] * normal <= crease * length(normalSums[group]))
+          group = previousGroup[group];
+
+        if (group < 0) {
+          group = normalSums.size();
+          previousGroup.push_back(lastGroup[position]);
+          lastGroup[position] = group;
+          normalSums.push_back({ 0, 0, 0 });
+        }
+
+        samplePositions[sample] = position;
+        sampleGroups[sample] = group;
+        normalSums[group] += normal;
+      }
+    }
+  }
+
+  //the vertices of a smoothing group are shared by the samples with the
+  //same texture coordinates, and linked from the last added
+  std::vector<Point> points;
+  std::vector<Vector> normals;
+  std::vector<Point2D> textures;
+  std::vector<TriangleByPosition> triangles;
+  std::vector<int> lastVertex(normalSums.size(), -1), previousVertex;
+  std::vector<int> vertices(samples);
+
+  for (size_t i = 0; i < patches.size(); i++) {
+    for (int j = 0; j < divisions; j++) {
+      for (int k = 0; k < divisions; k++) {
+        int group = sampleGroups[i * samples + j * divisions + k];
+        Point2D texture = { (float) j / (divisions - 1), (float) k / (divisions - 1) };
+
+        int& vertex = vertices[j * divisions + k];
+        vertex = lastVertex[group];
+        while (vertex >= 0 && textures[vertex] != texture)
+          vertex = previousVertex[vertex];
+
+        if (vertex < 0) {
+          vertex = points.size();
+          previousVertex.push_back(lastVertex[group]);
+          lastVertex[group] = vertex;
+          points.push_back(positions[samplePositions[i * samples + j * divisions + k]]);
+          normals.push_back(length(normalSums[group]) > 0 ? normalize(normalSums[group]) : Vector(0, 1, 0));
+          textures.push_back(texture);
+        }
       }
     }
 
     /*
-    
-    Now with all points computed, we unite them in squares like so:
-    
+
+    The samples are joined in squares like so:
+
     p[0][0] ------ p[0][1] ----- p[0][2]
     |                 |             |
     p[1][0] ------ p[1][1] ----- p[1][2]
 
     */
-    for(int j = 0; j < divisions - 1; j++) {
-      for(int k = 0; k < divisions - 1; k++) {
-        Point p1 = points[(j + 1) * divisions + k];
-        Point p2 = points[j * divisions + k];
-        Point p3 = points[j * divisions + k + 1];
-        Point p4 = points[(j + 1) * divisions + k + 1];
-
-        triangles.push_back({p1, p2, p3});
-        triangles.push_back({p1, p3, p4});
-
-        textures.push_back({(float)(j + 1) / (divisions - 1), (float)k / (divisions - 1)});
-        textures.push_back({(float)j / (divisions - 1), (float)k / (divisions - 1)});
-        textures.push_back({(float)j / (divisions - 1), (float)(k + 1) / (divisions - 1)});
-        textures.push_back({(float)(j + 1) / (divisions - 1), (float)k / (divisions - 1)});
-        textures.push_back({(float)j / (divisions - 1), (float)(k + 1) / (divisions - 1)});
-        textures.push_back({(float)(j + 1) / (divisions - 1), (float)(k + 1) / (divisions - 1)});
-
-        normals.push_back(normalArr[(j + 1) * divisions + k]);
-        normals.push_back(normalArr[j * divisions + k]);
-        normals.push_back(normalArr[j * divisions + k + 1]);
-        normals.push_back(normalArr[(j + 1) * divisions + k]);
-        normals.push_back(normalArr[j * divisions + k + 1]);
-        normals.push_back(normalArr[(j + 1) * divisions + k + 1]);
+    const int* position = &samplePositions[i * samples];
+    auto addTriangle = [&](int a, int b, int c) {
+      //the triangles on a collapsed border have two corners in the same place
+      if (position[a] != position[b] && position[b] != position[c] && position[c] != position[a])
+        triangles.push_back({ vertices[a], vertices[b], vertices[c] });
+    };
+
+    for (int j = 0; j < divisions - 1; j++) {
+      for (int k = 0; k < divisions - 1; k++) {
+        int p1 = (j + 1) * divisions + k;
+        int p2 = j * divisions + k;
+        int p3 = j * divisions + k + 1;
+        int p4 = (j + 1) * divisions + k + 1;
+
+        addTriangle(p1, p2, p3);
+        addTriangle(p1, p3, p4);
       }
     }
   }
 
-  delete[] points;
-  delete[] normalArr;
+  return std::make_unique<Shape>(std::move(points), std::move(normals), std::move(textures), std::move(triangles));
 }
 
-std::unique_ptr<Shape> generateBezierPatches(std::string inputFile, int divisions) {
-  auto controlPoints = std::vector<Point>();
-  auto patches = std::vector<int[16]>();
-  auto triangles = std::vector<Triangle>();
-  auto normals = std::vector<Vector>();
-  auto textures = std::vector<Point2D>();
+float bezierTessellationError(const std::vector<Point>& controlPoints, const std::vector<int[16]>& patches,
+                              int divisions) {
+  if (divisions < 2)
+    throw std::invalid_argument("A patch needs at least 2 divisions");
 
-  readBezierPatchFile(inputFile, controlPoints, patches);
-  generateBezierTriangles(controlPoints, patches, divisions, triangles, normals, textures);
-  
+  //the patches are sampled twice as finely as they are tessellated, so the
+  //odd samples fall halfway along the edges and diagonals of the triangles
+  int fine = 2 * divisions - 1;
+  std::vector<std::array<float[4], 2>> basis(fine);
+  for (int i = 0; i < fine; i++)
+    bernstein((float) i / (fine - 1), basis[i][0], basis[i][1]);
+
+  float error = 0;
+  std::vector<Point> samples(fine * fine);
+  auto sample = [&](int j, int k) { return samples[j * fine + k]; };
 
-  return std::make_unique<Shape>(triangles, normals, textures);
-}
\ No newline at end of file
+  for (const int* c : patches) {
+    Point p[16];
+    for (int l = 0; l < 16; l++)
+      p[l] = controlPoints.at(c[l]);
+    for (int j = 0; j < fine; j++)
+      for (int k = 0; k < fine; k++)
+        samples[j * fine + k] = evaluateBezier(p, basis[j].data(), basis[k].data()).position;
+
+    //each cell is split along the diagonal from (j + 1, k) to (j, k + 1)
+    for (int j = 1; j < fine; j += 2) {
+      for (int k = 0; k < fine; k++) {
+        Point middle = k % 2 == 1 ? 0.5f * (sample(j + 1, k - 1) + sample(j - 1, k + 1))
+                                  : 0.5f * (sample(j - 1, k) + sample(j + 1, k));
+        error = std::max(error, length(sample(j, k) - middle));
+      }
+    }
+    for (int j = 0; j < fine; j += 2)
+      for (int k = 1; k < fine; k += 2)
+        error = std::max(error, length(sample(j, k) - 0.5f * (sample(j, k - 1) + sample(j, k + 1))));
+  }
+
+  return error;
+}
+
+std::unique_ptr<Shape> generateBezierPatches(std::string inputFile, int divisions, JobSystem* jobs) {
+  std::vector<Point> controlPoints;
+  std::vector<int[16]> patches;
+  readBezierPatchFile(inputFile, controlPoints, patches);
+  return tessellateBezierPatches(controlPoints, patches, divisions, jobs);
+}
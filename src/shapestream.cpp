@@ -0,0 +1,157 @@
+/**
+ * @file shapestream.cpp
+ *
+ * @brief File implementing the generation of shapes streamed straight to a
+ * binary 3D file
+ */
+
+#include "shapestream.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+/**
+ * @brief Returns the number of triangles of the rows of cells of a surface
+ * before a row
+*/
+static uint64_t trianglesBefore(const GridSurface& surface, int row) {
+  uint64_t triangles = (uint64_t) row * 2 * surface.columns;
+  if (surface.collapsedFirst && row > 0)
+    triangles -= surface.columns;
+  if (surface.collapsedLast && row == surface.rows)
+    triangles -= surface.columns;
+  return triangles;
+}
+
+/**
+ * @brief Rounds the given offset up to the alignment of the sections of a binary 3D file
+*/
+static uint64_t alignSection(uint64_t offset) {
+  return (offset + 15) & ~(uint64_t)15;
+}
+
+/**
+ * @brief Some consecutive rows of vertices of a surface, and the rows of
+ * cells below them, generated and written by a job
+*/
+struct StreamChunk {
+  size_t surface;   ///< The index of the surface
+  int first, last;  ///< The rows of vertices [first, last)
+};
+
+bool streamSurfaces(const std::vector<GridSurface>& surfaces, const std::string& filePath, JobSystem& jobs) {
+  //the first vertex and triangle of each surface, and the chunks of its rows
+  std::vector<uint64_t> vertexBase, triangleBase;
+  std::vector<StreamChunk> chunks;
+  uint64_t vertexCount = 0, triangleCount = 0;
+
+  for (size_t s = 0; s < surfaces.size(); s++) {
+    const GridSurface& surface = surfaces[s];
+    if (surface.columns < 1 || surface.rows < 1)
+      throw std::invalid_argument("The number of slices, stacks and divisions must be positive");
+
+    vertexBase.push_back(vertexCount);
+    triangleBase.push_back(triangleCount);
+    vertexCount += (uint64_t) (surface.columns + 1) * (surface.rows + 1);
+    triangleCount += trianglesBefore(surface, surface.rows);
+
+    int rowsPerChunk = std::max(1, STREAM_CHUNK_VERTICES / (surface.columns + 1));
+    for (int row = 0; row <= surface.rows; row += rowsPerChunk)
+      chunks.push_back({ s, row, std::min(row + rowsPerChunk, surface.rows + 1) });
+  }
+
+  if (vertexCount > std::numeric_limits<uint32_t>::max() || triangleCount > std::numeric_limits<uint32_t>::max())
+    throw std::invalid_argument("The shape has too many vertices or triangles for the binary format");
+
+  ShapeFileHeader header = {};
+  memcpy(header.magic, SHAPE_FILE_MAGIC, sizeof(header.magic));
+  header.version = SHAPE_FILE_VERSION;
+  header.vertexCount = vertexCount;
+  header.triangleCount = triangleCount;
+  header.pointsOffset = alignSection(sizeof(header));
+  header.normalsOffset = alignSection(header.pointsOffset + vertexCount * 3 * sizeof(float));
+  header.texturesOffset = alignSection(header.normalsOffset + vertexCount * 3 * sizeof(float));
+  header.trianglesOffset = alignSection(header.texturesOffset + vertexCount * 2 * sizeof(float));
+
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  if (!file)
+    return false;
+
+  //the chunks are written as they finish, in any order. Seeking past the end
+  //of the file leaves zeros behind, which pad the sections
+  std::mutex mutex;
+  Point min = { INFINITY, INFINITY, INFINITY }, max = -min;
+  auto write = [&](uint64_t offset, const void* data, size_t bytes) {
+    file.seekp(offset);
+    file.write((const char*) data, bytes);
+  };
+
+  jobs.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+    std::vector<float> points, normals, textures;
+    std::vector<uint32_t> triangles;
+
+    for (size_t c = begin; c < end; c++) {
+      const StreamChunk& chunk = chunks[c];
+      const GridSurface& surface = surfaces[chunk.surface];
+      uint32_t width = surface.columns + 1;
+      points.clear();
+      normals.clear();
+      textures.clear();
+      triangles.clear();
+
+      Point chunkMin = { INFINITY, INFINITY, INFINITY }, chunkMax = -chunkMin;
+      for (int row = chunk.first; row < chunk.last; row++) {
+        for (int column = 0; column <= surface.columns; column++) {
+          Vertex v = surface.vertex(column, row);
+          points.insert(points.end(), v.position, v.position + 3);
+          normals.insert(normals.end(), v.normal, v.normal + 3);
+          textures.insert(textures.end(), v.texture, v.texture + 2);
+          for (int i = 0; i < 3; i++) {
+            chunkMin[i] = std::min(chunkMin[i], v.position[i]);
+            chunkMax[i] = std::max(chunkMax[i], v.position[i]);
+          }
+        }
+      }
+
+      //the cells between each row of the chunk and the next, the last row of
+      //vertices having none
+      for (int row = chunk.first; row < std::min(chunk.last, surface.rows); row++) {
+        for (int column = 0; column < surface.columns; column++) {
+          uint32_t a = vertexBase[chunk.surface] + row * width + column, b = a + 1, c = a + width, d = c + 1;
+          if (!(surface.collapsedLast && row == surface.rows - 1))
+            triangles.insert(triangles.end(), { a, c, d });
+          if (!(surface.collapsedFirst && row == 0))
+            triangles.insert(triangles.end(), { a, d, b });
+        }
+      }
+
+      uint64_t vertex = vertexBase[chunk.surface] + (uint64_t) chunk.first * width;
+      uint64_t triangle = triangleBase[chunk.surface] + trianglesBefore(surface, chunk.first);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      write(header.pointsOffset + vertex * 3 * sizeof(float), points.data(), points.size() * sizeof(float));
+      write(header.normalsOffset + vertex * 3 * sizeof(float), normals.data(), normals.size() * sizeof(float));
+      write(header.texturesOffset + vertex * 2 * sizeof(float), textures.data(), textures.size() * sizeof(float));
+      write(header.trianglesOffset + triangle * 3 * sizeof(uint32_t), triangles.data(),
+            triangles.size() * sizeof(uint32_t));
+
+      for (int i = 0; i < 3; i++) {
+        min[i] = std::min(min[i], chunkMin[i]);
+        max[i] = std::max(max[i], chunkMax[i]);
+      }
+    }
+  });
+
+  for (int i = 0; i < 3; i++) {
+    header.aabbMin[i] = min[i];
+    header.aabbMax[i] = max[i];
+  }
+  write(0, &header, sizeof(header));
+
+  file.close();
+  return !file.fail();
+}
@@ -0,0 +1,319 @@
+/**
+ * @file simplifier.cpp
+ *
+ * @brief File implementing the quadric error simplification of indexed meshes
+ */
+
+#include "simplifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+Quadric Quadric::fromTriangle(const Point& p0, const Point& p1, const Point& p2) {
+  Vector n = (p1 - p0) ^ (p2 - p0);
+  float l = length(n);
+
+  Quadric q;
+  if (l == 0)
+    return q;
+
+  //the plane a*x + b*y + c*z + d = 0, weighted by the area of the triangle
+  double a = n.x / l, b = n.y / l, c = n.z / l;
+  double d = -(a * p0.x + b * p0.y + c * p0.z);
+  double w = l / 2;
+
+  q.a2 = w * a * a; q.ab = w * a * b; q.ac = w * a * c; q.ad = w * a * d;
+  q.b2 = w * b * b; q.bc = w * b * c; q.bd = w * b * d;
+  q.c2 = w * c * c; q.cd = w * c * d;
+  q.d2 = w * d * d;
+  q.area = w;
+  return q;
+}
+
+Quadric& Quadric::operator +=(const Quadric& q) {
+  a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+  b2 += q.b2; bc += q.bc; bd += q.bd;
+  c2 += q.c2; cd += q.cd;
+  d2 += q.d2;
+  area += q.area;
+  return *this;
+}
+
+float Quadric::error(const Point& p) const {
+  if (area == 0)
+    return 0;
+
+  double x = p.x, y = p.y, z = p.z;
+  double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+           + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+           + c2 * z * z + 2 * cd * z
+           + d2;
+
+  return (float)std::max(e / area, 0.0);
+}
+
+Simplifier::Simplifier(const std::vector<int>& indices, const std::vector<Point>& points) :
+  points(points),
+  current(indices),
+  position(points.size()),
+  locked(points.size(), false),
+  quadrics(points.size()),
+  normals(points.size())
+{
+  //the vertices at the same position (split by their other attributes) are
+  //found by sorting them by position
+  std::vector<int> order(points.size());
+  for (size_t v = 0; v < order.size(); v++)
+    order[v] = v;
+  std::sort(order.begin(), order.end(), [&points](int a, int b) {
+    return points[a] < points[b] || (points[a] == points[b] && a < b);
+  });
+
+  for (size_t i = 0; i < order.size();) {
+    size_t j = i + 1;
+    while (j < order.size() && points[order[j]] == points[order[i]])
+      j++;
+
+    for (size_t k = i; k < j; k++)
+      position[order[k]] = order[i];
+
+    //a seam can't move without tearing the attributes on one of its sides
+    if (j - i > 1)
+      locked[order[i]] = true;
+
+    i = j;
+  }
+
+  //every edge (between positions) must be shared by exactly two triangles, or
+  //it is on the border or non-manifold
+  std::vector<uint64_t> edges;
+  edges.reserve(current.size());
+  for (size_t t = 0; t + 2 < current.size(); t += 3) {
+    for (int k = 0; k < 3; k++) {
+      uint64_t a = position[current[t + k]], b = position[current[t + (k + 1) % 3]];
+      edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+
+  for (size_t i = 0; i < edges.size();) {
+    size_t j = i + 1;
+    while (j < edges.size() && edges[j] == edges[i])
+      j++;
+
+    if (j - i != 2) {
+      locked[edges[i] >> 32] = true;
+      locked[edges[i] & 0xffffffff] = true;
+    }
+
+    i = j;
+  }
+
+  for (size_t t = 0; t + 2 < current.size(); t += 3) {
+    const Point& p0 = points[current[t]];
+    const Point& p1 = points[current[t + 1]];
+    const Point& p2 = points[current[t + 2]];
+    Quadric q = Quadric::fromTriangle(p0, p1, p2);
+    Vector n = (p1 - p0) ^ (p2 - p0);
+
+    for (int k = 0; k < 3; k++) {
+      quadrics[position[current[t + k]]] += q;
+      normals[position[current[t + k]]] += n;
+    }
+  }
+}
+
+size_t Simplifier::simplify(size_t targetTriangles, float maxError) {
+  float maxErrorSq = maxError * maxError;
+
+  while (current.size() / 3 > targetTriangles) {
+    //each collapse of an edge inside the mesh removes two triangles
+    size_t goal = (current.size() / 3 - targetTriangles + 1) / 2;
+    if (collapsePass(goal, maxErrorSq) == 0)
+      break;
+  }
+
+  return current.size() / 3;
+}
+
+const std::vector<int>& Simplifier::indices() const {
+  return current;
+}
+
+float Simplifier::error() const {
+  return std::sqrt(errorSq);
+}
+
+/**
+ * @brief A candidate collapse, of the vertex at a position onto another
+*/
+struct Collapse {
+  float error;
+  int from, to;
+};
+
+size_t Simplifier::collapsePass(size_t goal, float maxErrorSq) {
+  size_t vertexCount = points.size();
+
+  //the triangles around each position
+  std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+  for (int i : current)
+    adjacencyStart[position[i] + 1]++;
+  for (size_t v = 0; v < vertexCount; v++)
+    adjacencyStart[v + 1] += adjacencyStart[v];
+
+  std::vector<int> adjacency(current.size());
+  std::vector<size_t> filled(adjacencyStart.begin(), adjacencyStart.end() - 1);
+  for (size_t i = 0; i < current.size(); i++)
+    adjacency[filled[position[current[i]]]++] = i / 3;
+
+  //each edge inside the mesh is seen from both of its triangles, so only the
+  //one where it goes to the higher position is kept, in its cheapest direction
+  std::vector<Collapse> collapses;
+  for (size_t i = 0; i < current.size(); i++) {
+    int a = position[current[i]];
+    int b = position[current[i % 3 == 2 ? i - 2 : i + 1]];
+    if (a >= b || (locked[a] && locked[b]))
+      continue;
+
+    float ab = locked[a] ? INFINITY : quadrics[a].error(points[b]);
+    float ba = locked[b] ? INFINITY : quadrics[b].error(points[a]);
+    collapses.push_back(ab <= ba ? Collapse{ ab, a, b } : Collapse{ ba, b, a });
+  }
+
+  std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+    return a.error < b.error || (a.error == b.error && a.from < b.from);
+  });
+
+  //not much more error than what reaching the goal would take in the best case,
+  //or than the cheapest collapse that can be done, if none within that can
+  float limit = maxErrorSq;
+  if (goal < collapses.size())
+    limit = std::min(limit, 1.5f * collapses[goal].error);
+
+  //a collapse changes the triangles around its vertex, so other collapses of
+  //the pass can't involve any of them
+  std::vector<bool> touched(vertexCount, false);
+  std::vector<int> collapsedTo(vertexCount, -1);
+  size_t collapsed = 0;
+
+  for (const Collapse& c : collapses) {
+    if (collapsed == goal || c.error > maxErrorSq)
+      break;
+
+    if (c.error > limit) {
+      if (collapsed > 0)
+        break;
+      limit = std::min(maxErrorSq, 1.5f * c.error);
+    }
+
+    int vertex;
+    if (touched[c.from] || touched[c.to] || !canCollapse(c.from, c.to, adjacencyStart, adjacency, vertex))
+      continue;
+
+    for (size_t k = adjacencyStart[c.from]; k < adjacencyStart[c.from + 1]; k++)
+      for (int j = 0; j < 3; j++)
+        touched[position[current[3 * adjacency[k] + j]]] = true;
+
+    collapsedTo[c.from] = vertex;
+    quadrics[c.to] += quadrics[c.from];
+    normals[c.to] += normals[c.from];
+    errorSq = std::max(errorSq, c.error);
+    collapsed++;
+  }
+
+  //the vertex at a position that isn't locked is the only one there, so it can
+  //be replaced by the one it collapsed to. The triangles left with two corners
+  //at the same position are gone
+  std::vector<int> simplified;
+  simplified.reserve(current.size());
+  for (size_t t = 0; t + 2 < current.size(); t += 3) {
+    int v[3];
+    for (int k = 0; k < 3; k++) {
+      int p = position[current[t + k]];
+      v[k] = collapsedTo[p] >= 0 ? collapsedTo[p] : current[t + k];
+    }
+
+    if (position[v[0]] != position[v[1]] && position[v[1]] != position[v[2]] && position[v[2]] != position[v[0]])
+      simplified.insert(simplified.end(), { v[0], v[1], v[2] });
+  }
+
+  current.swap(simplified);
+  return collapsed;
+}
+
+bool Simplifier::canCollapse(int from, int to, const std::vector<size_t>& adjacencyStart,
+                             const std::vector<int>& adjacency, int& vertex) {
+  //returns the positions adjacent to v, sorted
+  auto neighboursOf = [&](int v, std::vector<int>& neighbours) {
+    neighbours.clear();
+    for (size_t k = adjacencyStart[v]; k < adjacencyStart[v + 1]; k++)
+      for (int j = 0; j < 3; j++)
+        if (position[current[3 * adjacency[k] + j]] != v)
+          neighbours.push_back(position[current[3 * adjacency[k] + j]]);
+
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+  };
+
+  //the positions adjacent to both must be the two opposite the edge, or the
+  //collapse would join two sheets of the mesh
+  neighboursOf(from, fromNeighbours);
+  neighboursOf(to, toNeighbours);
+
+  std::vector<int>::iterator a = fromNeighbours.begin(), b = toNeighbours.begin();
+  int shared = 0;
+  while (a != fromNeighbours.end() && b != toNeighbours.end()) {
+    if (*a < *b) {
+      a++;
+    } else if (*b < *a) {
+      b++;
+    } else {
+      shared++;
+      a++;
+      b++;
+    }
+  }
+
+  if (shared > 2)
+    return false;
+
+  //the triangles that move with the vertex must keep facing the same side,
+  //both locally and as the original triangles around their corners.
+  //The ones on the edge are removed, and must all use the same vertex at the
+  //position it collapses to, which is the one the others are attached to
+  vertex = -1;
+  for (size_t k = adjacencyStart[from]; k < adjacencyStart[from + 1]; k++) {
+    const int* t = &current[3 * adjacency[k]];
+    Point before[3], after[3];
+    bool removed = false;
+
+    for (int j = 0; j < 3; j++) {
+      int v = position[t[j]];
+      if (v == to) {
+        if (vertex >= 0 && vertex != t[j])
+          return false;
+        vertex = t[j];
+        removed = true;
+      }
+      before[j] = points[t[j]];
+      after[j] = v == from ? points[to] : before[j];
+    }
+
+    if (removed)
+      continue;
+
+    Vector n0 = (before[1] - before[0]) ^ (before[2] - before[0]);
+    Vector n1 = (after[1] - after[0]) ^ (after[2] - after[0]);
+    if (n0 * n1 <= 0.25f * length(n0) * length(n1))
+      return false;
+
+    for (int j = 0; j < 3; j++) {
+      int v = position[t[j]];
+      if (n1 * (v == from ? normals[from] + normals[to] : normals[v]) <= 0)
+        return false;
+    }
+  }
+
+  return true;
+}
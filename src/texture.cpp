@@ -50,11 +50,16 @@ Texture::Texture(std::string filePath) : texture(0) {
 	unsigned char* temp = ilGetData();
     data = new unsigned char[n];
     memcpy(data, temp, n);
+
+    translucent = false;
+    for (int i = 3; i < n && !translucent; i += 4)
+        translucent = data[i] != 255;
 }
 
 Texture::Texture(const Texture& texture) :
     width(texture.width),
     height(texture.height),
+    translucent(texture.translucent),
     texture(0)
 {
     int n = width * height * 4;
@@ -66,6 +71,7 @@ Texture::Texture(Texture&& texture) :
     width(texture.width),
     height(texture.height),
     data(texture.data),
+    translucent(texture.translucent),
     texture(texture.texture)
 {}
 
@@ -79,6 +85,7 @@ Texture::~Texture() {
 Texture& Texture::operator=(const Texture& texture) {
     this->width = texture.width;
     this->height = texture.height;
+    this->translucent = texture.translucent;
 
     delete[] data;
     int n = width * height * 4;
@@ -92,6 +99,7 @@ Texture& Texture::operator=(const Texture& texture) {
 Texture& Texture::operator=(Texture&& texture) {
     this->width = texture.width;
     this->height = texture.height;
+    this->translucent = texture.translucent;
     delete[] data;
     this->data = texture.data;
     this->texture = texture.texture;
@@ -116,9 +124,13 @@ void Texture::initialize() {
         throw std::runtime_error("Error creating mipmap: " + std::string((char*)gluErrorString(aux)));
 }
 
-void Texture::bind() {
+void Texture::bind() const {
     if (texture == 0)
         throw std::runtime_error("Attept to bind uninitialized texture");
 
     glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+bool Texture::isTranslucent() const {
+    return translucent;
 }
\ No newline at end of file
@@ -4,12 +4,33 @@
 #include "parser.hpp"
 #include "transformation.hpp"
 #include <iostream>
+#include <algorithm>
 #include <cmath>
 
 std::unique_ptr<Transformation> Transformation::parse(XMLParser parser) {
   return dynamicParser<Transformation,Translation,Rotation,Scale,CatmullRom>::parse(parser);
 }
 
+void Transformation::fold(std::vector<std::unique_ptr<Transformation>>& transformations) {
+  std::vector<std::unique_ptr<Transformation>> folded;
+
+  for (size_t i = 0; i < transformations.size();) {
+    if (transformations[i]->isAnimated()) {
+      folded.push_back(std::move(transformations[i++]));
+      continue;
+    }
+
+    //the run is applied to a stack of its own, as it would be to the modelview
+    MatrixStack run;
+    for (; i < transformations.size() && !transformations[i]->isAnimated(); i++)
+      transformations[i]->apply(run, 0);
+
+    folded.push_back(std::make_unique<MatrixTransformation>(run.top()));
+  }
+
+  transformations = std::move(folded);
+}
+
 
 bool Translation::accepts(XMLParser parser) {
   float x;
@@ -31,7 +52,13 @@ Transformation* Translation::clone() {
   return new Translation(*this);
 }
 
-void Translation::apply() { glTranslatef(this->x, this->y, this->z); }
+void Translation::apply(MatrixStack& modelview, float time) const { modelview.translate(this->x, this->y, this->z); }
+
+bool Translation::isAnimated() const { return false; }
+
+BoundingSphere Translation::bound(const BoundingSphere& sphere) const {
+  return BoundingSphere(sphere.center + Vector{ this->x, this->y, this->z }, sphere.radius);
+}
 
 
 bool Rotation::accepts(XMLParser parser) {
@@ -58,11 +85,26 @@ Transformation* Rotation::clone() {
   return new Rotation(*this);
 }
 
-void Rotation::apply() {
-  float t = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+void Rotation::apply(MatrixStack& modelview, float time) const {
   float w = this->time != 0 ? 360 / this->time : 0;
 
-  glRotatef(this->angle + t * w, this->x, this->y, this->z);
+  modelview.rotate(this->angle + time * w, this->x, this->y, this->z);
+}
+
+bool Rotation::isAnimated() const { return this->time != 0; }
+
+BoundingSphere Rotation::bound(const BoundingSphere& sphere) const {
+  Vector axis = { this->x, this->y, this->z };
+  if (sphere.empty() || axis == zero())
+    return sphere;
+
+  if (this->time == 0)
+    return BoundingSphere(rotate(axis, sphere.center, this->angle * M_PI / 180), sphere.radius);
+
+  //the center goes around a circle around the axis
+  axis = normalize(axis);
+  Point onAxis = axis * (sphere.center * axis);
+  return BoundingSphere(onAxis, length(sphere.center - onAxis) + sphere.radius);
 }
 
 
@@ -92,7 +134,30 @@ Transformation* Scale::clone() {
   return new Scale(*this);
 }
 
-void Scale::apply() { glScalef(this->x, this->y, this->z); }
+void Scale::apply(MatrixStack& modelview, float time) const { modelview.scale(this->x, this->y, this->z); }
+
+bool Scale::isAnimated() const { return false; }
+
+BoundingSphere Scale::bound(const BoundingSphere& sphere) const {
+  float scale = std::max({ std::abs(this->x), std::abs(this->y), std::abs(this->z) });
+  return BoundingSphere({ sphere.center.x * this->x, sphere.center.y * this->y, sphere.center.z * this->z },
+                        sphere.radius * scale);
+}
+
+
+MatrixTransformation::MatrixTransformation(const Mat4& matrix) : matrix(matrix) {}
+
+Transformation* MatrixTransformation::clone() {
+  return new MatrixTransformation(*this);
+}
+
+void MatrixTransformation::apply(MatrixStack& modelview, float time) const { modelview.multiply(this->matrix); }
+
+bool MatrixTransformation::isAnimated() const { return false; }
+
+BoundingSphere MatrixTransformation::bound(const BoundingSphere& sphere) const {
+  return sphere.transform(this->matrix);
+}
 
 
 bool CatmullRom::accepts(XMLParser parser) {
@@ -121,6 +186,27 @@ CatmullRom::CatmullRom(XMLParser parser) {
 
   for (XMLParser& n : nodes)
     this->points.push_back(n.as_tuple<float,float,float>({"x", "y", "z"}));
+
+  if (this->align)
+    computeUps();
+}
+
+void CatmullRom::computeUps() {
+  size_t samples = CATMULL_ROM_UP_SAMPLES * this->points.size();
+  Vector up = {0, 1, 0};
+
+  this->ups.clear();
+  for (size_t s = 0; s < samples; s++) {
+    this->ups.push_back(up);
+
+    Point pos;
+    Vector deriv;
+    getGlobalCatmullRomPoint(this->time * s / samples, pos, deriv);
+
+    deriv = normalize(deriv);
+    Vector z = normalize(deriv ^ up);
+    up = normalize(z ^ deriv);
+  }
 }
 
 Transformation* CatmullRom::clone() {
@@ -128,35 +214,68 @@ Transformation* CatmullRom::clone() {
 }
 
 
-void CatmullRom::apply()
+void CatmullRom::apply(MatrixStack& modelview, float time) const
 {
-  if (this->trace)
-    this->draw();
-
   Point pos;
   Vector deriv;
-	getGlobalCatmullRomPoint(glutGet(GLUT_ELAPSED_TIME) / 1000.0f, pos, deriv);
+	getGlobalCatmullRomPoint(time, pos, deriv);
 
-  glTranslatef(GET_ALL(pos));
+  modelview.translate(GET_ALL(pos));
 
   if (this->align) {
+    //the up vector of the sample before
+    float phase = time / this->time - floor(time / this->time);
+    size_t sample = std::min((size_t)(phase * this->ups.size()), this->ups.size() - 1);
+
     deriv = normalize(deriv);
-    Vector z = normalize(deriv ^ this->y_0);
+    Vector z = normalize(deriv ^ this->ups[sample]);
     Vector y = normalize(z ^ deriv);
 
-    float m[16] = {
-      GET_ALL(deriv), 0,
-      GET_ALL(y),     0,
-      GET_ALL(z),     0,
-      0, 0, 0,        1
-    };
+    //the frame's axes are the columns
+    modelview.multiply({
+      deriv.x, y.x, z.x, 0,
+      deriv.y, y.y, z.y, 0,
+      deriv.z, y.z, z.z, 0,
+      0,       0,   0,   1
+    });
+  }
+}
+
+bool CatmullRom::isAnimated() const { return true; }
+
+bool CatmullRom::hasTrace() const { return this->trace; }
 
-    glMultMatrixf(m);
-    this->y_0 = y;
+BoundingSphere CatmullRom::bound(const BoundingSphere& sphere) const {
+  //each segment is a cubic Bezier curve, which is inside the hull of its
+  //control points
+  std::vector<Point> hull;
+  size_t n = this->points.size();
+  for (size_t i = 0; i < n; i++) {
+    const Point& p0 = this->points[(i + n - 1) % n];
+    const Point& p1 = this->points[i];
+    const Point& p2 = this->points[(i + 1) % n];
+    const Point& p3 = this->points[(i + 2) % n];
+
+    hull.insert(hull.end(), { p1, p1 + (p2 - p0) / 6, p2 - (p3 - p1) / 6 });
   }
+  BoundingSphere curve = BoundingBox(hull).boundingSphere();
+
+  //aligned, the frame turns around its origin as it moves along the curve
+  BoundingSphere moving = sphere;
+  if (this->align && !sphere.empty())
+    moving = BoundingSphere(zero(), length(sphere.center) + sphere.radius);
+
+  BoundingSphere swept;
+  if (!moving.empty())
+    swept = BoundingSphere(curve.center + moving.center, curve.radius + moving.radius);
+
+  if (this->trace)
+    swept.merge(curve);
+
+  return swept;
 }
 
-void CatmullRom::draw() {
+void CatmullRom::draw() const {
   glColor3f(1.0f, 1.0f, 1.0f);
   glBegin(GL_LINE_LOOP);
 
@@ -173,31 +292,28 @@ void CatmullRom::draw() {
 
 void getCatmullRomPoint(float t, Point p0, Point p1, Point p2, Point p3, Point& pos, Vector& deriv) {
   // catmull-rom matrix
-	float M[16] = {	-0.5f,  1.5f,   -1.5f,  0.5f,
-						      1.0f,   -2.5f,  2.0f,   -0.5f,
-						      -0.5f,  0.0f,   0.5f,   0.0f,
-						      0.0f,   1.0f,   0.0f,   0.0f };
-
-  float P[16] = { GET_ALL(p0), 1,
-                  GET_ALL(p1), 1,
-                  GET_ALL(p2), 1,
-                  GET_ALL(p3), 1 };
+	static constexpr Mat4 M = {	-0.5f,  1.5f,   -1.5f,  0.5f,
+						                  1.0f,   -2.5f,  2.0f,   -0.5f,
+						                  -0.5f,  0.0f,   0.5f,   0.0f,
+						                  0.0f,   1.0f,   0.0f,   0.0f };
+
+  Mat4 P = { GET_ALL(p0), 1,
+             GET_ALL(p1), 1,
+             GET_ALL(p2), 1,
+             GET_ALL(p3), 1 };
 	
-	float T[4] = { t*t*t, t*t, t, 1 };
-	float dT[4] = { 3*t*t, 2*t, 1, 0 };
+	RowVec4 T = { t*t*t, t*t, t, 1 };
+	RowVec4 dT = { 3*t*t, 2*t, 1, 0 };
 
-  float A[16];
-  matrixProd(4, 4, 4, M, P, A);
+  Mat4 A = M * P;
 
-  float _pos[4], _deriv[4];
-  matrixProd(4, 1, 4, T, A, _pos);
-  matrixProd(4, 1, 4, dT, A, _deriv);
+  RowVec4 _pos = T * A, _deriv = dT * A;
 
-  pos = { _pos[0], _pos[1], _pos[2] };
-  deriv = { _deriv[0], _deriv[1], _deriv[2] };
+  pos = { _pos.values[0], _pos.values[1], _pos.values[2] };
+  deriv = { _deriv.values[0], _deriv.values[1], _deriv.values[2] };
 }
 
-void CatmullRom::getGlobalCatmullRomPoint(float gt, Point& pos, Vector& deriv) {
+void CatmullRom::getGlobalCatmullRomPoint(float gt, Point& pos, Vector& deriv) const {
   float t = gt / this->time * this->points.size(); // this is the real global t
 	int index = floor(t);  // which segment
 	t = t - index; // where within the segment
@@ -2,6 +2,7 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <string>
+#include <algorithm>
 
 Point average(std::initializer_list<Point> points) {
   /**
@@ -107,55 +108,146 @@ bool parseBool(std::string str) {
 }
 
 
-BoundingBox::BoundingBox() {}
+BoundingBox::BoundingBox() : center(zero()), extents{ -1, -1, -1 } {}
 
 BoundingBox::BoundingBox(const std::vector<Point>& points) {
   //Calculate as an AABB
   float minX, maxX, minY, maxY, minZ, maxZ;
-  minX = maxX = std::get<0>(points.at(0));
-  minY = maxY = std::get<1>(points.at(0));
-  minZ = maxZ = std::get<2>(points.at(0));
+  minX = maxX = points.at(0).x;
+  minY = maxY = points.at(0).y;
+  minZ = maxZ = points.at(0).z;
 
   for (unsigned int i = 1; i < points.size(); i++) {
-    float x = std::get<0>(points.at(i));
-    float y = std::get<1>(points.at(i));
-    float z = std::get<2>(points.at(i));
+    float x = points.at(i).x;
+    float y = points.at(i).y;
+    float z = points.at(i).z;
 
     if (x < minX) minX = x; else if (x > maxX) maxX = x;
     if (y < minY) minY = y; else if (y > maxY) maxY = y;
     if (z < minZ) minZ = z; else if (z > maxZ) maxZ = z;
   }
 
-  for (float x : { minX, maxX })
-    for (float y : { minY, maxY })
-      for (float z : { minZ, maxZ })
-        corners.push_back({ x, y, z });
+  center = { (minX + maxX) / 2, (minY + maxY) / 2, (minZ + maxZ) / 2 };
+  extents = { (maxX - minX) / 2, (maxY - minY) / 2, (maxZ - minZ) / 2 };
 }
 
-BoundingBox::BoundingBox(const BoundingBox& bb) :
-  corners(bb.corners)
-{}
+BoundingBox::BoundingBox(Point center, Vector extents) : center(center), extents(extents) {}
 
-BoundingBox& BoundingBox::operator =(const BoundingBox& bb) {
-  this->corners = bb.corners;
-  return *this;
+bool BoundingBox::empty() const {
+  return extents.x < 0;
 }
 
-void BoundingBox::transform(float modelview[16]) {
-  for (Point& p : corners) {
-    float input[4] = { GET_ALL(p), 1 }, output[4];
-    matrixProd(1, 4, 4, modelview, input, output);
+const Point& BoundingBox::getCenter() const {
+  return center;
+}
+
+const Vector& BoundingBox::getExtents() const {
+  return extents;
+}
+
+void BoundingBox::transform(const Mat4& modelview) {
+  if (empty())
+    return;
+
+  //each axis of the new box spans the images of the old extents along it
+  //(Arvo, "Transforming Axis-Aligned Bounding Boxes", 1990)
+  ColVec4 c = modelview * ColVec4{ GET_ALL(center), 1 };
+  Vector e;
+  for (int i = 0; i < 3; i++)
+    e[i] = fabs(modelview(i, 0)) * extents.x + fabs(modelview(i, 1)) * extents.y + fabs(modelview(i, 2)) * extents.z;
+
+  center = { c.values[0], c.values[1], c.values[2] };
+  extents = e;
+}
+
+bool BoundingBox::isForward(const Plane& plane) const {
+  if (empty())
+    return false;
+
+  //the corner furthest in front of the plane
+  Vector n = plane.normal;
+  return center * n + fabs(n.x) * extents.x + fabs(n.y) * extents.y + fabs(n.z) * extents.z >= plane.displacement;
+}
+
+float BoundingBox::distanceFrom(const Point& point) const {
+  if (empty())
+    return 0;
 
-    p = { output[0], output[1], output[2] };
+  Vector outside = zero();
+  for (int i = 0; i < 3; i++)
+    outside[i] = std::max(fabs(point[i] - center[i]) - extents[i], 0.0f);
+
+  return length(outside);
+}
+
+BoundingSphere BoundingBox::boundingSphere() const {
+  if (empty())
+    return BoundingSphere();
+
+  return BoundingSphere(center, length(extents));
+}
+
+
+float maxScale(const Mat4& m) {
+  Vector axes[3];
+  for (int j = 0; j < 3; j++)
+    axes[j] = { m(0, j), m(1, j), m(2, j) };
+
+  //the square of the scale is the largest eigenvalue of the products of the
+  //images of the axes, bounded by the largest sum of a row (Gershgorin). It's
+  //exact when the images are orthogonal, as in rotations and scales
+  float bound = 0;
+  for (int i = 0; i < 3; i++) {
+    float sum = 0;
+    for (int j = 0; j < 3; j++)
+      sum += fabs(axes[i] * axes[j]);
+    bound = std::max(bound, sum);
   }
+
+  return sqrt(bound);
 }
 
-bool BoundingBox::isForward(Plane plane) {
-  for (Point& p : corners)
-    if (p * plane.normal >= plane.displacement)
-      return true;
+BoundingSphere::BoundingSphere() : center(zero()), radius(-1) {}
+
+BoundingSphere::BoundingSphere(Point center, float radius) : center(center), radius(radius) {}
 
-  return false;
+bool BoundingSphere::empty() const {
+  return radius < 0;
+}
+
+void BoundingSphere::merge(const BoundingSphere& sphere) {
+  if (sphere.empty())
+    return;
+
+  if (empty()) {
+    *this = sphere;
+    return;
+  }
+
+  Vector d = sphere.center - center;
+  float distance = length(d);
+
+  //one of them already contains the other
+  if (distance + sphere.radius <= radius)
+    return;
+
+  if (distance + radius <= sphere.radius) {
+    *this = sphere;
+    return;
+  }
+
+  //the smallest sphere touching the far sides of both
+  float r = (distance + radius + sphere.radius) / 2;
+  center = center + d * ((r - radius) / distance);
+  radius = r;
+}
+
+BoundingSphere BoundingSphere::transform(const Mat4& modelview) const {
+  if (empty())
+    return *this;
+
+  ColVec4 c = modelview * ColVec4{ GET_ALL(center), 1 };
+  return BoundingSphere({ c.values[0], c.values[1], c.values[2] }, radius * maxScale(modelview));
 }
 
 
@@ -166,9 +258,6 @@ Frustum::Frustum(Point position, Vector lookAtVector, Vector up, float near, flo
   Point centerNear = position + lookAtVector * near;
   Point centerFar = position + lookAtVector * far;
 
-  this->near = Plane(centerNear, lookAtVector);
-  this->far = Plane(centerFar, -lookAtVector);
-
   float halfHeightNear = near * tan(fov * M_PI / 360);
   float halfWidthNear = halfHeightNear * ratio;
 
@@ -178,16 +267,43 @@ Frustum::Frustum(Point position, Vector lookAtVector, Vector up, float near, flo
   Point downLeftNear = centerNear - up * halfHeightNear - right * halfWidthNear;
   Vector downLeftOut = downLeftNear - position;
   
-  this->up = Plane(upRightNear, normalize(upRightOut ^ right));
-  this->down = Plane(downLeftNear, normalize(right ^ downLeftOut));
-  this->left = Plane(downLeftNear, normalize(downLeftOut ^ up));
-  this->right = Plane(upRightNear, normalize(up ^ upRightOut));
+  Plane planes[FRUSTUM_PLANES] = {
+    Plane(upRightNear, normalize(upRightOut ^ right)),
+    Plane(downLeftNear, normalize(right ^ downLeftOut)),
+    Plane(downLeftNear, normalize(downLeftOut ^ up)),
+    Plane(upRightNear, normalize(up ^ upRightOut)),
+    Plane(centerNear, lookAtVector),
+    Plane(centerFar, -lookAtVector)
+  };
+
+  for (int i = 0; i < FRUSTUM_PLANES; i++) {
+    this->planes.x[i] = planes[i].normal.x;
+    this->planes.y[i] = planes[i].normal.y;
+    this->planes.z[i] = planes[i].normal.z;
+    this->planes.d[i] = planes[i].displacement;
+  }
+}
+
+bool Frustum::contains(const BoundingBox& boundingBox) const {
+  if (boundingBox.empty())
+    return false;
+
+  const Vector& extents = boundingBox.getExtents();
+  return boxInFrustum(planes, boundingBox.getCenter(), extents, length(extents));
 }
 
-bool Frustum::contains(BoundingBox boundingBox) const {
-  for (Plane p : { up, down, left, right, near, far })
-    if (!boundingBox.isForward(p))
+bool Frustum::contains(const BoundingSphere& sphere) const {
+  if (sphere.empty())
+    return false;
+
+  for (int i = 0; i < FRUSTUM_PLANES; i++)
+    if (planes.x[i] * sphere.center.x + planes.y[i] * sphere.center.y + planes.z[i] * sphere.center.z
+        < planes.d[i] - sphere.radius)
       return false;
-  
+
   return true;
+}
+
+size_t Frustum::contains(const BoxBatch& boxes, uint8_t* visible) const {
+  return cullBoxes(planes, boxes, visible);
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+/**
+ * @file welder.cpp
+ *
+ * @brief File implementing the welding of the identical vertices of a triangle soup
+ */
+
+#include "welder.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+static_assert(sizeof(Vertex) == 8 * sizeof(uint32_t), "Vertex must be made of 8 floats");
+
+/**
+ * @brief Computes the key of a vertex: the bit patterns of its attributes,
+ * with -0.0 replaced by +0.0 so both compare equal (as they do as floats)
+*/
+static void vertexKey(const Vertex& vertex, uint32_t key[8]) {
+  memcpy(key, &vertex, sizeof(Vertex));
+
+  for (int i = 0; i < 8; i++)
+    if ((key[i] & 0x7fffffff) == 0)
+      key[i] = 0;
+}
+
+static uint64_t hashKey(const uint32_t key[8]) {
+  uint64_t h = 0x9e3779b97f4a7c15ull;
+
+  for (int i = 0; i < 8; i++) {
+    h ^= key[i];
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 32;
+  }
+
+  return h;
+}
+
+static bool sameVertex(const Vertex& a, const Vertex& b) {
+  uint32_t ka[8], kb[8];
+  vertexKey(a, ka);
+  vertexKey(b, kb);
+  return memcmp(ka, kb, sizeof(ka)) == 0;
+}
+
+/**
+ * @brief An open-addressing (linear probing) hash table from vertices to the
+ * first corner they appear in
+*/
+class WeldTable {
+public:
+  WeldTable(size_t entries) {
+    size_t capacity = 16;
+    while (capacity < 2 * entries)
+      capacity *= 2;
+
+    slots.assign(capacity, -1);
+    mask = capacity - 1;
+  }
+
+  /**
+   * @brief Returns the first corner with the same vertex as the given one,
+   * inserting it if it's the first
+   *
+   * @param corners the corners of the triangle soup
+   * @param corner  the index of the corner to look up
+   * @param hash    the hash of the key of the corner
+  */
+  int findOrInsert(const std::vector<Vertex>& corners, int corner, uint64_t hash) {
+    for (uint64_t slot = hash & mask;; slot = (slot + 1) & mask) {
+      int first = slots[slot];
+
+      if (first < 0) {
+        slots[slot] = corner;
+        return corner;
+      }
+
+      if (sameVertex(corners[first], corners[corner]))
+        return first;
+    }
+  }
+
+private:
+  std::vector<int> slots;
+  uint64_t mask;
+};
+
+/**
+ * @brief Runs f(0), ..., f(threads - 1), each in its own thread, and waits
+ * for all of them to finish
+*/
+template <typename F> static void runThreads(unsigned int threads, F f) {
+  std::vector<std::thread> workers;
+
+  for (unsigned int t = 1; t < threads; t++)
+    workers.emplace_back(f, t);
+  f(0);
+
+  for (std::thread& w : workers)
+    w.join();
+}
+
+/**
+ * @brief Finds, for each corner, the first corner with the same vertex,
+ * splitting the hash table in one shard per thread
+*/
+static void findFirstCorners(const std::vector<Vertex>& corners, std::vector<int>& first, unsigned int threads) {
+  size_t n = corners.size();
+  size_t chunk = (n + threads - 1) / threads;
+  auto shardOf = [threads](uint64_t hash) { return (unsigned int)((hash >> 40) % threads); };
+
+  //1. hash every corner and count how many of each chunk fall in each shard
+  std::vector<uint64_t> hashes(n);
+  std::vector<size_t> counts(threads * threads, 0); //counts[chunk * threads + shard]
+
+  runThreads(threads, [&](unsigned int c) {
+    for (size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); i++) {
+      uint32_t key[8];
+      vertexKey(corners[i], key);
+      hashes[i] = hashKey(key);
+      counts[c * threads + shardOf(hashes[i])]++;
+    }
+  });
+
+  //2. bucket the corners by shard. Within a shard, the corners stay in order
+  std::vector<size_t> offsets(threads * threads + 1, 0); //offsets[shard * threads + chunk]
+  for (unsigned int s = 0, k = 0; s < threads; s++)
+    for (unsigned int c = 0; c < threads; c++, k++)
+      offsets[k + 1] = offsets[k] + counts[c * threads + s];
+
+  std::vector<int> order(n);
+  runThreads(threads, [&](unsigned int c) {
+    std::vector<size_t> next(threads);
+    for (unsigned int s = 0; s < threads; s++)
+      next[s] = offsets[s * threads + c];
+
+    for (size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); i++)
+      order[next[shardOf(hashes[i])]++] = i;
+  });
+
+  //3. each thread looks up the corners of its shard in its own table
+  runThreads(threads, [&](unsigned int s) {
+    size_t begin = offsets[s * threads], end = offsets[(s + 1) * threads];
+    WeldTable table(end - begin);
+
+    for (size_t k = begin; k < end; k++)
+      first[order[k]] = table.findOrInsert(corners, order[k], hashes[order[k]]);
+  });
+}
+
+void weldVertices(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices,
+                  std::vector<int>& indices, unsigned int threads) {
+  size_t n = corners.size();
+  indices.resize(n);
+
+  if (threads == 0)
+    threads = n < WELD_PARALLEL_THRESHOLD ? 1 : std::max(1u, std::thread::hardware_concurrency());
+
+  if (threads == 1) {
+    WeldTable table(n);
+
+    for (size_t i = 0; i < n; i++) {
+      uint32_t key[8];
+      vertexKey(corners[i], key);
+      indices[i] = table.findOrInsert(corners, i, hashKey(key));
+    }
+  } else {
+    findFirstCorners(corners, indices, threads);
+  }
+
+  //number the vertices in order of first appearance. The first corner of each
+  //vertex always comes before the others, so its index is already known
+  for (size_t i = 0; i < n; i++) {
+    if (indices[i] == (int)i) {
+      indices[i] = vertices.size();
+      vertices.push_back(corners[i]);
+    } else {
+      indices[i] = indices[indices[i]];
+    }
+  }
+}
@@ -3,6 +3,7 @@
 #include "utils.hpp"
 #include "world.hpp"
 #include "texture.hpp"
+#include "patchtessellator.hpp"
 #include <fstream>
 #include <iostream>
 
@@ -47,7 +48,7 @@ void World::parseWindow(XMLParser world) {
   /* Window node validation. */
   XMLParser windowParser = world.get_node("window");
 
-  windowParser.validate_attrs({"width", "height", "axis"});
+  windowParser.validate_attrs({"width", "height", "axis", "lodBias"});
   windowParser.validate_node({});
 
   windowSize = windowParser.as_tuple<int, int>({"width", "height"});
@@ -55,6 +56,9 @@ void World::parseWindow(XMLParser world) {
   std::string axisStr = "true";
   windowParser.get_opt_attr("axis", axisStr);
   this->axis = parseBool(axisStr);
+
+  this->lodBias = 0;
+  windowParser.get_opt_attr("lodBias", this->lodBias);
 }
 
 void World::parseCamera(XMLParser world) {
@@ -79,6 +83,10 @@ void World::initScene() {
   glutInitWindowPosition(100, 100);
   glutCreateWindow("Model Viewer 3000");
 
+  initGL();
+}
+
+void World::initGL() {
 #ifndef __APPLE__
 	glewInit();
 #endif
@@ -99,23 +107,84 @@ void World::initScene() {
 
   Shape::initShapes();
   Texture::initTextures();
+  instances = std::make_unique<InstanceRenderer>();
+  instances->initialize();
+  profiler->initialize();
+
+  jobs = std::make_unique<JobSystem>();
+  scene = FlatScene(root);
 }
 
 void World::changeSize(int width, int height) {
   camera->changeSize({width, height});
 }
 
-void World::renderScene() {
-  // clear buffers
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  camera->setupScene();
-  lighting.setupScene();
+WindowSize World::getWindowSize() const {
+  return windowSize;
+}
 
-  if(this->axis)
-    drawAxis();
-  
-  int culled = root.draw(camera->viewFrustum());
-  glutSetWindowTitle(("Culled Shapes: " + std::to_string(culled)).c_str());
+Profiler& World::getProfiler() {
+  return *profiler;
+}
+
+void World::setProfilePath(const std::string& path) {
+  profilePath = path;
+}
+
+void World::writeProfile() {
+  profiler->write(profilePath);
+}
+
+DrawStats World::renderFrame(float time) {
+  DrawStats stats;
+  profiler->beginFrame(time);
+
+  {
+    Profiler::Scope scope(*profiler, ProfileStage::Camera);
+    // clear buffers
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    camera->setupScene(modelview);
+  }
+
+  {
+    Profiler::Scope scope(*profiler, ProfileStage::Lighting);
+    lighting.setupScene();
+
+    if(this->axis)
+      drawAxis();
+  }
+
+  {
+    Profiler::Scope scope(*profiler, ProfileStage::Update);
+    scene.update(*jobs, { camera->viewFrustum(), camera->screenScale(), lodBias }, modelview.top(), time, stats);
+  }
+
+  {
+    Profiler::Scope scope(*profiler, ProfileStage::Submit);
+    scene.draw(*instances, stats);
+  }
+
+  profiler->endFrame(stats);
+  return stats;
+}
+
+void World::renderScene() {
+  float time = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+  DrawStats stats = renderFrame(time);
+
+  //setting the title allocates and goes to the window system, so it's only
+  //done a few times a second
+  titleFrames++;
+  if (time - titleTime >= TITLE_INTERVAL) {
+    glutSetWindowTitle(("FPS: " + std::to_string((int) (titleFrames / (time - titleTime) + 0.5f))
+                        + " | Culled Shapes: " + std::to_string(stats.culledModels)
+                        + " | Culled Groups: " + std::to_string(stats.culledGroups)
+                        + " | Draw Calls: " + std::to_string(stats.drawCalls)
+                        + " | State Changes: " + std::to_string(stats.shapeChanges + stats.textureChanges + stats.materialChanges)
+                        + " | LOD bias: " + std::to_string(lodBias)).c_str());
+    titleTime = time;
+    titleFrames = 0;
+  }
 
   // End of frame
   glutSwapBuffers();
@@ -133,12 +202,14 @@ void World::handleKey(unsigned char key,
   if (key == 'r') {
     try {
       Shape::clearCache();
+      PatchTessellator::clearCache();
       Texture::clearCache();
       
       XMLParser parser = parseXMLFile(srcFile);
       parseWindow(parser);
       parseLights(parser);
       parseRootGroup(parser);
+      scene = FlatScene(root);
 
       lighting.initScene();
       Shape::initShapes();
@@ -148,6 +219,24 @@ void World::handleKey(unsigned char key,
     }
   }
 
+  //write the profile of the last frames
+  if (key == 'p') {
+    try {
+      profiler->flush();
+      writeProfile();
+      std::cout << "Profile written to " << profilePath << std::endl;
+    } catch (std::exception& e) {
+      std::cout << e.what() << std::endl;
+    }
+  }
+
+  //coarser/finer levels of detail
+  if (key == '+')
+    lodBias += 0.5f;
+
+  if (key == '-')
+    lodBias -= 0.5f;
+
   //reload only camera
   if (key == 'c') {
     try {